@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "GraphicsStructures.h"
+
+// Función para codificar una imagen BMP de 24 bits en memoria.
+// 'pixels' contiene width * height colores fila por fila; cada fila se rellena hasta un múltiplo de 4 bytes.
+std::vector<uint8_t> encodeBMP24(int width, int height, const std::vector<Color>& pixels) {
+    // Escribir la cabecera del archivo BMP
+    uint32_t rowSize = (3 * width + 3) & ~3u;
+    uint32_t fileSize = 54 + rowSize * height;
+    uint32_t dataOffset = 54;
+    uint32_t biPlanes = 1;
+    uint32_t biBitCount = 24;
+
+    uint8_t header[54] = {'B', 'M',
+                          static_cast<uint8_t>(fileSize & 0xFF), static_cast<uint8_t>((fileSize >> 8) & 0xFF), static_cast<uint8_t>((fileSize >> 16) & 0xFF), static_cast<uint8_t>((fileSize >> 24) & 0xFF),
+                          0, 0, 0, 0,
+                          static_cast<uint8_t>(dataOffset & 0xFF), static_cast<uint8_t>((dataOffset >> 8) & 0xFF), static_cast<uint8_t>((dataOffset >> 16) & 0xFF), static_cast<uint8_t>((dataOffset >> 24) & 0xFF),
+                          40, 0, 0, 0,
+                          static_cast<uint8_t>(width & 0xFF), static_cast<uint8_t>((width >> 8) & 0xFF), static_cast<uint8_t>((width >> 16) & 0xFF), static_cast<uint8_t>((width >> 24) & 0xFF),
+                          static_cast<uint8_t>(height & 0xFF), static_cast<uint8_t>((height >> 8) & 0xFF), static_cast<uint8_t>((height >> 16) & 0xFF), static_cast<uint8_t>((height >> 24) & 0xFF),
+                          static_cast<uint8_t>(biPlanes & 0xFF), static_cast<uint8_t>((biPlanes >> 8) & 0xFF),
+                          static_cast<uint8_t>(biBitCount & 0xFF), static_cast<uint8_t>((biBitCount >> 8) & 0xFF)};
+
+    std::vector<uint8_t> data(fileSize, 0);
+    std::copy(header, header + sizeof(header), data.begin());
+
+    // Escribir los datos de los píxeles (orden BGR)
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = data.data() + dataOffset + static_cast<size_t>(y) * rowSize;
+        const Color* src = pixels.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            row[3 * x + 0] = src[x].b;
+            row[3 * x + 1] = src[x].g;
+            row[3 * x + 2] = src[x].r;
+        }
+    }
+    return data;
+}
+
+// Función para escribir una imagen BMP de 24 bits
+bool writeBMP24(const std::string& filename, int width, int height, const std::vector<Color>& pixels) {
+    // Abrir el archivo BMP en modo binario para escritura
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "No se pudo abrir el archivo para escribir: " << filename << "\n";
+        return false;
+    }
+
+    std::vector<uint8_t> data = encodeBMP24(width, height, pixels);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    // Cerrar el archivo BMP
+    file.close();
+    std::cout << "Archivo BMP guardado: " << filename << "\n";
+    return true;
+}
+
+// Función para leer una imagen BMP de 24 bits escrita por writeBMP24.
+// Devuelve los píxeles en el mismo orden de filas en que se escribieron.
+bool readBMP24(const std::string& filename, int& width, int& height, std::vector<Color>& pixels) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    uint8_t header[54];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != 'B' || header[1] != 'M') {
+        std::cerr << "Archivo BMP inválido: " << filename << "\n";
+        return false;
+    }
+
+    auto readU32 = [&](int offset) {
+        return static_cast<uint32_t>(header[offset]) | (static_cast<uint32_t>(header[offset + 1]) << 8) |
+               (static_cast<uint32_t>(header[offset + 2]) << 16) | (static_cast<uint32_t>(header[offset + 3]) << 24);
+    };
+    uint32_t dataOffset = readU32(10);
+    width = static_cast<int>(readU32(18));
+    height = static_cast<int>(readU32(22));
+    uint32_t bitCount = header[28] | (header[29] << 8);
+    if (bitCount != 24 || width <= 0 || height <= 0) {
+        std::cerr << "Solo se admiten BMP de 24 bits sin compresión: " << filename << "\n";
+        return false;
+    }
+
+    file.seekg(dataOffset);
+    uint32_t rowSize = (3 * width + 3) & ~3u;
+    std::vector<uint8_t> row(rowSize);
+    pixels.resize(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        if (!file.read(reinterpret_cast<char*>(row.data()), rowSize)) {
+            std::cerr << "BMP truncado: " << filename << "\n";
+            return false;
+        }
+        for (int x = 0; x < width; ++x) {
+            pixels[static_cast<size_t>(y) * width + x] = Color(row[3 * x + 2], row[3 * x + 1], row[3 * x + 0]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,214 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "Framebuffer.h"
+#include "Lighting.h"
+#include "ShadowMap.h"
+#include "ShaderProgram.h"
+#include "Quantization.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+// Sombreado diferido. La pasada de geometría dibuja las mallas en un G-buffer, un Framebuffer cuyo búfer de color
+// guarda en cada píxel la normal codificada en el octaedro (12 bits por componente) y un identificador de material
+// de 8 bits en lugar de un color; la profundidad es la de siempre. La normal se guarda en el espacio de vista: en
+// pantalla casi toda su longitud está en z (la profundidad ocupa un rango mucho menor que los píxeles) y la
+// diferencia entre caras queda por debajo de lo que cabe en 12 bits. Después, shadeGBuffer() ilumina una sola vez
+// cada píxel visible en una pasada de pantalla completa repartida entre hilos y recorrida por los mosaicos de
+// LightGrid, así que el costo de las luces y las sombras ya no crece con el sobredibujo: un fragmento tapado
+// solo paga empaquetar su normal.
+
+const float GBUFFER_NORMAL_MAX = 4095.0f; // 12 bits por componente de la normal
+
+// Función para empaquetar una normal (no hace falta que sea unitaria) y un material en un téxel del G-buffer:
+// los 24 bits bajos (r, g, b) son las dos componentes octaédricas y 'a' es el material
+inline Color packGBuffer(const glm::vec3& N, uint8_t material) {
+    glm::vec2 oct = octahedralEncode(N);
+    // Redondeo sumando 0.5: los valores ya son positivos
+    uint32_t x = static_cast<uint32_t>(std::clamp(oct.x * 0.5f + 0.5f, 0.0f, 1.0f) * GBUFFER_NORMAL_MAX + 0.5f);
+    uint32_t y = static_cast<uint32_t>(std::clamp(oct.y * 0.5f + 0.5f, 0.0f, 1.0f) * GBUFFER_NORMAL_MAX + 0.5f);
+    uint32_t bits = x | (y << 12);
+    Color texel;
+    texel.r = static_cast<uint8_t>(bits & 0xFF);
+    texel.g = static_cast<uint8_t>((bits >> 8) & 0xFF);
+    texel.b = static_cast<uint8_t>(bits >> 16);
+    texel.a = material;
+    return texel;
+}
+
+// Función para recuperar la normal unitaria de un téxel del G-buffer
+inline glm::vec3 gbufferNormal(const Color& texel) {
+    uint32_t bits = static_cast<uint32_t>(texel.r) | (static_cast<uint32_t>(texel.g) << 8) | (static_cast<uint32_t>(texel.b) << 16);
+    glm::vec2 oct(static_cast<float>(bits & 0xFFF), static_cast<float>(bits >> 12));
+    return octahedralDecode(oct * (2.0f / GBUFFER_NORMAL_MAX) - 1.0f);
+}
+
+// Paso de normales entre pantalla y vista en un punto de la pantalla. De pantalla a vista se multiplica por la
+// traspuesta del jacobiano de viewport * proyección (como LightGrid::shade()) y de vista a pantalla por sus
+// cofactores (ScreenNormalTransform); la ida y vuelta da la normal por el determinante, cuyo signo se corrige.
+struct ViewNormalTransform {
+    glm::mat3 rows = glm::mat3(1.0f); // Traspuesta de la parte lineal de viewport * proyección
+    glm::vec3 homogeneous = glm::vec3(0.0f);
+    ScreenNormalTransform cofactors;
+    float sign = 1.0f;
+
+    explicit ViewNormalTransform(const Uniform& u) : cofactors(u.viewport * u.projection) {
+        glm::mat4 viewToScreen = u.viewport * u.projection;
+        rows = glm::transpose(glm::mat3(viewToScreen));
+        homogeneous = glm::vec3(viewToScreen[0][3], viewToScreen[1][3], viewToScreen[2][3]);
+        // Signo en un punto delante de la cámara; no cambia en la región visible
+        glm::vec4 p = viewToScreen * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f);
+        glm::vec3 screen = glm::vec3(p) / p.w;
+        glm::vec3 axis(0.0f, 0.0f, 1.0f);
+        sign = glm::dot(toScreen(screen, toView(screen, axis)), axis) < 0.0f ? -1.0f : 1.0f;
+    }
+
+    // Normal en vista (sin normalizar) de la normal 'screenNormal' en el punto 'screenPosition' de la pantalla
+    glm::vec3 toView(const glm::vec3& screenPosition, const glm::vec3& screenNormal) const {
+        return planeToView(screenNormal, glm::dot(screenPosition, screenNormal));
+    }
+
+    // Normal en vista (sin normalizar) del plano de la pantalla con normal 'screenNormal' y dot(punto, normal)
+    // igual a 'offset': la misma en todos los puntos del plano
+    glm::vec3 planeToView(const glm::vec3& screenNormal, float offset) const {
+        return sign * (rows * screenNormal - homogeneous * offset);
+    }
+
+    // Normal en pantalla (sin normalizar) de la normal 'viewNormal' en el punto 'screenPosition' de la pantalla
+    glm::vec3 toScreen(const glm::vec3& screenPosition, const glm::vec3& viewNormal) const {
+        return cofactors(screenPosition, viewNormal);
+    }
+};
+
+// Programa de la pasada de geometría con la normal de cara, como FlatProgram. La normal de cara en vista solo
+// depende del plano del triángulo en pantalla (normal y desplazamiento), así que el téxel se empaqueta con el
+// primer fragmento y se reutiliza mientras el plano no cambie: un fragmento tapado cuesta lo mismo que en la
+// pasada de solo profundidad más la escritura. Dos triángulos paralelos en planos distintos no comparten téxel.
+struct GBufferProgram {
+    using Attributes = glm::vec3;
+    struct Varyings {};
+
+    glm::mat4 transform;
+    ViewNormalTransform normals;
+    uint8_t material;
+    mutable glm::vec3 lastFaceNormal = glm::vec3(0.0f); // Ninguna normal de cara es nula
+    mutable float lastPlaneOffset = 0.0f;
+    mutable Color lastTexel;
+
+    GBufferProgram(const Uniform& u, uint8_t id)
+            : transform(u.viewport * u.projection * u.view * u.model), normals(u), material(id) {}
+
+    glm::vec4 vertex(const glm::vec3& position, Varyings&) const {
+        return transform * glm::vec4(position, 1.0f);
+    }
+
+    Color fragment(const Varyings&, const FragmentInput& in) const {
+        if (in.faceNormal != lastFaceNormal || in.planeOffset != lastPlaneOffset) {
+            lastFaceNormal = in.faceNormal;
+            lastPlaneOffset = in.planeOffset;
+            lastTexel = packGBuffer(normals.planeToView(in.faceNormal, in.planeOffset), material);
+        }
+        return lastTexel;
+    }
+};
+
+// Programa de la pasada de geometría con la normal interpolada en pantalla, como PhongProgram
+struct GBufferSmoothProgram {
+    using Attributes = MeshVertex;
+    struct Varyings {
+        glm::vec3 normal;
+    };
+
+    glm::mat4 transform;
+    ScreenNormalTransform normalTransform;
+    ViewNormalTransform normals;
+    uint8_t material;
+
+    GBufferSmoothProgram(const Uniform& u, uint8_t id)
+            : transform(u.viewport * u.projection * u.view * u.model), normalTransform(transform), normals(u), material(id) {}
+
+    glm::vec4 vertex(const MeshVertex& in, Varyings& out) const {
+        glm::vec4 r = transform * glm::vec4(in.position, 1.0f);
+        glm::vec3 screen(r.x / r.w, r.y / r.w, r.z / r.w);
+        out.normal = glm::normalize(normalTransform(screen, in.normal));
+        return r;
+    }
+
+    Color fragment(const Varyings& in, const FragmentInput& fragment) const {
+        return packGBuffer(normals.toView(fragment.position, in.normal), material);
+    }
+};
+
+// Función para dibujar una malla en el G-buffer con el material dado. Con LightingMode::Flat (o sin normales en
+// la malla) guarda la normal de cara; con los modos suaves, la normal interpolada, así que Gouraud se ilumina
+// por píxel igual que Phong.
+void drawGBuffer(Framebuffer& gbuffer, const Mesh& mesh, const Uniform& uniform, LightingMode mode, uint8_t material = 0,
+                 const PipelineState& state = PipelineState()) {
+    if (mode == LightingMode::Flat || mesh.normals.size() != mesh.positions.size()) {
+        draw(gbuffer, GBufferProgram(uniform, material), mesh.positions, mesh.indices, state);
+        return;
+    }
+    auto fetch = [&](size_t i) {
+        return MeshVertex{mesh.positions[i], mesh.normals[i]};
+    };
+    drawVertices(gbuffer, GBufferSmoothProgram(uniform, material), mesh.positions.size(), fetch, mesh.indices, state);
+}
+
+// Función para iluminar el G-buffer sobre 'fb' (del mismo tamaño), dibujado con las matrices de vista, proyección
+// y viewport de 'camera'. Cada píxel con geometría recibe las luces
+// direccionales, la sombra si hay mapa y las luces con alcance de su mosaico (con 'lights' repartida para este
+// tamaño), y el resultado se multiplica por el color de su material; los identificadores fuera de 'materials'
+// quedan en blanco. Los píxeles sin geometría conservan el color de 'fb' y la profundidad se copia entera.
+// Las tareas son franjas de una fila de mosaicos de luces: cada mosaico lee su lista de luces una vez.
+void shadeGBuffer(Framebuffer& fb, const Framebuffer& gbuffer, const Uniform& camera, const std::vector<Color>& materials,
+                  const LightGrid* lights = nullptr, const ShadowMap* shadows = nullptr, ThreadPool& pool = threadPool()) {
+    PROFILE_ZONE("deferredShading");
+    ViewNormalTransform normals(camera);
+    int width = gbuffer.width;
+    int height = gbuffer.height;
+    size_t bands = static_cast<size_t>((height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE);
+    pool.run(bands, [&](size_t band) {
+        int y0 = static_cast<int>(band) * LIGHT_TILE_SIZE;
+        int y1 = std::min(y0 + LIGHT_TILE_SIZE, height);
+        for (int y = y0; y < y1; y++) {
+            size_t row = static_cast<size_t>(y) * width;
+            const float* depthRow = &gbuffer.depth[row];
+            const Color* texelRow = &gbuffer.color[row];
+            Color* colorRow = &fb.color[row];
+            std::copy(depthRow, depthRow + width, &fb.depth[row]);
+
+            for (int x0 = 0; x0 < width; x0 += LIGHT_TILE_SIZE) {
+                int x1 = std::min(x0 + LIGHT_TILE_SIZE, width);
+                uint32_t begin = 0;
+                uint32_t end = 0;
+                if (lights) {
+                    size_t tile = static_cast<size_t>(band) * lights->tilesX + x0 / LIGHT_TILE_SIZE;
+                    begin = lights->tileOffsets[tile];
+                    end = lights->tileOffsets[tile + 1];
+                }
+                for (int x = x0; x < x1; x++) {
+                    float z = depthRow[x];
+                    if (z >= DEPTH_CLEAR) {
+                        continue;
+                    }
+                    glm::vec3 position(static_cast<float>(x), static_cast<float>(y), z);
+                    glm::vec3 N = glm::normalize(normals.toScreen(position, gbufferNormal(texelRow[x])));
+                    float intensity = lightIntensity(N);
+                    if (shadows) {
+                        intensity *= shadows->visibility(position);
+                    }
+                    if (begin != end) {
+                        intensity += lights->shadeLights(begin, end, position, N);
+                    }
+                    uint8_t material = texelRow[x].a;
+                    Color color = intensityColor(intensity);
+                    colorRow[x] = material < materials.size() ? modulate(color, materials[material]) : color;
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,266 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "Framebuffer.h"
+#include "ObjLoader.h"
+#include "PipelineState.h"
+#include "Scene.h"
+#include "Profiler.h"
+
+// Dibujo incremental de escenas casi estáticas. DamageTracker compara la escena y la cámara con las del cuadro
+// anterior y marca como dañados los mosaicos de pantalla que cubrían y que cubren las instancias que cambiaron;
+// un cambio de cámara (o de tamaño) daña toda la pantalla. Después solo los mosaicos dañados se limpian
+// (clearDamage()), se vuelven a dibujar (renderScene() con la región) y se suben a la textura (rects()); el resto
+// del framebuffer conserva el cuadro anterior, que ya es el correcto.
+//
+// Volver a dibujar un triángulo que se sale de la región no cambia los mosaicos limpios: con la profundidad Less
+// por defecto y las mismas matrices, sus píxeles ya guardan esa profundidad o una menor.
+
+const int DAMAGE_TILE_SIZE = 32; // Lado de los mosaicos de daño, en píxeles
+
+// Función para obtener los píxeles que puede cubrir una caja del modelo con la matriz completa (viewport *
+// proyección * vista * modelo), con un píxel de margen. Vacío (minX > maxX) si la caja queda fuera de la
+// pantalla o detrás de la cámara, y la pantalla entera si cruza el plano de la cámara.
+PixelRect screenRect(const AABB& box, const glm::mat4& transform, int width, int height) {
+    glm::vec2 low(std::numeric_limits<float>::max());
+    glm::vec2 high(std::numeric_limits<float>::lowest());
+    // Bits de los lados de la pantalla que deja afuera cada esquina, en coordenadas homogéneas (sirven con w <= 0)
+    uint32_t outsideAll = 0x1F;
+    bool behind = false;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 p((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y,
+                    (corner & 4) ? box.max.z : box.min.z);
+        glm::vec4 r = transform * glm::vec4(p, 1.0f);
+        uint32_t outside = (r.x < 0.0f ? 1u : 0u) | (r.x > static_cast<float>(width) * r.w ? 2u : 0u) |
+                           (r.y < 0.0f ? 4u : 0u) | (r.y > static_cast<float>(height) * r.w ? 8u : 0u) |
+                           (r.w <= 0.0f ? 16u : 0u);
+        outsideAll &= outside;
+        if (r.w <= 0.0f) {
+            behind = true;
+            continue;
+        }
+        low = glm::min(low, glm::vec2(r) / r.w);
+        high = glm::max(high, glm::vec2(r) / r.w);
+    }
+    if (outsideAll != 0) {
+        return PixelRect{0, 0, -1, -1};
+    }
+    if (behind) {
+        return PixelRect{0, 0, width - 1, height - 1};
+    }
+    // Las coordenadas se recortan antes de convertirlas a enteros para no desbordar con cajas lejanas
+    return PixelRect{
+            static_cast<int>(std::clamp(std::floor(low.x) - 1.0f, 0.0f, static_cast<float>(width))),
+            static_cast<int>(std::clamp(std::floor(low.y) - 1.0f, 0.0f, static_cast<float>(height))),
+            static_cast<int>(std::clamp(std::ceil(high.x) + 1.0f, -1.0f, static_cast<float>(width - 1))),
+            static_cast<int>(std::clamp(std::ceil(high.y) + 1.0f, -1.0f, static_cast<float>(height - 1)))
+    };
+}
+
+// Mosaicos dañados de un cuadro
+struct DamageRegion {
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<uint8_t> tiles; // 1 si el mosaico está dañado
+    size_t dirtyTiles = 0;
+
+    // Cambia el tamaño; todos los mosaicos quedan dañados
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        tilesX = (w + DAMAGE_TILE_SIZE - 1) / DAMAGE_TILE_SIZE;
+        tilesY = (h + DAMAGE_TILE_SIZE - 1) / DAMAGE_TILE_SIZE;
+        tiles.assign(static_cast<size_t>(tilesX) * tilesY, 1);
+        dirtyTiles = tiles.size();
+    }
+
+    // Ningún mosaico dañado
+    void reset() {
+        std::fill(tiles.begin(), tiles.end(), 0);
+        dirtyTiles = 0;
+    }
+
+    void markAll() {
+        std::fill(tiles.begin(), tiles.end(), 1);
+        dirtyTiles = tiles.size();
+    }
+
+    bool empty() const {
+        return dirtyTiles == 0;
+    }
+
+    bool full() const {
+        return dirtyTiles == tiles.size();
+    }
+
+    // Marca los mosaicos que toca el rectángulo (recortado a la pantalla)
+    void add(const PixelRect& rect) {
+        int x0 = std::max(rect.minX, 0) / DAMAGE_TILE_SIZE;
+        int y0 = std::max(rect.minY, 0) / DAMAGE_TILE_SIZE;
+        int x1 = std::min(rect.maxX, width - 1);
+        int y1 = std::min(rect.maxY, height - 1);
+        if (x1 < 0 || y1 < 0 || rect.minX > x1 || rect.minY > y1) {
+            return;
+        }
+        x1 /= DAMAGE_TILE_SIZE;
+        y1 /= DAMAGE_TILE_SIZE;
+        for (int ty = y0; ty <= y1; ty++) {
+            for (int tx = x0; tx <= x1; tx++) {
+                uint8_t& tile = tiles[static_cast<size_t>(ty) * tilesX + tx];
+                dirtyTiles += tile == 0;
+                tile = 1;
+            }
+        }
+    }
+
+    // Función para saber si el rectángulo toca algún mosaico dañado
+    bool touches(const PixelRect& rect) const {
+        if (full()) {
+            return rect.minX <= rect.maxX && rect.minY <= rect.maxY;
+        }
+        int x1 = std::min(rect.maxX, width - 1);
+        int y1 = std::min(rect.maxY, height - 1);
+        if (empty() || x1 < 0 || y1 < 0 || rect.minX > x1 || rect.minY > y1) {
+            return false;
+        }
+        int x0 = std::max(rect.minX, 0) / DAMAGE_TILE_SIZE;
+        int y0 = std::max(rect.minY, 0) / DAMAGE_TILE_SIZE;
+        x1 /= DAMAGE_TILE_SIZE;
+        y1 /= DAMAGE_TILE_SIZE;
+        for (int ty = y0; ty <= y1; ty++) {
+            const uint8_t* row = &tiles[static_cast<size_t>(ty) * tilesX];
+            for (int tx = x0; tx <= x1; tx++) {
+                if (row[tx]) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Función para obtener los mosaicos dañados como rectángulos de píxeles: las corridas de mosaicos de una fila
+    // se unen, y también con la corrida de igual ancho de la fila de arriba
+    std::vector<PixelRect> rects() const {
+        std::vector<PixelRect> result;
+        std::vector<size_t> open; // Rectángulos que llegan hasta la fila de mosaicos anterior
+        std::vector<size_t> next;
+        for (int ty = 0; ty < tilesY; ty++) {
+            const uint8_t* row = &tiles[static_cast<size_t>(ty) * tilesX];
+            int y0 = ty * DAMAGE_TILE_SIZE;
+            int y1 = std::min(y0 + DAMAGE_TILE_SIZE, height) - 1;
+            next.clear();
+            for (int tx = 0; tx < tilesX;) {
+                if (!row[tx]) {
+                    tx++;
+                    continue;
+                }
+                int first = tx;
+                while (tx < tilesX && row[tx]) {
+                    tx++;
+                }
+                int x0 = first * DAMAGE_TILE_SIZE;
+                int x1 = std::min(tx * DAMAGE_TILE_SIZE, width) - 1;
+                auto above = std::find_if(open.begin(), open.end(), [&](size_t i) {
+                    return result[i].minX == x0 && result[i].maxX == x1;
+                });
+                if (above != open.end()) {
+                    result[*above].maxY = y1;
+                    next.push_back(*above);
+                } else {
+                    result.push_back(PixelRect{x0, y0, x1, y1});
+                    next.push_back(result.size() - 1);
+                }
+            }
+            open.swap(next);
+        }
+        return result;
+    }
+};
+
+// Función para limpiar el color y la profundidad de los mosaicos dañados
+void clearDamage(Framebuffer& fb, const DamageRegion& damage, const Color& clearColor) {
+    PROFILE_ZONE("clear");
+    if (damage.full()) {
+        fb.clear(clearColor);
+        return;
+    }
+    for (const PixelRect& rect : damage.rects()) {
+        for (int y = rect.minY; y <= rect.maxY; y++) {
+            size_t row = static_cast<size_t>(y) * fb.width;
+            std::fill(fb.color.begin() + row + rect.minX, fb.color.begin() + row + rect.maxX + 1, clearColor);
+            std::fill(fb.depth.begin() + row + rect.minX, fb.depth.begin() + row + rect.maxX + 1, DEPTH_CLEAR);
+        }
+    }
+}
+
+// Seguimiento del daño entre cuadros de una escena dibujada con renderScene(). Detecta instancias movidas,
+// recoloreadas, agregadas o quitadas y cambios de cámara; los cambios que no ve (editar una malla, cambiar
+// Scene::lodPixelError o dibujar en el framebuffer fuera de renderScene()) necesitan invalidate() o add().
+struct DamageTracker {
+    DamageRegion damage;
+    bool valid = false;              // false: el próximo cuadro se dibuja entero
+    glm::mat4 lastScreen = glm::mat4(1.0f); // viewport * proyección * vista * uniform.model del cuadro anterior
+    std::vector<Instance> instances; // Instancias del cuadro anterior
+    std::vector<PixelRect> rects;    // Píxeles que cubrían
+
+    void invalidate() {
+        valid = false;
+    }
+
+    // Marca un rectángulo dañado en el cuadro actual (por ejemplo, una superposición que cambia); va después
+    // de update()
+    void add(const PixelRect& rect) {
+        damage.add(rect);
+    }
+
+    // Función para calcular el daño del cuadro que se va a dibujar y recordar la escena para el siguiente
+    void update(const Scene& scene, const Uniform& uniform, int width, int height) {
+        PROFILE_ZONE("damage");
+        glm::mat4 screen = uniform.viewport * uniform.projection * uniform.view * uniform.model;
+        if (damage.width != width || damage.height != height) {
+            damage.resize(width, height);
+            valid = false;
+        }
+        bool full = !valid || screen != lastScreen;
+        if (full) {
+            damage.markAll();
+        } else {
+            damage.reset();
+        }
+
+        size_t count = scene.instances.size();
+        rects.resize(std::max(rects.size(), count));
+        for (size_t i = 0; i < count; i++) {
+            const Instance& instance = scene.instances[i];
+            PixelRect rect = screenRect(scene.meshes[instance.mesh].bounds, screen * instance.model, width, height);
+            if (!full) {
+                bool known = i < instances.size();
+                bool changed = !known || instance.mesh != instances[i].mesh || instance.model != instances[i].model ||
+                               instance.color.r != instances[i].color.r || instance.color.g != instances[i].color.g ||
+                               instance.color.b != instances[i].color.b || instance.color.a != instances[i].color.a;
+                if (changed) {
+                    damage.add(rect);
+                    if (known) {
+                        damage.add(rects[i]);
+                    }
+                }
+            }
+            rects[i] = rect;
+        }
+        // Las instancias quitadas dejan dañado lo que cubrían
+        for (size_t i = count; i < instances.size() && !full; i++) {
+            damage.add(rects[i]);
+        }
+        rects.resize(count);
+        instances = scene.instances;
+        lastScreen = screen;
+        valid = true;
+    }
+};
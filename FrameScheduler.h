@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Planificador de cuadros con paso de tiempo fijo.
+// Mide cada cuadro con un reloj monotónico, duerme solo el tiempo que falta para
+// completar el intervalo objetivo (y hace un pequeño "spin" final para precisión),
+// y separa el tiempo de la animación del número de cuadros dibujados.
+struct FrameScheduler {
+    using Clock = std::chrono::steady_clock;
+
+    double targetInterval;   // Duración objetivo de un cuadro (segundos)
+    double fixedStep;        // Paso fijo de la simulación (segundos)
+    double spinMargin;       // Margen final que se espera activamente en lugar de dormir (segundos)
+    double maxFrameDelta;    // Límite del delta por cuadro para evitar la "espiral de la muerte"
+    int maxStepsPerFrame;    // Máximo de pasos de simulación por cuadro
+
+    Clock::time_point frameStart;
+    Clock::time_point deadline;
+    double accumulator = 0.0;
+    double simulationTime = 0.0;
+
+    // Estadísticas de la ventana de reporte actual
+    Clock::time_point reportStart;
+    std::vector<double> frameTimes;
+    double reportInterval = 1.0;
+
+    explicit FrameScheduler(double targetFps, double simulationHz = 144.0, double spinMarginMs = 1.0)
+            : targetInterval(1.0 / targetFps),
+              fixedStep(1.0 / simulationHz),
+              spinMargin(spinMarginMs / 1000.0),
+              maxFrameDelta(0.25),
+              maxStepsPerFrame(8) {
+        frameStart = Clock::now();
+        deadline = frameStart + toDuration(targetInterval);
+        reportStart = frameStart;
+        frameTimes.reserve(static_cast<size_t>(targetFps * reportInterval * 2));
+    }
+
+    static Clock::duration toDuration(double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    static double toSeconds(Clock::duration d) {
+        return std::chrono::duration<double>(d).count();
+    }
+
+    // Inicia un cuadro: mide el tiempo transcurrido desde el cuadro anterior y
+    // devuelve cuántos pasos fijos de simulación hay que avanzar.
+    int beginFrame() {
+        Clock::time_point now = Clock::now();
+        double delta = toSeconds(now - frameStart);
+        frameStart = now;
+
+        frameTimes.push_back(delta);
+
+        accumulator += std::min(delta, maxFrameDelta);
+        int steps = 0;
+        while (accumulator >= fixedStep && steps < maxStepsPerFrame) {
+            accumulator -= fixedStep;
+            simulationTime += fixedStep;
+            steps++;
+        }
+        // Si se alcanzó el límite, se descarta el atraso restante
+        if (steps == maxStepsPerFrame) {
+            accumulator = std::min(accumulator, fixedStep);
+        }
+        return steps;
+    }
+
+    // Fracción del siguiente paso ya transcurrida, útil para interpolar estados
+    double alpha() const {
+        return accumulator / fixedStep;
+    }
+
+    // Termina el cuadro: duerme lo que falta del intervalo y espera activamente el resto
+    void endFrame() {
+        Clock::time_point now = Clock::now();
+
+        // Si vamos atrasados más de un intervalo, se reinicia la fase en lugar de acumular deuda
+        if (now > deadline + toDuration(targetInterval)) {
+            deadline = now + toDuration(targetInterval);
+            return;
+        }
+
+        Clock::duration remaining = deadline - now;
+        if (remaining > toDuration(spinMargin)) {
+            std::this_thread::sleep_for(remaining - toDuration(spinMargin));
+        }
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+
+        // Avanzar la fecha límite desde la anterior (y no desde "ahora") evita la deriva
+        deadline += toDuration(targetInterval);
+    }
+
+    // Devuelve true (y llena 'report') una vez por intervalo de reporte
+    bool report(std::string& out) {
+        Clock::time_point now = Clock::now();
+        double elapsed = toSeconds(now - reportStart);
+        if (elapsed < reportInterval || frameTimes.empty()) {
+            return false;
+        }
+
+        std::vector<double> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+
+        // Jitter: desviación absoluta de cada cuadro respecto al intervalo objetivo
+        std::vector<double> jitter;
+        jitter.reserve(frameTimes.size());
+        for (double t : frameTimes) {
+            jitter.push_back(std::abs(t - targetInterval));
+        }
+        std::sort(jitter.begin(), jitter.end());
+
+        double fps = static_cast<double>(frameTimes.size()) / elapsed;
+
+        std::ostringstream ss;
+        ss.setf(std::ios::fixed);
+        ss.precision(2);
+        ss << "FPS: " << fps
+           << " | cuadro p50/p95/p99: " << percentile(sorted, 0.50) * 1000.0
+           << "/" << percentile(sorted, 0.95) * 1000.0
+           << "/" << percentile(sorted, 0.99) * 1000.0 << " ms"
+           << " | jitter p50/p95/p99: " << percentile(jitter, 0.50) * 1000.0
+           << "/" << percentile(jitter, 0.95) * 1000.0
+           << "/" << percentile(jitter, 0.99) * 1000.0 << " ms";
+        out = ss.str();
+
+        frameTimes.clear();
+        reportStart = now;
+        return true;
+    }
+
+    // Percentil por rango más cercano sobre un arreglo ya ordenado
+    static double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+};
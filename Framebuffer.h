@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "GraphicsStructures.h"
+
+// Valor con el que se inicializa el z-buffer (profundidad "infinita")
+const float DEPTH_CLEAR = 99999.0f;
+
+// Framebuffer en memoria: un búfer de color y un z-buffer del mismo tamaño.
+// El color se guarda como bytes RGBA consecutivos para poder subirlo directamente a una textura.
+struct Framebuffer {
+    int width = 0;
+    int height = 0;
+    std::vector<Color> color; // Búfer de color (fila por fila)
+    std::vector<float> depth; // Z-buffer para almacenar información de profundidad de los píxeles
+
+    Framebuffer() = default;
+
+    Framebuffer(int w, int h) {
+        resize(w, h);
+    }
+
+    // Cambia el tamaño de los búferes
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        color.assign(static_cast<size_t>(w) * h, Color(0, 0, 0, 0));
+        depth.assign(static_cast<size_t>(w) * h, DEPTH_CLEAR);
+    }
+
+    // Limpia el color y la profundidad
+    void clear(const Color& clearColor) {
+        std::fill(color.begin(), color.end(), clearColor);
+        std::fill(depth.begin(), depth.end(), DEPTH_CLEAR);
+    }
+
+    Color& colorAt(int x, int y) {
+        return color[static_cast<size_t>(y) * width + x];
+    }
+
+    float& depthAt(int x, int y) {
+        return depth[static_cast<size_t>(y) * width + x];
+    }
+
+    const Color& colorAt(int x, int y) const {
+        return color[static_cast<size_t>(y) * width + x];
+    }
+
+    float depthAt(int x, int y) const {
+        return depth[static_cast<size_t>(y) * width + x];
+    }
+};
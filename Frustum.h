@@ -0,0 +1,65 @@
+#pragma once
+#include "glm/glm.hpp"
+#include "ObjLoader.h"
+
+// Resultado de clasificar un volumen contra el frustum
+enum class FrustumTest {
+    Outside,      // Completamente fuera: se descarta
+    Intersecting, // Cruza algún plano: hay que probar sus partes
+    Inside        // Completamente dentro: sus partes no necesitan más pruebas
+};
+
+// Planos del frustum en el espacio de entrada de la matriz de recorte (método Gribb-Hartmann):
+// con proyección * vista * modelo quedan en el espacio de la malla, con proyección * vista en el del mundo
+struct Frustum {
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4& clip) {
+        glm::mat4 m = glm::transpose(clip);
+        planes[0] = m[3] + m[0];
+        planes[1] = m[3] - m[0];
+        planes[2] = m[3] + m[1];
+        planes[3] = m[3] - m[1];
+        planes[4] = m[3] + m[2];
+        planes[5] = m[3] - m[2];
+        for (glm::vec4& p : planes) {
+            p /= glm::length(glm::vec3(p));
+        }
+    }
+
+    // Frustum con todos los planos desplazados 'margin' unidades hacia afuera
+    Frustum expanded(float margin) const {
+        Frustum result = *this;
+        for (glm::vec4& p : result.planes) {
+            p.w += margin;
+        }
+        return result;
+    }
+
+    bool sphereOutside(const glm::vec3& center, float radius) const {
+        for (const glm::vec4& p : planes) {
+            if (glm::dot(glm::vec3(p), center) + p.w < -radius) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Clasifica una caja con su centro y su radio proyectado sobre la normal de cada plano
+    FrustumTest classify(const AABB& box) const {
+        glm::vec3 center = box.center();
+        glm::vec3 halfExtent = (box.max - box.min) * 0.5f;
+        FrustumTest result = FrustumTest::Inside;
+        for (const glm::vec4& p : planes) {
+            float distance = glm::dot(glm::vec3(p), center) + p.w;
+            float radius = glm::dot(glm::abs(glm::vec3(p)), halfExtent);
+            if (distance < -radius) {
+                return FrustumTest::Outside;
+            }
+            if (distance < radius) {
+                result = FrustumTest::Intersecting;
+            }
+        }
+        return result;
+    }
+};
@@ -1,33 +1,33 @@
 #pragma once
-#include <SDL.h>
+#include <cstdint>
 #include <algorithm>
 #include <iostream>
 #include "glm/glm.hpp"
 
 // Estructura para representar un color RGBA
 struct Color {
-    Uint8 r; // Componente rojo
-    Uint8 g; // Componente verde
-    Uint8 b; // Componente azul
-    Uint8 a; // Componente alfa (transparencia)
+    uint8_t r; // Componente rojo
+    uint8_t g; // Componente verde
+    uint8_t b; // Componente azul
+    uint8_t a; // Componente alfa (transparencia)
 
     // Constructores para inicializar el color
     Color() : r(0), g(0), b(0), a(255) {}
 
     Color(int red, int green, int blue, int alpha = 255) {
         // Asegura que los componentes estén en el rango [0, 255]
-        r = static_cast<Uint8>(std::min(std::max(red, 0), 255));
-        g = static_cast<Uint8>(std::min(std::max(green, 0), 255));
-        b = static_cast<Uint8>(std::min(std::max(blue, 0), 255));
-        a = static_cast<Uint8>(std::min(std::max(alpha, 0), 255));
+        r = static_cast<uint8_t>(std::min(std::max(red, 0), 255));
+        g = static_cast<uint8_t>(std::min(std::max(green, 0), 255));
+        b = static_cast<uint8_t>(std::min(std::max(blue, 0), 255));
+        a = static_cast<uint8_t>(std::min(std::max(alpha, 0), 255));
     }
 
     Color(float red, float green, float blue, float alpha = 1.0f) {
         // Convierte valores de punto flotante en enteros en el rango [0, 255]
-        r = std::clamp(static_cast<Uint8>(red * 255), Uint8(0), Uint8(255));
-        g = std::clamp(static_cast<Uint8>(green * 255), Uint8(0), Uint8(255));
-        b = std::clamp(static_cast<Uint8>(blue * 255), Uint8(0), Uint8(255));
-        a = std::clamp(static_cast<Uint8>(alpha * 255), Uint8(0), Uint8(255));
+        r = std::clamp(static_cast<uint8_t>(red * 255), uint8_t(0), uint8_t(255));
+        g = std::clamp(static_cast<uint8_t>(green * 255), uint8_t(0), uint8_t(255));
+        b = std::clamp(static_cast<uint8_t>(blue * 255), uint8_t(0), uint8_t(255));
+        a = std::clamp(static_cast<uint8_t>(alpha * 255), uint8_t(0), uint8_t(255));
     }
 
     // Sobrecarga del operador + para sumar colores
@@ -43,10 +43,10 @@ struct Color {
     // Sobrecarga del operador * para escalar colores por un factor
     Color operator*(float factor) const {
         return Color{
-                std::clamp(static_cast<Uint8>(r * factor), Uint8(0), Uint8(255)),
-                std::clamp(static_cast<Uint8>(g * factor), Uint8(0), Uint8(255)),
-                std::clamp(static_cast<Uint8>(b * factor), Uint8(0), Uint8(255)),
-                std::clamp(static_cast<Uint8>(a * factor), Uint8(0), Uint8(255))
+                std::clamp(static_cast<uint8_t>(r * factor), uint8_t(0), uint8_t(255)),
+                std::clamp(static_cast<uint8_t>(g * factor), uint8_t(0), uint8_t(255)),
+                std::clamp(static_cast<uint8_t>(b * factor), uint8_t(0), uint8_t(255)),
+                std::clamp(static_cast<uint8_t>(a * factor), uint8_t(0), uint8_t(255))
         };
     }
 
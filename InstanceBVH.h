@@ -0,0 +1,184 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "ObjLoader.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+// Jerarquía de volúmenes envolventes (BVH) sobre las cajas de las instancias de una escena.
+// El descarte por frustum recorre solo las ramas que cruzan algún plano: los subárboles completamente
+// fuera se saltan y los completamente dentro se aceptan enteros, así que el costo crece con lo visible.
+
+// Instancias por hoja
+const uint32_t BVH_LEAF_SIZE = 4;
+
+// Con menos instancias el descarte no se reparte entre hilos
+const size_t BVH_PARALLEL_MIN_ITEMS = 2048;
+
+struct BVHNode {
+    AABB bounds;
+    uint32_t left = 0;  // Hijo izquierdo (el derecho es left + 1); 0 en las hojas
+    uint32_t first = 0; // Rango del subárbol en InstanceBVH::items
+    uint32_t count = 0;
+};
+
+struct InstanceBVH {
+    std::vector<BVHNode> nodes;      // La raíz es el nodo 0; los hijos siempre van después del padre
+    std::vector<uint32_t> items;     // Índices de instancia, contiguos por subárbol
+    std::vector<AABB> itemBounds;    // Caja de cada instancia en el espacio de la escena
+
+    bool empty() const {
+        return nodes.empty();
+    }
+
+    // Construye el árbol dividiendo por la mediana de los centros en el eje más largo
+    void build(const std::vector<AABB>& bounds) {
+        itemBounds = bounds;
+        nodes.clear();
+        items.resize(bounds.size());
+        for (uint32_t i = 0; i < items.size(); i++) {
+            items[i] = i;
+        }
+        if (items.empty()) {
+            return;
+        }
+
+        nodes.push_back(BVHNode{AABB(), 0, 0, static_cast<uint32_t>(items.size())});
+        std::vector<uint32_t> pending = {0};
+        while (!pending.empty()) {
+            uint32_t index = pending.back();
+            pending.pop_back();
+            uint32_t first = nodes[index].first;
+            uint32_t count = nodes[index].count;
+
+            AABB centers;
+            for (uint32_t i = first; i < first + count; i++) {
+                nodes[index].bounds.expand(itemBounds[items[i]]);
+                centers.expand(itemBounds[items[i]].center());
+            }
+            if (count <= BVH_LEAF_SIZE) {
+                continue;
+            }
+
+            glm::vec3 extent = centers.max - centers.min;
+            int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+            uint32_t half = count / 2;
+            std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+                             [&](uint32_t a, uint32_t b) {
+                                 return itemBounds[a].center()[axis] < itemBounds[b].center()[axis];
+                             });
+
+            uint32_t left = static_cast<uint32_t>(nodes.size());
+            nodes[index].left = left;
+            nodes.push_back(BVHNode{AABB(), 0, first, half});
+            nodes.push_back(BVHNode{AABB(), 0, first + half, count - half});
+            pending.push_back(left);
+            pending.push_back(left + 1);
+        }
+    }
+
+    // Ajusta las cajas a las nuevas posiciones sin cambiar la forma del árbol.
+    // Barato (lineal y sin ordenar); conviene reconstruir si las instancias se desplazaron mucho.
+    void refit(const std::vector<AABB>& bounds) {
+        itemBounds = bounds;
+        for (size_t n = nodes.size(); n-- > 0;) {
+            BVHNode& node = nodes[n];
+            node.bounds = AABB();
+            if (node.left == 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    node.bounds.expand(itemBounds[items[i]]);
+                }
+            } else {
+                node.bounds.expand(nodes[node.left].bounds);
+                node.bounds.expand(nodes[node.left + 1].bounds);
+            }
+        }
+    }
+
+    // Agrega a 'visible' las instancias que pueden verse, en orden creciente.
+    // Devuelve el número de nodos probados.
+    size_t cull(const Frustum& frustum, std::vector<uint32_t>& visible, ThreadPool& pool) const {
+        visible.clear();
+        if (nodes.empty()) {
+            return 0;
+        }
+
+        size_t visited = 0;
+        if (items.size() < BVH_PARALLEL_MIN_ITEMS || pool.threadCount() == 1) {
+            visited = cullSubtree(0, frustum, visible);
+        } else {
+            // Bajar en serie hasta tener varios subárboles por hilo, luego recorrerlos en paralelo
+            std::vector<uint32_t> frontier = {0};
+            std::vector<uint32_t> split;
+            while (!frontier.empty() && frontier.size() < pool.threadCount() * 4) {
+                split.clear();
+                for (uint32_t index : frontier) {
+                    const BVHNode& node = nodes[index];
+                    visited++;
+                    FrustumTest test = frustum.classify(node.bounds);
+                    if (test == FrustumTest::Outside) {
+                        continue;
+                    }
+                    if (test == FrustumTest::Inside) {
+                        visible.insert(visible.end(), items.begin() + node.first, items.begin() + node.first + node.count);
+                    } else if (node.left == 0) {
+                        cullLeaf(node, frustum, visible);
+                    } else {
+                        split.push_back(node.left);
+                        split.push_back(node.left + 1);
+                    }
+                }
+                frontier.swap(split);
+            }
+
+            std::vector<std::vector<uint32_t>> partial(frontier.size());
+            std::vector<size_t> partialVisited(frontier.size(), 0);
+            pool.run(frontier.size(), [&](size_t i) {
+                partialVisited[i] = cullSubtree(frontier[i], frustum, partial[i]);
+            });
+            for (size_t i = 0; i < frontier.size(); i++) {
+                visible.insert(visible.end(), partial[i].begin(), partial[i].end());
+                visited += partialVisited[i];
+            }
+        }
+
+        // El orden de dibujo no depende de la forma del árbol
+        std::sort(visible.begin(), visible.end());
+        return visited;
+    }
+
+private:
+    void cullLeaf(const BVHNode& node, const Frustum& frustum, std::vector<uint32_t>& visible) const {
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            if (frustum.classify(itemBounds[items[i]]) != FrustumTest::Outside) {
+                visible.push_back(items[i]);
+            }
+        }
+    }
+
+    size_t cullSubtree(uint32_t root, const Frustum& frustum, std::vector<uint32_t>& visible) const {
+        size_t visited = 0;
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = root;
+        while (top > 0) {
+            const BVHNode& node = nodes[stack[--top]];
+            visited++;
+            FrustumTest test = frustum.classify(node.bounds);
+            if (test == FrustumTest::Outside) {
+                continue;
+            }
+            if (test == FrustumTest::Inside) {
+                visible.insert(visible.end(), items.begin() + node.first, items.begin() + node.first + node.count);
+            } else if (node.left == 0) {
+                cullLeaf(node, frustum, visible);
+            } else {
+                stack[top++] = node.left + 1;
+                stack[top++] = node.left;
+            }
+        }
+        return visited;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include "glm/glm.hpp"
+
+// Interpolación de atributos sobre un triángulo en pantalla con ecuaciones de plano.
+// Cualquier valor que varía linealmente en pantalla (coordenadas baricéntricas, profundidad, 1/w, atributo/w)
+// es un plano v(x, y) = dx * x + dy * y + c: se prepara una vez por triángulo y a lo largo de una fila se
+// avanza sumando dx, así que cada atributo más cuesta una suma por píxel y no otro cálculo baricéntrico.
+//
+// Los atributos de vértice no varían linealmente en pantalla después de la proyección, pero atributo/w y 1/w sí:
+// el valor correcto en perspectiva es (atributo/w)(x, y) / (1/w)(x, y).
+
+struct PlaneEquation {
+    float dx = 0.0f;
+    float dy = 0.0f;
+    float c = 0.0f;
+
+    float at(float x, float y) const {
+        return dx * x + dy * y + c;
+    }
+};
+
+// Vértices de un triángulo en pantalla con lo necesario para preparar sus planos
+struct TriangleSetup {
+    glm::vec2 A, B, C;
+    float invArea; // Inverso del doble del área con signo
+
+    TriangleSetup(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+            : A(a), B(b), C(c), invArea(1.0f / ((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y))) {}
+
+    // Plano que toma los valores va, vb y vc en los tres vértices
+    PlaneEquation plane(float va, float vb, float vc) const {
+        PlaneEquation p;
+        p.dx = ((vb - va) * (C.y - A.y) - (vc - va) * (B.y - A.y)) * invArea;
+        p.dy = ((vc - va) * (B.x - A.x) - (vb - va) * (C.x - A.x)) * invArea;
+        p.c = va - p.dx * A.x - p.dy * A.y;
+        return p;
+    }
+};
+
+// N planos guardados por componente (todos los dx juntos, etc.) para que el avance por píxel sea
+// un bucle de sumas que el compilador puede vectorizar
+template <size_t N>
+struct PlaneSet {
+    std::array<float, N> dx;
+    std::array<float, N> dy;
+    std::array<float, N> c;
+
+    void set(size_t k, const PlaneEquation& p) {
+        dx[k] = p.dx;
+        dy[k] = p.dy;
+        c[k] = p.c;
+    }
+
+    // Valores en (x, y), para empezar una fila
+    void evaluate(float x, float y, std::array<float, N>& out) const {
+        for (size_t k = 0; k < N; k++) {
+            out[k] = dx[k] * x + dy[k] * y + c[k];
+        }
+    }
+
+    // Avanza los valores un píxel a la derecha
+    void stepX(std::array<float, N>& values) const {
+        for (size_t k = 0; k < N; k++) {
+            values[k] += dx[k];
+        }
+    }
+
+    // Avanza los valores x píxeles a la derecha e y hacia abajo
+    void step(std::array<float, N>& values, float x, float y) const {
+        for (size_t k = 0; k < N; k++) {
+            values[k] += dx[k] * x + dy[k] * y;
+        }
+    }
+};
@@ -0,0 +1,256 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+
+// Luces de la escena. Las direccionales iluminan toda la imagen y se evalúan con la normal en pantalla, como la
+// luz original del renderizador; las puntuales y los focos tienen alcance limitado y se evalúan en el espacio de
+// vista. Cada cuadro, cullLights() reparte las luces con alcance en mosaicos de pantalla de 16x16 píxeles: un
+// fragmento recorre solo la lista compacta de su mosaico, así que su costo depende de las luces cercanas y no
+// del total de la escena.
+
+enum class LightType : uint8_t { Directional, Point, Spot };
+
+struct Light {
+    LightType type = LightType::Directional;
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, 1.0f); // Direccional: hacia la luz, en pantalla. Foco: eje del cono, en el mundo
+    glm::vec3 position = glm::vec3(0.0f);              // Puntual y foco, en el mundo
+    float intensity = 1.0f;
+    float range = 1.0f;      // Distancia (en el mundo) a la que la luz se apaga por completo
+    float innerAngle = 0.0f; // Foco: semiángulo (grados) con intensidad completa
+    float outerAngle = 0.0f; // Foco: semiángulo (grados) donde la luz se apaga
+};
+
+// Bloque de luces de la escena, el equivalente a un bloque uniforme. Las direccionales, que evalúa cada
+// fragmento, se guardan aparte de las que tienen alcance, que solo recorre cullLights().
+struct LightBlock {
+    std::vector<Light> directional;
+    std::vector<Light> local;
+
+    void add(const Light& light) {
+        (light.type == LightType::Directional ? directional : local).push_back(light);
+    }
+
+    void clear() {
+        directional.clear();
+        local.clear();
+    }
+};
+
+// Función para crear una luz direccional; la dirección apunta hacia la luz y está en pantalla
+Light directionalLight(const glm::vec3& direction, float intensity) {
+    Light light;
+    light.type = LightType::Directional;
+    light.direction = glm::normalize(direction);
+    light.intensity = intensity;
+    return light;
+}
+
+// Función para crear una luz puntual en el mundo
+Light pointLight(const glm::vec3& position, float intensity, float range) {
+    Light light;
+    light.type = LightType::Point;
+    light.position = position;
+    light.intensity = intensity;
+    light.range = range;
+    return light;
+}
+
+// Función para crear un foco en el mundo que apunta en 'direction'
+Light spotLight(const glm::vec3& position, const glm::vec3& direction, float intensity, float range, float innerAngle, float outerAngle) {
+    Light light = pointLight(position, intensity, range);
+    light.type = LightType::Spot;
+    light.direction = glm::normalize(direction);
+    light.innerAngle = innerAngle;
+    light.outerAngle = outerAngle;
+    return light;
+}
+
+// Luces de la escena. Por defecto, la luz original: direccional hacia (0.5, 0.5, 1) con intensidad 10
+LightBlock sceneLights = {{directionalLight(glm::vec3(0.5f, 0.5f, 1.0f), 10.0f)}, {}};
+
+// Función para calcular la intensidad de las luces direccionales sobre una superficie con normal N (en pantalla).
+// El producto no se recorta a 0, igual que con la luz original.
+float directionalIntensity(const LightBlock& block, const glm::vec3& N) {
+    float intensity = 0.0f;
+    for (const Light& light : block.directional) {
+        intensity += glm::dot(N, light.direction) * light.intensity;
+    }
+    return intensity;
+}
+
+const int LIGHT_TILE_SIZE = 16;
+
+// Luz con alcance preparada para un cuadro, en el espacio de vista
+struct LocalLight {
+    glm::vec3 position;
+    glm::vec3 direction; // Foco: eje del cono
+    float intensity;
+    float invRange2;     // 1 / alcance^2
+    float cosOuter;      // Foco: coseno del semiángulo exterior (menor que -1 en las puntuales, que no tienen cono)
+    float invConeWidth;  // Foco: 1 / (cos interior - cos exterior)
+};
+
+// Listas de luces por mosaico de un cuadro (ver cullLights())
+struct LightGrid {
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<LocalLight> lights;
+    std::vector<uint32_t> tileOffsets; // Las luces del mosaico t son tileLights[tileOffsets[t] .. tileOffsets[t + 1])
+    std::vector<uint32_t> tileLights;
+
+    // Para pasar de pantalla a vista: inversa de viewport * proyección, y su parte lineal para las normales
+    glm::mat4 screenToView = glm::mat4(1.0f);
+    glm::mat3 normalRows = glm::mat3(1.0f); // Traspuesta de la parte lineal de viewport * proyección
+    glm::vec3 homogeneousRow = glm::vec3(0.0f);
+
+    // Función para calcular la intensidad de las luces del mosaico del píxel en 'screenPosition' sobre una
+    // superficie con normal 'screenNormal' (ambas en pantalla, como las recibe el sombreado)
+    float shade(const glm::vec3& screenPosition, const glm::vec3& screenNormal) const {
+        int x = static_cast<int>(screenPosition.x);
+        int y = static_cast<int>(screenPosition.y);
+        if (x < 0 || y < 0 || x >= width || y >= height) {
+            return 0.0f;
+        }
+        size_t tile = static_cast<size_t>(y / LIGHT_TILE_SIZE) * tilesX + x / LIGHT_TILE_SIZE;
+        return shadeLights(tileOffsets[tile], tileOffsets[tile + 1], screenPosition, screenNormal);
+    }
+
+    // Función para calcular la intensidad de las luces tileLights[begin .. end) sobre el punto; la usan shade()
+    // y las pasadas que recorren la pantalla por mosaicos, que leen la lista una vez por mosaico
+    float shadeLights(uint32_t begin, uint32_t end, const glm::vec3& screenPosition, const glm::vec3& screenNormal) const {
+        if (begin == end) {
+            return 0.0f;
+        }
+
+        // Posición en vista desproyectando el píxel. La normal sale de la de pantalla con la traspuesta del
+        // jacobiano de la proyección en ese punto, (F^T * N - h * (s . N)) / w; w no cambia la dirección.
+        glm::vec4 v = screenToView * glm::vec4(screenPosition, 1.0f);
+        glm::vec3 position = glm::vec3(v) / v.w;
+        glm::vec3 normal = glm::normalize(normalRows * screenNormal - homogeneousRow * glm::dot(screenPosition, screenNormal));
+        // Las caras se iluminan por el lado que mira a la cámara (en el origen)
+        if (glm::dot(normal, position) > 0.0f) {
+            normal = -normal;
+        }
+
+        float intensity = 0.0f;
+        for (uint32_t i = begin; i < end; i++) {
+            const LocalLight& light = lights[tileLights[i]];
+            glm::vec3 toLight = light.position - position;
+            float distance2 = glm::dot(toLight, toLight);
+            float falloff = 1.0f - distance2 * light.invRange2;
+            if (falloff <= 0.0f) {
+                continue;
+            }
+            glm::vec3 L = toLight / std::sqrt(distance2);
+            float cone = std::clamp((glm::dot(-L, light.direction) - light.cosOuter) * light.invConeWidth, 0.0f, 1.0f);
+            intensity += light.intensity * std::max(glm::dot(normal, L), 0.0f) * falloff * falloff * cone;
+        }
+        return intensity;
+    }
+};
+
+// Función para preparar las luces con alcance de un cuadro y repartirlas en mosaicos. Cada luz se acota con la
+// caja en pantalla de su esfera de alcance; si la esfera queda toda detrás del plano cercano se descarta, y si
+// cruza el plano de la cámara, cubre toda la pantalla.
+void cullLights(LightGrid& grid, const LightBlock& block, const Uniform& u, int width, int height) {
+    grid.width = width;
+    grid.height = height;
+    grid.tilesX = (width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    grid.tilesY = (height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    glm::mat4 viewToScreen = u.viewport * u.projection;
+    grid.screenToView = glm::inverse(viewToScreen);
+    grid.normalRows = glm::transpose(glm::mat3(viewToScreen));
+    grid.homogeneousRow = glm::vec3(viewToScreen[0][3], viewToScreen[1][3], viewToScreen[2][3]);
+    // Distancia al plano cercano de la proyección en perspectiva (el plano está en z = -nearPlane)
+    float nearPlane = u.projection[3][2] / (u.projection[2][2] - 1.0f);
+
+    struct TileRect {
+        int minX, minY, maxX, maxY;
+    };
+    std::vector<TileRect> rects;
+    grid.lights.clear();
+    for (const Light& light : block.local) {
+        if (light.intensity <= 0.0f || light.range <= 0.0f) {
+            continue;
+        }
+        LocalLight local;
+        local.position = glm::vec3(u.view * glm::vec4(light.position, 1.0f));
+        local.intensity = light.intensity;
+        local.invRange2 = 1.0f / (light.range * light.range);
+        if (light.type == LightType::Spot) {
+            local.direction = glm::normalize(glm::vec3(u.view * glm::vec4(light.direction, 0.0f)));
+            local.cosOuter = std::cos(glm::radians(light.outerAngle));
+            local.invConeWidth = 1.0f / std::max(std::cos(glm::radians(light.innerAngle)) - local.cosOuter, 1e-4f);
+        } else {
+            local.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+            local.cosOuter = -2.0f; // El cono siempre da 1
+            local.invConeWidth = 1.0f;
+        }
+
+        // La esfera no ilumina nada visible si queda toda detrás del plano cercano
+        if (local.position.z - light.range >= -nearPlane) {
+            continue;
+        }
+
+        // Caja en pantalla de las esquinas de la caja de la esfera
+        glm::vec2 low(std::numeric_limits<float>::max());
+        glm::vec2 high(std::numeric_limits<float>::lowest());
+        bool crossesCamera = false;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 offset((corner & 1) ? light.range : -light.range, (corner & 2) ? light.range : -light.range,
+                             (corner & 4) ? light.range : -light.range);
+            glm::vec4 p = viewToScreen * glm::vec4(local.position + offset, 1.0f);
+            if (p.w <= 0.0f) {
+                crossesCamera = true;
+                break;
+            }
+            low = glm::min(low, glm::vec2(p) / p.w);
+            high = glm::max(high, glm::vec2(p) / p.w);
+        }
+        TileRect rect = {0, 0, grid.tilesX - 1, grid.tilesY - 1};
+        if (!crossesCamera) {
+            if (high.x < 0.0f || high.y < 0.0f || low.x >= width || low.y >= height) {
+                continue;
+            }
+            // Se recorta antes de convertir a enteros para no desbordar con esferas casi en el plano de la cámara
+            float maxX = static_cast<float>(width - 1);
+            float maxY = static_cast<float>(height - 1);
+            rect.minX = static_cast<int>(std::clamp(low.x, 0.0f, maxX)) / LIGHT_TILE_SIZE;
+            rect.minY = static_cast<int>(std::clamp(low.y, 0.0f, maxY)) / LIGHT_TILE_SIZE;
+            rect.maxX = static_cast<int>(std::clamp(high.x, 0.0f, maxX)) / LIGHT_TILE_SIZE;
+            rect.maxY = static_cast<int>(std::clamp(high.y, 0.0f, maxY)) / LIGHT_TILE_SIZE;
+        }
+        grid.lights.push_back(local);
+        rects.push_back(rect);
+    }
+
+    // Dos pasadas: contar las luces de cada mosaico, acumular y llenar las listas
+    size_t tileCount = static_cast<size_t>(grid.tilesX) * grid.tilesY;
+    grid.tileOffsets.assign(tileCount + 1, 0);
+    for (const TileRect& rect : rects) {
+        for (int ty = rect.minY; ty <= rect.maxY; ty++) {
+            for (int tx = rect.minX; tx <= rect.maxX; tx++) {
+                grid.tileOffsets[static_cast<size_t>(ty) * grid.tilesX + tx + 1]++;
+            }
+        }
+    }
+    for (size_t t = 0; t < tileCount; t++) {
+        grid.tileOffsets[t + 1] += grid.tileOffsets[t];
+    }
+    grid.tileLights.resize(grid.tileOffsets[tileCount]);
+    std::vector<uint32_t> cursor(grid.tileOffsets.begin(), grid.tileOffsets.end() - 1);
+    for (size_t l = 0; l < rects.size(); l++) {
+        for (int ty = rects[l].minY; ty <= rects[l].maxY; ty++) {
+            for (int tx = rects[l].minX; tx <= rects[l].maxX; tx++) {
+                grid.tileLights[cursor[static_cast<size_t>(ty) * grid.tilesX + tx]++] = static_cast<uint32_t>(l);
+            }
+        }
+    }
+}
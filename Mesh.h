@@ -0,0 +1,238 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <type_traits>
+#include <vector>
+#include "glm/glm.hpp"
+#include "ObjLoader.h"
+
+// Tamaño de la caché FIFO de vértices transformados del dibujo indexado
+const int VERTEX_CACHE_SIZE = 32;
+
+// Grupo de triángulos con sus volúmenes de descarte (ver Meshlet.h)
+struct Meshlet {
+    uint32_t vertexOffset;   // Primer vértice en Mesh::meshletVertices
+    uint32_t vertexCount;
+    uint32_t triangleOffset; // Primer triángulo en Mesh::meshletTriangles (tres índices locales cada uno)
+    uint32_t triangleCount;
+
+    glm::vec3 center;        // Esfera envolvente
+    float radius;
+    glm::vec3 coneApex;      // Cono de normales
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+// Vértice comprimido (ver Quantization.h): posición de 16 bits por eje relativa a la caja de la malla
+// y normal octaédrica de 2 x 16 bits; 10 bytes en lugar de los 24 de dos glm::vec3
+struct QuantizedVertex {
+    uint16_t position[3];
+    int16_t normal[2];
+};
+
+// Nodo de la jerarquía de triángulos de una malla (ver RayCaster.h)
+struct TriangleBVHNode {
+    AABB bounds;
+    uint32_t left = 0;  // Hijo izquierdo (el derecho es left + 1); 0 en las hojas
+    uint32_t first = 0; // Rango del subárbol en Mesh::bvhTriangles
+    uint32_t count = 0;
+};
+
+// Nivel de detalle simplificado (ver MeshSimplifier.h); comparte las posiciones de la malla
+struct MeshLOD {
+    std::vector<uint32_t> indices;
+    uint32_t vertexCount = 0; // Solo usa las primeras vertexCount posiciones
+    float error = 0.0f;       // Distancia aproximada a la malla original, en unidades del modelo
+
+    // Jerarquía de triángulos del nivel, como la de Mesh
+    std::vector<TriangleBVHNode> triangleBVH;
+    std::vector<uint32_t> bvhTriangles;
+};
+
+// Malla indexada: cada vértice se guarda una sola vez y los triángulos lo referencian por índice.
+// Es la representación sobre la que trabajan las optimizaciones de carga y el dibujo indexado.
+struct Mesh {
+    std::vector<glm::vec3> positions; // Posiciones de los vértices únicos
+    std::vector<uint32_t> indices;    // Tres índices por triángulo
+    AABB bounds;                      // Caja envolvente de las posiciones en el espacio del modelo
+
+    // Atributos opcionales, uno por posición; vacíos si la malla se construyó sin ellos
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texcoords;
+
+    // Grupos de triángulos; vacíos hasta llamar a buildMeshlets()
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;  // Índices globales de los vértices de cada grupo
+    std::vector<uint8_t> meshletTriangles;  // Índices locales (dentro del grupo) de cada triángulo
+
+    // Niveles cada vez más simples; vacío hasta llamar a generateLODs(). El nivel 0 es la propia malla.
+    std::vector<MeshLOD> lods;
+
+    // Vértices comprimidos; vacío hasta llamar a quantizeMesh(), que además libera 'positions'
+    std::vector<QuantizedVertex> quantized;
+    glm::mat4 dequantize = glm::mat4(1.0f); // Lleva las posiciones cuantizadas al espacio del modelo
+
+    // Jerarquía de triángulos del nivel 0 para el trazado de rayos; vacía hasta llamar a buildTriangleBVH()
+    std::vector<TriangleBVHNode> triangleBVH;
+    std::vector<uint32_t> bvhTriangles; // Índices de triángulo, contiguos por subárbol
+
+    size_t vertexCount() const {
+        return quantized.empty() ? positions.size() : quantized.size();
+    }
+
+    size_t triangleCount() const {
+        return indices.size() / 3;
+    }
+
+    size_t levelCount() const {
+        return lods.size() + 1;
+    }
+
+    const std::vector<uint32_t>& levelIndices(size_t level) const {
+        return level == 0 ? indices : lods[level - 1].indices;
+    }
+
+    size_t levelVertexCount(size_t level) const {
+        return level == 0 ? vertexCount() : lods[level - 1].vertexCount;
+    }
+
+    float levelError(size_t level) const {
+        return level == 0 ? 0.0f : lods[level - 1].error;
+    }
+
+    const std::vector<TriangleBVHNode>& levelBVH(size_t level) const {
+        return level == 0 ? triangleBVH : lods[level - 1].triangleBVH;
+    }
+
+    const std::vector<uint32_t>& levelBVHTriangles(size_t level) const {
+        return level == 0 ? bvhTriangles : lods[level - 1].bvhTriangles;
+    }
+
+    // Reordena los atributos de los vértices: el vértice nuevo i es el viejo order[i] y los que no aparecen
+    // se descartan. Los índices que los referencian los actualiza quien llama.
+    void reorderVertices(const std::vector<uint32_t>& order) {
+        auto gather = [&](auto& attribute) {
+            if (attribute.empty()) {
+                return;
+            }
+            std::remove_reference_t<decltype(attribute)> reordered;
+            reordered.reserve(order.size());
+            for (uint32_t index : order) {
+                reordered.push_back(attribute[index]);
+            }
+            attribute.swap(reordered);
+        };
+        gather(positions);
+        gather(normals);
+        gather(texcoords);
+    }
+};
+
+// Función para construir una malla indexada a partir de los vértices y caras de loadOBJ().
+// Las caras con más de tres vértices se dividen en abanico.
+Mesh buildMesh(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces) {
+    Mesh mesh;
+    mesh.positions = vertices;
+    mesh.indices.reserve(faces.size() * 3);
+    for (const glm::vec3& position : vertices) {
+        mesh.bounds.expand(position);
+    }
+
+    for (const auto& face : faces) {
+        for (size_t i = 1; i + 1 < face.vertexIndices.size(); i++) {
+            mesh.indices.push_back(static_cast<uint32_t>(face.vertexIndices[0][0]));
+            mesh.indices.push_back(static_cast<uint32_t>(face.vertexIndices[i][0]));
+            mesh.indices.push_back(static_cast<uint32_t>(face.vertexIndices[i + 1][0]));
+        }
+    }
+    return mesh;
+}
+
+// Función para calcular la normal de cada posición como el promedio de las normales de los triángulos que
+// la usan, ponderadas por el área
+std::vector<glm::vec3> computeVertexNormals(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+    std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const glm::vec3& a = positions[indices[t]];
+        const glm::vec3& b = positions[indices[t + 1]];
+        const glm::vec3& c = positions[indices[t + 2]];
+        glm::vec3 n = glm::cross(b - a, c - a);
+        for (int k = 0; k < 3; k++) {
+            normals[indices[t + k]] += n;
+        }
+    }
+    for (glm::vec3& n : normals) {
+        float length = glm::length(n);
+        n = length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+    return normals;
+}
+
+std::vector<glm::vec3> computeVertexNormals(const Mesh& mesh) {
+    return computeVertexNormals(mesh.positions, mesh.indices);
+}
+
+// Función para construir una malla indexada con normales y coordenadas de textura a partir de loadOBJ().
+// Cada combinación distinta de posición, coordenada y normal en las caras es un vértice de la malla. Si alguna
+// cara no trae normal, las normales se calculan suavizadas por posición, así que las costuras de textura no
+// se ven en la iluminación.
+Mesh buildMesh(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& texcoords,
+               const std::vector<glm::vec3>& normals, const std::vector<Face>& faces) {
+    auto valid = [](int index, size_t count) {
+        return index >= 0 && static_cast<size_t>(index) < count;
+    };
+    bool fileNormals = !normals.empty();
+    bool hasTexcoords = !texcoords.empty();
+    for (const Face& face : faces) {
+        for (const auto& corner : face.vertexIndices) {
+            fileNormals = fileNormals && valid(corner[2], normals.size());
+        }
+    }
+
+    // Combinaciones distintas en orden de aparición; posición -> índice de la combinación
+    Mesh mesh;
+    std::map<std::array<int, 3>, uint32_t> unique;
+    std::vector<uint32_t> positionOf;
+    std::vector<uint32_t> corners;
+    for (const Face& face : faces) {
+        corners.clear();
+        for (const auto& corner : face.vertexIndices) {
+            std::array<int, 3> key = {corner[0], hasTexcoords && valid(corner[1], texcoords.size()) ? corner[1] : -1,
+                                      fileNormals ? corner[2] : -1};
+            auto inserted = unique.emplace(key, static_cast<uint32_t>(mesh.positions.size()));
+            if (inserted.second) {
+                mesh.positions.push_back(vertices[corner[0]]);
+                positionOf.push_back(static_cast<uint32_t>(corner[0]));
+                if (fileNormals) {
+                    mesh.normals.push_back(glm::normalize(normals[corner[2]]));
+                }
+                if (hasTexcoords) {
+                    mesh.texcoords.push_back(key[1] >= 0 ? texcoords[key[1]] : glm::vec2(0.0f));
+                }
+            }
+            corners.push_back(inserted.first->second);
+        }
+        for (size_t i = 1; i + 1 < corners.size(); i++) {
+            mesh.indices.push_back(corners[0]);
+            mesh.indices.push_back(corners[i]);
+            mesh.indices.push_back(corners[i + 1]);
+        }
+    }
+    for (const glm::vec3& position : mesh.positions) {
+        mesh.bounds.expand(position);
+    }
+
+    if (!fileNormals) {
+        std::vector<uint32_t> positionIndices(mesh.indices.size());
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            positionIndices[i] = positionOf[mesh.indices[i]];
+        }
+        std::vector<glm::vec3> smooth = computeVertexNormals(vertices, positionIndices);
+        mesh.normals.resize(mesh.positions.size());
+        for (size_t v = 0; v < mesh.positions.size(); v++) {
+            mesh.normals[v] = smooth[positionOf[v]];
+        }
+    }
+    return mesh;
+}
@@ -0,0 +1,339 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Mesh.h"
+
+// Optimizaciones de la malla en tiempo de carga:
+//  - optimizeVertexCache: reordena los triángulos para la caché de vértices transformados (algoritmo de Forsyth).
+//  - optimizeOverdraw: reordena grupos de triángulos para dibujar primero lo que tiende a tapar al resto (estilo Tipsify).
+//  - optimizeVertexFetch: reordena los vértices según su primer uso para leerlos en orden de memoria.
+
+// Resultado de simular una caché FIFO sobre un búfer de índices
+struct VertexCacheStats {
+    uint64_t misses = 0; // Invocaciones del sombreador de vértices
+    double acmr = 0.0;   // Fallos promedio por triángulo (mínimo teórico ~0.5)
+    double atvr = 0.0;   // Fallos por vértice único (1.0 es óptimo)
+};
+
+// Función para simular una caché FIFO de 'cacheSize' vértices sobre el búfer de índices
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = VERTEX_CACHE_SIZE) {
+    VertexCacheStats stats;
+    std::vector<int64_t> insertedAt(vertexCount, -static_cast<int64_t>(cacheSize) - 1);
+    for (uint32_t index : indices) {
+        if (static_cast<int64_t>(stats.misses) - insertedAt[index] > cacheSize) {
+            insertedAt[index] = static_cast<int64_t>(stats.misses);
+            stats.misses++;
+        }
+    }
+    size_t triangles = indices.size() / 3;
+    stats.acmr = triangles ? static_cast<double>(stats.misses) / static_cast<double>(triangles) : 0.0;
+    stats.atvr = vertexCount ? static_cast<double>(stats.misses) / static_cast<double>(vertexCount) : 0.0;
+    return stats;
+}
+
+// Puntaje de un vértice según su posición en la caché LRU y los triángulos que aún lo usan
+float forsythVertexScore(int cachePosition, int remainingValence) {
+    const float cacheDecayPower = 1.5f;
+    const float lastTriangleScore = 0.75f;
+    const float valenceBoostScale = 2.0f;
+    const float valenceBoostPower = 0.5f;
+
+    if (remainingValence == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // Los vértices del último triángulo tienen un puntaje fijo para no favorecer tiras
+            score = lastTriangleScore;
+        } else {
+            float scaler = 1.0f / static_cast<float>(VERTEX_CACHE_SIZE - 3);
+            score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, cacheDecayPower);
+        }
+    }
+
+    // Favorecer los vértices con pocos triángulos restantes para no dejarlos aislados
+    score += valenceBoostScale * std::pow(static_cast<float>(remainingValence), -valenceBoostPower);
+    return score;
+}
+
+// Función para reordenar los triángulos según el algoritmo de Forsyth ("Linear-Speed Vertex Cache Optimisation")
+void optimizeVertexCache(Mesh& mesh) {
+    size_t triangleCount = mesh.triangleCount();
+    size_t vertexCount = mesh.positions.size();
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Lista de triángulos de cada vértice (formato CSR)
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t index : mesh.indices) {
+        offsets[index + 1]++;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> vertexTriangles(mesh.indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            vertexTriangles[fill[mesh.indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> remaining(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        remaining[v] = static_cast<int>(offsets[v + 1] - offsets[v]);
+    }
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScore[t] = vertexScore[mesh.indices[t * 3]] + vertexScore[mesh.indices[t * 3 + 1]] + vertexScore[mesh.indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> cache;  // Caché LRU simulada (tamaño de la caché + 3 durante la actualización)
+    std::vector<uint32_t> output;
+    output.reserve(mesh.indices.size());
+
+    size_t bestTriangle = static_cast<size_t>(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+    size_t scanCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        // Si no hay candidato en la caché, tomar el siguiente triángulo pendiente
+        if (bestTriangle == SIZE_MAX) {
+            while (emitted[scanCursor]) {
+                scanCursor++;
+            }
+            bestTriangle = scanCursor;
+        }
+
+        emitted[bestTriangle] = true;
+        uint32_t tri[3] = {mesh.indices[bestTriangle * 3], mesh.indices[bestTriangle * 3 + 1], mesh.indices[bestTriangle * 3 + 2]};
+        output.insert(output.end(), tri, tri + 3);
+
+        // Quitar el triángulo de las listas de sus vértices
+        for (uint32_t v : tri) {
+            uint32_t* begin = &vertexTriangles[offsets[v]];
+            uint32_t* end = begin + remaining[v];
+            std::iter_swap(std::find(begin, end, static_cast<uint32_t>(bestTriangle)), end - 1);
+            remaining[v]--;
+        }
+
+        // Mover los vértices del triángulo al frente de la caché
+        std::vector<uint32_t> newCache(tri, tri + 3);
+        for (uint32_t v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                newCache.push_back(v);
+            }
+        }
+        for (size_t i = VERTEX_CACHE_SIZE; i < newCache.size(); i++) {
+            cachePosition[newCache[i]] = -1;
+            vertexScore[newCache[i]] = forsythVertexScore(-1, remaining[newCache[i]]);
+        }
+        if (newCache.size() > static_cast<size_t>(VERTEX_CACHE_SIZE)) {
+            newCache.resize(VERTEX_CACHE_SIZE);
+        }
+        cache.swap(newCache);
+
+        // Actualizar los puntajes de los vértices en caché y elegir el mejor triángulo que los use
+        for (size_t i = 0; i < cache.size(); i++) {
+            cachePosition[cache[i]] = static_cast<int>(i);
+            vertexScore[cache[i]] = forsythVertexScore(static_cast<int>(i), remaining[cache[i]]);
+        }
+        bestTriangle = SIZE_MAX;
+        float bestScore = -1.0f;
+        for (uint32_t v : cache) {
+            for (int k = 0; k < remaining[v]; k++) {
+                uint32_t t = vertexTriangles[offsets[v] + k];
+                float score = vertexScore[mesh.indices[t * 3]] + vertexScore[mesh.indices[t * 3 + 1]] + vertexScore[mesh.indices[t * 3 + 2]];
+                triangleScore[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    mesh.indices.swap(output);
+}
+
+// Función para ordenar los grupos de triángulos (cortados en 'clusterStart') por su "potencial de oclusión":
+// los que miran hacia afuera desde el centro de la malla se dibujan primero
+std::vector<uint32_t> sortClustersByOcclusion(const Mesh& mesh, const std::vector<size_t>& clusterStart,
+                                              const glm::vec3& meshCenter) {
+    struct Cluster {
+        size_t begin;
+        size_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters;
+    for (size_t i = 0; i + 1 < clusterStart.size(); i++) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusterStart[i]; t < clusterStart[i + 1]; t++) {
+            const glm::vec3& a = mesh.positions[mesh.indices[t * 3]];
+            const glm::vec3& b = mesh.positions[mesh.indices[t * 3 + 1]];
+            const glm::vec3& c = mesh.positions[mesh.indices[t * 3 + 2]];
+            glm::vec3 n = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(n);
+            centroid += (a + b + c) / 3.0f * triangleArea;
+            normal += n;
+            area += triangleArea;
+        }
+        centroid /= std::max(area, 1e-20f);
+        float normalLength = glm::length(normal);
+        normal = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+        clusters.push_back({clusterStart[i], clusterStart[i + 1], glm::dot(centroid - meshCenter, normal)});
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& x, const Cluster& y) {
+        return x.sortKey > y.sortKey;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(mesh.indices.size());
+    for (const Cluster& cluster : clusters) {
+        output.insert(output.end(), mesh.indices.begin() + cluster.begin * 3, mesh.indices.begin() + cluster.end * 3);
+    }
+    return output;
+}
+
+// Función para reordenar grupos de triángulos y reducir el sobredibujo sin importar el punto de vista.
+// Corta el búfer (ya optimizado para la caché) en grupos donde la caché se vacía, y ordena los grupos
+// por su "potencial de oclusión": los que miran hacia afuera desde el centro de la malla se dibujan primero.
+// 'threshold' limita cuánto puede empeorar el ACMR (1.05 = 5%) al cortar grupos más pequeños.
+void optimizeOverdraw(Mesh& mesh, float threshold = 1.05f) {
+    size_t triangleCount = mesh.triangleCount();
+    if (triangleCount == 0) {
+        return;
+    }
+    VertexCacheStats baseline = analyzeVertexCache(mesh.indices, mesh.positions.size());
+
+    // Cortes duros: triángulos cuyos tres vértices fallan en la caché (la caché "se reinicia")
+    std::vector<size_t> hardStart = {0};
+    {
+        std::vector<int64_t> insertedAt(mesh.positions.size(), -VERTEX_CACHE_SIZE - 1);
+        int64_t misses = 0;
+        for (size_t t = 0; t < triangleCount; t++) {
+            int triangleMisses = 0;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = mesh.indices[t * 3 + k];
+                if (misses - insertedAt[v] > VERTEX_CACHE_SIZE) {
+                    insertedAt[v] = misses++;
+                    triangleMisses++;
+                }
+            }
+            if (t > 0 && triangleMisses == 3) {
+                hardStart.push_back(t);
+            }
+        }
+    }
+    hardStart.push_back(triangleCount);
+
+    // Cortes suaves (Tipsify): dentro de cada grupo duro, con la caché vacía al comienzo de cada grupo (después
+    // de ordenarlos, el anterior es otro), se corta apenas el ACMR del grupo llega a threshold * ACMR
+    std::vector<size_t> clusterStart = {0};
+    {
+        std::vector<int64_t> insertedAt(mesh.positions.size(), -VERTEX_CACHE_SIZE - 1);
+        int64_t clock = 0; // Avanza con cada fallo; saltar VERTEX_CACHE_SIZE + 1 vacía la caché
+        double limit = baseline.acmr * threshold;
+        for (size_t h = 0; h + 1 < hardStart.size(); h++) {
+            size_t clusterMisses = 0;
+            size_t begin = hardStart[h];
+            clock += VERTEX_CACHE_SIZE + 1;
+            for (size_t t = hardStart[h]; t < hardStart[h + 1]; t++) {
+                for (int k = 0; k < 3; k++) {
+                    uint32_t v = mesh.indices[t * 3 + k];
+                    if (clock - insertedAt[v] > VERTEX_CACHE_SIZE) {
+                        insertedAt[v] = clock++;
+                        clusterMisses++;
+                    }
+                }
+                size_t clusterSize = t + 1 - begin;
+                if (t + 1 < hardStart[h + 1] && static_cast<double>(clusterMisses) <= limit * static_cast<double>(clusterSize)) {
+                    clusterStart.push_back(t + 1);
+                    begin = t + 1;
+                    clusterMisses = 0;
+                    clock += VERTEX_CACHE_SIZE + 1;
+                }
+            }
+            // El resto del grupo duro, si queda por encima del límite, se une al grupo anterior
+            if (begin > hardStart[h] && static_cast<double>(clusterMisses) > limit * static_cast<double>(hardStart[h + 1] - begin)) {
+                clusterStart.pop_back();
+            }
+            clusterStart.push_back(hardStart[h + 1]);
+        }
+        clusterStart.erase(std::unique(clusterStart.begin(), clusterStart.end()), clusterStart.end());
+    }
+
+    // Centro de la malla (promedio ponderado por área de los centroides)
+    glm::vec3 meshCenter(0.0f);
+    float totalArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        const glm::vec3& a = mesh.positions[mesh.indices[t * 3]];
+        const glm::vec3& b = mesh.positions[mesh.indices[t * 3 + 1]];
+        const glm::vec3& c = mesh.positions[mesh.indices[t * 3 + 2]];
+        float area = glm::length(glm::cross(b - a, c - a));
+        meshCenter += (a + b + c) / 3.0f * area;
+        totalArea += area;
+    }
+    meshCenter /= std::max(totalArea, 1e-20f);
+
+    // Los grupos que se unen pueden quedar por encima del límite; si el total lo pasa, solo se usan los cortes
+    // duros, que no cambian el ACMR
+    std::vector<uint32_t> output = sortClustersByOcclusion(mesh, clusterStart, meshCenter);
+    if (analyzeVertexCache(output, mesh.positions.size()).acmr > baseline.acmr * threshold) {
+        output = sortClustersByOcclusion(mesh, hardStart, meshCenter);
+    }
+    mesh.indices.swap(output);
+}
+
+// Función para reordenar los vértices según el orden en que los usa el búfer de índices
+void optimizeVertexFetch(Mesh& mesh) {
+    const uint32_t unused = UINT32_MAX;
+    std::vector<uint32_t> remap(mesh.positions.size(), unused);
+    std::vector<uint32_t> order;
+    order.reserve(mesh.positions.size());
+
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(order.size());
+            order.push_back(index);
+        }
+        index = remap[index];
+    }
+    // Los vértices que ningún triángulo usa se descartan
+    mesh.reorderVertices(order);
+}
+
+// Caché de vértices antes y después de optimizeMesh()
+struct MeshOptimizationStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Función para aplicar todas las optimizaciones de carga. Devuelve la caché de vértices antes y después, para
+// que quien llama informe la mejora.
+MeshOptimizationStats optimizeMesh(Mesh& mesh, bool reduceOverdraw = true) {
+    VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.positions.size());
+
+    optimizeVertexCache(mesh);
+    if (reduceOverdraw) {
+        optimizeOverdraw(mesh);
+    }
+    optimizeVertexFetch(mesh);
+
+    VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.positions.size());
+    return MeshOptimizationStats{before, after};
+}
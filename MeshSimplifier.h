@@ -0,0 +1,354 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+// Simplificación de mallas por colapso de aristas con cuádricas de error (Garland-Heckbert) y
+// cadena de niveles de detalle (LOD) guardada junto a la malla.
+// Cada colapso mueve un vértice sobre otro ya existente, así que los niveles solo necesitan su búfer de
+// índices: todos comparten Mesh::positions y los vértices de un nivel son un subconjunto de los del anterior.
+
+// Peso de los planos que conservan los bordes abiertos y las aristas no manifold
+const double SIMPLIFY_BORDER_WEIGHT = 4.0;
+
+// Un colapso se rechaza si gira la normal de algún triángulo vecino más que esto (coseno)
+const float SIMPLIFY_MIN_NORMAL_DOT = 0.2f;
+
+// Cuádrica de error: suma de distancias al cuadrado a un conjunto de planos,
+// guardada como los 10 coeficientes de una matriz simétrica 4x4
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+
+    // Cuádrica del plano n·p + d = 0 (n unitaria)
+    static Quadric plane(const glm::dvec3& n, double d, double weight) {
+        Quadric q;
+        q.a2 = weight * n.x * n.x; q.ab = weight * n.x * n.y; q.ac = weight * n.x * n.z; q.ad = weight * n.x * d;
+        q.b2 = weight * n.y * n.y; q.bc = weight * n.y * n.z; q.bd = weight * n.y * d;
+        q.c2 = weight * n.z * n.z; q.cd = weight * n.z * d;
+        q.d2 = weight * d * d;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+        b2 += o.b2; bc += o.bc; bd += o.bd;
+        c2 += o.c2; cd += o.cd;
+        d2 += o.d2;
+        return *this;
+    }
+
+    // Suma de distancias al cuadrado del punto a los planos
+    double error(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                 + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                 + c2 * z * z + 2 * cd * z
+                 + d2;
+        return std::max(e, 0.0);
+    }
+};
+
+// Función para simplificar un búfer de índices hasta 'targetTriangles' triángulos como máximo.
+// Devuelve el nuevo búfer (sobre las mismas posiciones) y en 'outError' la distancia aproximada del peor colapso.
+std::vector<uint32_t> simplifyIndices(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+                                      size_t targetTriangles, float& outError) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> tris(indices);
+    std::vector<bool> alive(triangleCount, true);
+    size_t aliveCount = triangleCount;
+    outError = 0.0f;
+
+    // Triángulos de cada vértice (crecen al recibir los de los vértices colapsados sobre él)
+    std::vector<std::vector<uint32_t>> vertexTriangles(positions.size());
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            vertexTriangles[tris[t * 3 + k]].push_back(t);
+        }
+    }
+
+    // Cuádricas de los planos de los triángulos
+    std::vector<Quadric> quadrics(positions.size());
+    std::vector<glm::vec3> normals(triangleCount, glm::vec3(0.0f));
+    for (size_t t = 0; t < triangleCount; t++) {
+        glm::vec3 a = positions[tris[t * 3]], b = positions[tris[t * 3 + 1]], c = positions[tris[t * 3 + 2]];
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length == 0.0f) {
+            continue;
+        }
+        normals[t] = n / length;
+        Quadric q = Quadric::plane(glm::dvec3(normals[t]), -glm::dot(glm::dvec3(normals[t]), glm::dvec3(a)), 1.0);
+        for (int k = 0; k < 3; k++) {
+            quadrics[tris[t * 3 + k]] += q;
+        }
+    }
+
+    // Aristas con un solo triángulo (borde) o más de dos (no manifold): planos perpendiculares que las conservan
+    auto edgeKey = [](uint32_t a, uint32_t b) {
+        return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+    };
+    std::unordered_map<uint64_t, std::pair<int, uint32_t>> edges; // arista -> (triángulos, último triángulo)
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            auto& entry = edges[edgeKey(tris[t * 3 + k], tris[t * 3 + (k + 1) % 3])];
+            entry.first++;
+            entry.second = t;
+        }
+    }
+    for (const auto& [key, entry] : edges) {
+        if (entry.first == 2) {
+            continue;
+        }
+        uint32_t a = static_cast<uint32_t>(key >> 32);
+        uint32_t b = static_cast<uint32_t>(key & 0xFFFFFFFFu);
+        glm::dvec3 edge = glm::dvec3(positions[b]) - glm::dvec3(positions[a]);
+        glm::dvec3 n = glm::cross(edge, glm::dvec3(normals[entry.second]));
+        double length = glm::length(n);
+        if (length == 0.0) {
+            continue;
+        }
+        n /= length;
+        Quadric q = Quadric::plane(n, -glm::dot(n, glm::dvec3(positions[a])), SIMPLIFY_BORDER_WEIGHT);
+        quadrics[a] += q;
+        quadrics[b] += q;
+    }
+
+    // Cola de colapsos candidatos; las entradas viejas se reconocen por la versión de sus vértices
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+        bool operator>(const Collapse& o) const {
+            return cost > o.cost;
+        }
+    };
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    std::vector<uint32_t> version(positions.size(), 0);
+    std::vector<bool> removed(positions.size(), false);
+
+    auto pushEdge = [&](uint32_t a, uint32_t b) {
+        Quadric q = quadrics[a];
+        q += quadrics[b];
+        double toB = q.error(positions[b]);
+        double toA = q.error(positions[a]);
+        if (toB <= toA) {
+            queue.push(Collapse{toB, a, b, version[a], version[b]});
+        } else {
+            queue.push(Collapse{toA, b, a, version[b], version[a]});
+        }
+    };
+    for (const auto& [key, entry] : edges) {
+        pushEdge(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key & 0xFFFFFFFFu));
+    }
+
+    std::vector<uint32_t> fromNeighbors;
+    std::vector<uint32_t> toNeighbors;
+    auto collectNeighbors = [&](uint32_t v, std::vector<uint32_t>& out) {
+        out.clear();
+        for (uint32_t t : vertexTriangles[v]) {
+            if (!alive[t]) {
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                if (tris[t * 3 + k] != v) {
+                    out.push_back(tris[t * 3 + k]);
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    };
+
+    while (aliveCount > targetTriangles && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+        uint32_t from = collapse.from;
+        uint32_t to = collapse.to;
+        if (removed[from] || removed[to] || version[from] != collapse.fromVersion || version[to] != collapse.toVersion) {
+            continue;
+        }
+
+        // Condición de enlace: los vecinos comunes deben ser solo los opuestos a la arista
+        size_t shared = 0;
+        for (uint32_t t : vertexTriangles[from]) {
+            if (alive[t] && (tris[t * 3] == to || tris[t * 3 + 1] == to || tris[t * 3 + 2] == to)) {
+                shared++;
+            }
+        }
+        if (shared == 0) {
+            continue;
+        }
+        collectNeighbors(from, fromNeighbors);
+        collectNeighbors(to, toNeighbors);
+        size_t common = 0;
+        for (size_t i = 0, j = 0; i < fromNeighbors.size() && j < toNeighbors.size();) {
+            if (fromNeighbors[i] < toNeighbors[j]) {
+                i++;
+            } else if (fromNeighbors[i] > toNeighbors[j]) {
+                j++;
+            } else {
+                common++;
+                i++;
+                j++;
+            }
+        }
+        if (common > shared) {
+            continue;
+        }
+
+        // Rechazar colapsos que dan vuelta o degeneran triángulos vecinos
+        bool flips = false;
+        for (uint32_t t : vertexTriangles[from]) {
+            if (!alive[t] || tris[t * 3] == to || tris[t * 3 + 1] == to || tris[t * 3 + 2] == to) {
+                continue;
+            }
+            glm::vec3 p[3];
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = tris[t * 3 + k];
+                p[k] = positions[v == from ? to : v];
+            }
+            glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+            float length = glm::length(n);
+            if (length == 0.0f || glm::dot(n / length, normals[t]) < SIMPLIFY_MIN_NORMAL_DOT) {
+                flips = true;
+                break;
+            }
+        }
+        if (flips) {
+            continue;
+        }
+
+        // Aplicar el colapso
+        for (uint32_t t : vertexTriangles[from]) {
+            if (!alive[t]) {
+                continue;
+            }
+            if (tris[t * 3] == to || tris[t * 3 + 1] == to || tris[t * 3 + 2] == to) {
+                alive[t] = false;
+                aliveCount--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                if (tris[t * 3 + k] == from) {
+                    tris[t * 3 + k] = to;
+                }
+            }
+            glm::vec3 a = positions[tris[t * 3]], b = positions[tris[t * 3 + 1]], c = positions[tris[t * 3 + 2]];
+            normals[t] = glm::normalize(glm::cross(b - a, c - a));
+            vertexTriangles[to].push_back(t);
+        }
+        vertexTriangles[from].clear();
+        removed[from] = true;
+        quadrics[to] += quadrics[from];
+        version[to]++;
+        outError = std::max(outError, static_cast<float>(std::sqrt(collapse.cost)));
+
+        // Compactar la lista del vértice que queda y volver a evaluar sus aristas
+        auto& list = vertexTriangles[to];
+        list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t t) { return !alive[t]; }), list.end());
+        collectNeighbors(to, toNeighbors);
+        for (uint32_t neighbor : toNeighbors) {
+            pushEdge(to, neighbor);
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(aliveCount * 3);
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (alive[t]) {
+            output.insert(output.end(), tris.begin() + t * 3, tris.begin() + t * 3 + 3);
+        }
+    }
+    return output;
+}
+
+// Triángulos y error de un nivel de la cadena
+struct LODLevelStats {
+    size_t triangles = 0;
+    float error = 0.0f; // Error geométrico acumulado respecto de la malla original (0 en el nivel 0)
+};
+
+// Función para generar la cadena de niveles de detalle de una malla ya optimizada.
+// Cada nivel intenta quedarse con 'ratio' de los triángulos del anterior; la cadena termina al llegar a
+// 'maxLevels' niveles, a menos de 'minTriangles' triángulos o cuando la simplificación deja de avanzar.
+// Al final reordena los vértices (con sus atributos) para que los vértices de cada nivel sean un prefijo de Mesh::positions.
+// Devuelve los triángulos y el error de cada nivel, empezando por la propia malla, para que quien llama los informe.
+std::vector<LODLevelStats> generateLODs(Mesh& mesh, int maxLevels = 4, float ratio = 0.5f, size_t minTriangles = 32) {
+    mesh.lods.clear();
+    const std::vector<uint32_t>* previous = &mesh.indices;
+    float previousError = 0.0f;
+
+    for (int level = 0; level < maxLevels; level++) {
+        size_t previousTriangles = previous->size() / 3;
+        size_t target = static_cast<size_t>(static_cast<float>(previousTriangles) * ratio);
+        if (target < minTriangles) {
+            break;
+        }
+
+        float error = 0.0f;
+        Mesh simplified;
+        simplified.positions = mesh.positions;
+        simplified.indices = simplifyIndices(mesh.positions, *previous, target, error);
+        if (simplified.triangleCount() * 10 > previousTriangles * 9) {
+            break;
+        }
+        optimizeVertexCache(simplified);
+
+        MeshLOD lod;
+        lod.indices.swap(simplified.indices);
+        lod.error = std::max(previousError, error);
+        mesh.lods.push_back(std::move(lod));
+        previous = &mesh.lods.back().indices;
+        previousError = mesh.lods.back().error;
+    }
+
+    // Posiciones en orden de primer uso, empezando por el nivel más simple
+    const uint32_t unused = UINT32_MAX;
+    std::vector<uint32_t> remap(mesh.positions.size(), unused);
+    std::vector<uint32_t> order;
+    order.reserve(mesh.positions.size());
+    auto assign = [&](const std::vector<uint32_t>& indices) {
+        for (uint32_t index : indices) {
+            if (remap[index] == unused) {
+                remap[index] = static_cast<uint32_t>(order.size());
+                order.push_back(index);
+            }
+        }
+        return static_cast<uint32_t>(order.size());
+    };
+    for (size_t level = mesh.lods.size(); level-- > 0;) {
+        mesh.lods[level].vertexCount = assign(mesh.lods[level].indices);
+    }
+    assign(mesh.indices);
+
+    for (uint32_t& index : mesh.indices) {
+        index = remap[index];
+    }
+    for (MeshLOD& lod : mesh.lods) {
+        for (uint32_t& index : lod.indices) {
+            index = remap[index];
+        }
+    }
+    for (uint32_t& index : mesh.meshletVertices) {
+        index = remap[index];
+    }
+    mesh.reorderVertices(order);
+
+    std::vector<LODLevelStats> levels;
+    levels.push_back(LODLevelStats{mesh.triangleCount(), 0.0f});
+    for (const MeshLOD& lod : mesh.lods) {
+        levels.push_back(LODLevelStats{lod.indices.size() / 3, lod.error});
+    }
+    return levels;
+}
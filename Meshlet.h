@@ -0,0 +1,230 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Mesh.h"
+#include "Framebuffer.h"
+#include "Frustum.h"
+
+// Grupos pequeños de triángulos ("meshlets") con volúmenes para descartarlos enteros antes de
+// transformar sus vértices: esfera envolvente (frustum y oclusión) y cono de normales (caras traseras).
+
+// Límites por grupo: caben en índices locales de 8 bits y en la caché de vértices transformados
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// Función para calcular la esfera envolvente y el cono de normales de un grupo
+void computeMeshletBounds(const Mesh& mesh, Meshlet& meshlet) {
+    // Esfera: centro de la caja envolvente y distancia máxima a él
+    glm::vec3 minP(std::numeric_limits<float>::max());
+    glm::vec3 maxP(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        const glm::vec3& p = mesh.positions[mesh.meshletVertices[meshlet.vertexOffset + i]];
+        minP = glm::min(minP, p);
+        maxP = glm::max(maxP, p);
+    }
+    meshlet.center = (minP + maxP) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        const glm::vec3& p = mesh.positions[mesh.meshletVertices[meshlet.vertexOffset + i]];
+        meshlet.radius = std::max(meshlet.radius, glm::length(p - meshlet.center));
+    }
+
+    // Cono: eje promedio de las normales y el ángulo que las abarca a todas
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> points;
+    glm::vec3 axis(0.0f);
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+        const uint8_t* local = &mesh.meshletTriangles[(meshlet.triangleOffset + t) * 3];
+        const glm::vec3& a = mesh.positions[mesh.meshletVertices[meshlet.vertexOffset + local[0]]];
+        const glm::vec3& b = mesh.positions[mesh.meshletVertices[meshlet.vertexOffset + local[1]]];
+        const glm::vec3& c = mesh.positions[mesh.meshletVertices[meshlet.vertexOffset + local[2]]];
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length > 0.0f) {
+            normals.push_back(n / length);
+            points.push_back(a);
+            axis += n / length;
+        }
+    }
+
+    // Sin cono útil: el grupo nunca se descarta por orientación
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    meshlet.coneApex = meshlet.center;
+
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength == 0.0f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& n : normals) {
+        minDot = std::min(minDot, glm::dot(n, axis));
+    }
+    // Si las normales abarcan más de ~84° respecto al eje, el cono no puede descartar nada con seguridad
+    if (minDot <= 0.1f) {
+        return;
+    }
+
+    // Vértice del cono: punto sobre el eje detrás del cual ningún triángulo puede verse de frente
+    float maxT = 0.0f;
+    for (size_t i = 0; i < normals.size(); i++) {
+        float t = glm::dot(points[i] - meshlet.center, normals[i]) / glm::dot(axis, normals[i]);
+        maxT = std::max(maxT, t);
+    }
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    meshlet.coneApex = meshlet.center - axis * maxT;
+}
+
+// Función para construir los grupos recorriendo el búfer de índices en orden.
+// Conviene llamarla después de optimizeVertexCache(): triángulos vecinos en el búfer comparten vértices.
+void buildMeshlets(Mesh& mesh) {
+    mesh.meshlets.clear();
+    mesh.meshletVertices.clear();
+    mesh.meshletTriangles.clear();
+
+    const uint8_t unused = 0xFF;
+    std::vector<uint8_t> localIndex(mesh.positions.size(), unused);
+    Meshlet current{};
+
+    auto finish = [&]() {
+        if (current.triangleCount == 0) {
+            return;
+        }
+        for (uint32_t i = 0; i < current.vertexCount; i++) {
+            localIndex[mesh.meshletVertices[current.vertexOffset + i]] = unused;
+        }
+        computeMeshletBounds(mesh, current);
+        mesh.meshlets.push_back(current);
+        current = Meshlet{};
+        current.vertexOffset = static_cast<uint32_t>(mesh.meshletVertices.size());
+        current.triangleOffset = static_cast<uint32_t>(mesh.meshletTriangles.size() / 3);
+    };
+
+    for (size_t t = 0; t < mesh.triangleCount(); t++) {
+        uint32_t tri[3] = {mesh.indices[t * 3], mesh.indices[t * 3 + 1], mesh.indices[t * 3 + 2]};
+        uint32_t newVertices = 0;
+        for (int k = 0; k < 3; k++) {
+            bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+            if (localIndex[tri[k]] == unused && !repeated) {
+                newVertices++;
+            }
+        }
+        if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount + 1 > MESHLET_MAX_TRIANGLES) {
+            finish();
+        }
+
+        for (uint32_t v : tri) {
+            if (localIndex[v] == unused) {
+                localIndex[v] = static_cast<uint8_t>(current.vertexCount++);
+                mesh.meshletVertices.push_back(v);
+            }
+            mesh.meshletTriangles.push_back(localIndex[v]);
+        }
+        current.triangleCount++;
+    }
+    finish();
+}
+
+// Prueba de cono: true si todos los triángulos del grupo miran en dirección contraria a la cámara
+bool meshletBackFacing(const Meshlet& meshlet, const glm::vec3& cameraPosition) {
+    glm::vec3 toApex = meshlet.coneApex - cameraPosition;
+    float length = glm::length(toApex);
+    return length > 0.0f && glm::dot(toApex / length, meshlet.coneAxis) >= meshlet.coneCutoff;
+}
+
+// Z jerárquico de dos niveles con la profundidad máxima de cada bloque de la pantalla.
+// Un grupo está oculto si su punto más cercano queda detrás del máximo de todos los bloques que cubre.
+struct HierarchicalZ {
+    static const int FINE = 8;    // Lado en píxeles de un bloque fino
+    static const int COARSE = 8;  // Bloques finos por lado de un bloque grueso
+
+    int fineWidth = 0;
+    int fineHeight = 0;
+    int coarseWidth = 0;
+    int coarseHeight = 0;
+    std::vector<float> fine;
+    std::vector<float> coarse;
+
+    // Prepara los niveles para el tamaño del framebuffer; todos los bloques empiezan "vacíos"
+    void reset(int width, int height) {
+        fineWidth = (width + FINE - 1) / FINE;
+        fineHeight = (height + FINE - 1) / FINE;
+        coarseWidth = (fineWidth + COARSE - 1) / COARSE;
+        coarseHeight = (fineHeight + COARSE - 1) / COARSE;
+        fine.assign(static_cast<size_t>(fineWidth) * fineHeight, DEPTH_CLEAR);
+        coarse.assign(static_cast<size_t>(coarseWidth) * coarseHeight, DEPTH_CLEAR);
+    }
+
+    // Recalcula los bloques que tocan el rectángulo [x0, x1] x [y0, y1] a partir del z-buffer
+    void update(const Framebuffer& fb, int x0, int y0, int x1, int y1) {
+        int tx0 = std::max(x0, 0) / FINE;
+        int ty0 = std::max(y0, 0) / FINE;
+        int tx1 = std::min(x1, fb.width - 1) / FINE;
+        int ty1 = std::min(y1, fb.height - 1) / FINE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                float maxDepth = std::numeric_limits<float>::lowest();
+                int yEnd = std::min((ty + 1) * FINE, fb.height);
+                int xEnd = std::min((tx + 1) * FINE, fb.width);
+                for (int y = ty * FINE; y < yEnd; y++) {
+                    for (int x = tx * FINE; x < xEnd; x++) {
+                        maxDepth = std::max(maxDepth, fb.depthAt(x, y));
+                    }
+                }
+                fine[static_cast<size_t>(ty) * fineWidth + tx] = maxDepth;
+            }
+        }
+        for (int cy = ty0 / COARSE; cy <= ty1 / COARSE; cy++) {
+            for (int cx = tx0 / COARSE; cx <= tx1 / COARSE; cx++) {
+                float maxDepth = std::numeric_limits<float>::lowest();
+                for (int ty = cy * COARSE; ty < std::min((cy + 1) * COARSE, fineHeight); ty++) {
+                    for (int tx = cx * COARSE; tx < std::min((cx + 1) * COARSE, fineWidth); tx++) {
+                        maxDepth = std::max(maxDepth, fine[static_cast<size_t>(ty) * fineWidth + tx]);
+                    }
+                }
+                coarse[static_cast<size_t>(cy) * coarseWidth + cx] = maxDepth;
+            }
+        }
+    }
+
+    // true si el rectángulo de pantalla, con profundidad mínima 'nearestDepth', queda completamente oculto
+    bool occluded(int x0, int y0, int x1, int y1, float nearestDepth) const {
+        int tx0 = std::max(x0, 0) / FINE;
+        int ty0 = std::max(y0, 0) / FINE;
+        int tx1 = std::min(x1 / FINE, fineWidth - 1);
+        int ty1 = std::min(y1 / FINE, fineHeight - 1);
+        if (tx0 > tx1 || ty0 > ty1) {
+            return false;
+        }
+
+        // Primero el nivel grueso: si basta, evita recorrer muchos bloques finos
+        bool coarseOccluded = true;
+        for (int cy = ty0 / COARSE; cy <= ty1 / COARSE && coarseOccluded; cy++) {
+            for (int cx = tx0 / COARSE; cx <= tx1 / COARSE; cx++) {
+                if (nearestDepth <= coarse[static_cast<size_t>(cy) * coarseWidth + cx]) {
+                    coarseOccluded = false;
+                    break;
+                }
+            }
+        }
+        if (coarseOccluded) {
+            return true;
+        }
+
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                if (nearestDepth <= fine[static_cast<size_t>(ty) * fineWidth + tx]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
@@ -0,0 +1,296 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "ShaderUtilities.h"
+#include "Framebuffer.h"
+#include "Profiler.h"
+#include "PipelineStats.h"
+#include "PipelineState.h"
+#include "Interpolation.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SR_MULTISAMPLE_SSE2 1
+#else
+#define SR_MULTISAMPLE_SSE2 0
+#endif
+
+// Antialiasing por multimuestreo (MSAA). Cada píxel guarda N muestras de color y profundidad; la cobertura se
+// evalúa con las funciones de arista en las N posiciones de muestra, pero el color de un triángulo plano se
+// calcula una sola vez y se copia a las muestras cubiertas, así que un borde cuesta N pruebas y no N
+// sombreados. resolveMultisample() promedia las muestras de cada píxel en un Framebuffer normal.
+//
+// El framebuffer lleva un estado por mosaico de 8x8 píxeles. Limpiar solo marca los mosaicos como limpios,
+// sin tocar las muestras: el primer triángulo que llega a uno lo rellena, y la resolución escribe el color de
+// limpieza en los que ninguno tocó. Mientras ningún triángulo cubra un píxel del mosaico solo en parte, todas
+// las muestras de cada píxel son iguales y la resolución copia la primera en lugar de promediar; solo los
+// mosaicos con bordes pagan el promedio.
+
+const int MULTISAMPLE_TILE_SIZE = 8;
+
+enum class SampleTile : uint8_t {
+    Cleared, // Sin triángulos desde la limpieza: las muestras no están escritas
+    Uniform, // Las muestras de cada píxel son iguales
+    Edges    // Algún píxel puede tener muestras distintas
+};
+
+// Posiciones de muestra estándar de Direct3D (en 1/16 de píxel respecto al centro) para 2, 4 y 8 muestras
+const int MULTISAMPLE_PATTERN_2[2][2] = {{4, 4}, {-4, -4}};
+const int MULTISAMPLE_PATTERN_4[4][2] = {{-2, -6}, {6, -2}, {-6, 2}, {2, 6}};
+const int MULTISAMPLE_PATTERN_8[8][2] = {{1, -3}, {-1, 3}, {5, 1}, {-3, -5}, {-5, 5}, {-7, -1}, {3, 7}, {7, -7}};
+
+// Función para obtener la posición de la muestra s de un patrón de N muestras, relativa al centro del píxel
+template <int N>
+glm::vec2 samplePosition(int s) {
+    static_assert(N == 2 || N == 4 || N == 8, "solo hay patrones de 2, 4 y 8 muestras");
+    const int* offset = N == 2 ? MULTISAMPLE_PATTERN_2[s] : N == 4 ? MULTISAMPLE_PATTERN_4[s] : MULTISAMPLE_PATTERN_8[s];
+    return glm::vec2(offset[0], offset[1]) / 16.0f;
+}
+
+// Framebuffer con N muestras por píxel, guardadas juntas: las del píxel i son color[i * N .. i * N + N)
+struct MultisampleFramebuffer {
+    int width = 0;
+    int height = 0;
+    int samples = 0;
+    int tilesX = 0;
+    std::vector<Color> color;
+    std::vector<float> depth;
+    std::vector<SampleTile> tiles;
+    Color clearColor = Color(0, 0, 0, 0);
+
+    MultisampleFramebuffer() = default;
+
+    MultisampleFramebuffer(int w, int h, int n) {
+        resize(w, h, n);
+    }
+
+    // Cambia el tamaño y el número de muestras (2, 4 u 8; otros valores se redondean al siguiente)
+    void resize(int w, int h, int n) {
+        width = w;
+        height = h;
+        samples = n <= 2 ? 2 : n <= 4 ? 4 : 8;
+        tilesX = (w + MULTISAMPLE_TILE_SIZE - 1) / MULTISAMPLE_TILE_SIZE;
+        int tilesY = (h + MULTISAMPLE_TILE_SIZE - 1) / MULTISAMPLE_TILE_SIZE;
+        color.assign(static_cast<size_t>(w) * h * samples, Color(0, 0, 0, 0));
+        depth.assign(static_cast<size_t>(w) * h * samples, DEPTH_CLEAR);
+        tiles.assign(static_cast<size_t>(tilesX) * tilesY, SampleTile::Cleared);
+        clearColor = Color(0, 0, 0, 0);
+    }
+
+    // Limpia el color y la profundidad; solo cambia el estado de los mosaicos
+    void clear(const Color& c) {
+        clearColor = c;
+        std::fill(tiles.begin(), tiles.end(), SampleTile::Cleared);
+    }
+
+    // Escribe el color de limpieza y la profundidad máxima en las muestras del mosaico (tx, ty)
+    void fillTile(int tx, int ty) {
+        int x0 = tx * MULTISAMPLE_TILE_SIZE;
+        int x1 = std::min(x0 + MULTISAMPLE_TILE_SIZE, width);
+        int y1 = std::min((ty + 1) * MULTISAMPLE_TILE_SIZE, height);
+        for (int y = ty * MULTISAMPLE_TILE_SIZE; y < y1; y++) {
+            size_t begin = (static_cast<size_t>(y) * width + x0) * samples;
+            size_t end = (static_cast<size_t>(y) * width + x1) * samples;
+            std::fill(color.begin() + begin, color.begin() + end, clearColor);
+            std::fill(depth.begin() + begin, depth.begin() + end, DEPTH_CLEAR);
+        }
+        tiles[static_cast<size_t>(ty) * tilesX + tx] = SampleTile::Uniform;
+    }
+};
+
+// Función para rasterizar un triángulo plano en pantalla con N muestras por píxel, con el estado por defecto
+// del pipeline (sin descarte, profundidad Less con escritura). El color se calcula una vez por triángulo.
+template <int N>
+void rasterMultisample(MultisampleFramebuffer& ms, const Vertex& a, const Vertex& b, const Vertex& c, const Color& tint) {
+    const glm::vec3& A = a.position;
+    const glm::vec3& B = b.position;
+    const glm::vec3& C = c.position;
+    Color color = modulate(intensityColor(lightIntensity(glm::normalize(glm::cross(B - A, C - A)))), tint);
+
+    // Coordenadas baricéntricas y profundidad en el centro del píxel, y su diferencia en cada muestra
+    TriangleSetup setup(A, B, C);
+    PlaneSet<4> planes;
+    planes.set(0, setup.plane(1.0f, 0.0f, 0.0f));
+    planes.set(1, setup.plane(0.0f, 1.0f, 0.0f));
+    planes.set(2, setup.plane(0.0f, 0.0f, 1.0f));
+    planes.set(3, setup.plane(A.z, B.z, C.z));
+    std::array<std::array<float, N>, 4> offsets;
+    for (int s = 0; s < N; s++) {
+        glm::vec2 p = samplePosition<N>(s);
+        for (size_t k = 0; k < 4; k++) {
+            offsets[k][s] = planes.dx[k] * p.x + planes.dy[k] * p.y;
+        }
+    }
+
+    // Caja de las muestras: las de un píxel llegan hasta medio píxel del centro
+    int minX = std::max(static_cast<int>(std::floor(std::min({A.x, B.x, C.x}) - 0.5f)), 0);
+    int minY = std::max(static_cast<int>(std::floor(std::min({A.y, B.y, C.y}) - 0.5f)), 0);
+    int maxX = std::min(static_cast<int>(std::ceil(std::max({A.x, B.x, C.x}) + 0.5f)), ms.width - 1);
+    int maxY = std::min(static_cast<int>(std::ceil(std::max({A.y, B.y, C.y}) + 0.5f)), ms.height - 1);
+    constexpr uint32_t fullMask = (1u << N) - 1;
+
+    std::array<float, 4> center;
+    for (int y = minY; y <= maxY; y++) {
+        planes.evaluate(static_cast<float>(minX), static_cast<float>(y), center);
+        size_t row = static_cast<size_t>(y) * ms.width;
+        int ty = y / MULTISAMPLE_TILE_SIZE;
+        SampleTile* tileRow = &ms.tiles[static_cast<size_t>(ty) * ms.tilesX];
+        for (int x = minX; x <= maxX; x++, planes.stepX(center)) {
+            STATS(pipelineStats.boxPixels++);
+            uint32_t covered = 0;
+            for (int s = 0; s < N; s++) {
+                bool inside = center[0] + offsets[0][s] >= 0 && center[1] + offsets[1][s] >= 0 && center[2] + offsets[2][s] >= 0;
+                covered |= static_cast<uint32_t>(inside) << s;
+            }
+            if (covered == 0) {
+                continue;
+            }
+            STATS(pipelineStats.coveredPixels++);
+            int tx = x / MULTISAMPLE_TILE_SIZE;
+            if (tileRow[tx] == SampleTile::Cleared) {
+                ms.fillTile(tx, ty);
+            }
+
+            Color* pixelColor = &ms.color[(row + x) * N];
+            float* pixelDepth = &ms.depth[(row + x) * N];
+            uint32_t written = 0;
+            for (int s = 0; s < N; s++) {
+                float z = center[3] + offsets[3][s];
+                bool passed = ((covered >> s) & 1) && z < pixelDepth[s];
+                pixelDepth[s] = passed ? z : pixelDepth[s];
+                pixelColor[s] = passed ? color : pixelColor[s];
+                written |= static_cast<uint32_t>(passed) << s;
+            }
+            // Un píxel escrito solo en parte puede tener muestras distintas
+            if (written != 0 && written != fullMask) {
+                tileRow[tx] = SampleTile::Edges;
+            }
+        }
+    }
+}
+
+// Función para dibujar una malla indexada en un framebuffer multimuestra, con iluminación por cara
+void renderMultisample(MultisampleFramebuffer& ms, const Mesh& mesh, const Uniform& uniform, const Color& tint = Color(255, 255, 255)) {
+    PROFILE_ZONE("render");
+    std::vector<Vertex> transformed(mesh.positions.size());
+    {
+        PROFILE_ZONE("vertexShader");
+        for (size_t i = 0; i < mesh.positions.size(); i++) {
+            transformed[i] = vertexShader(Vertex{mesh.positions[i], Color(255, 255, 255)}, uniform);
+        }
+        STATS(pipelineStats.verticesShaded += mesh.positions.size());
+        STATS(pipelineStats.trianglesAssembled += mesh.triangleCount());
+    }
+
+    PROFILE_ZONE("rasterize");
+    auto rasterAll = [&](auto raster) {
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const Vertex& a = transformed[mesh.indices[i]];
+            const Vertex& b = transformed[mesh.indices[i + 1]];
+            const Vertex& c = transformed[mesh.indices[i + 2]];
+            if (!triangleOnScreen(a, b, c, ms.width, ms.height)) {
+                STATS(pipelineStats.trianglesCulled++);
+                continue;
+            }
+            raster(ms, a, b, c, tint);
+        }
+    };
+    switch (ms.samples) {
+        case 2: rasterAll(&rasterMultisample<2>); break;
+        case 4: rasterAll(&rasterMultisample<4>); break;
+        default: rasterAll(&rasterMultisample<8>); break;
+    }
+}
+
+// Función para promediar las N muestras de un píxel (con redondeo), canal por canal
+template <int N>
+inline Color averageSamplesScalar(const Color* samples) {
+    int r = N / 2, g = N / 2, b = N / 2, a = N / 2;
+    for (int s = 0; s < N; s++) {
+        r += samples[s].r;
+        g += samples[s].g;
+        b += samples[s].b;
+        a += samples[s].a;
+    }
+    return Color(r / N, g / N, b / N, a / N);
+}
+
+// Función para promediar las N muestras de un píxel con SSE2; da lo mismo que averageSamplesScalar()
+template <int N>
+inline Color averageSamples(const Color* samples) {
+#if SR_MULTISAMPLE_SSE2
+    // Canales a 16 bits: cada registro suma dos muestras en sus mitades, que al final se juntan
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum;
+    if constexpr (N == 2) {
+        sum = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples)), zero);
+    } else {
+        sum = zero;
+        for (int s = 0; s < N; s += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + s));
+            sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)));
+        }
+    }
+    sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(N / 2)), N == 2 ? 1 : N == 4 ? 2 : 3);
+    uint32_t packed = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum)));
+    return Color(static_cast<int>(packed & 0xFF), static_cast<int>((packed >> 8) & 0xFF),
+                 static_cast<int>((packed >> 16) & 0xFF), static_cast<int>(packed >> 24));
+#else
+    return averageSamplesScalar<N>(samples);
+#endif
+}
+
+template <int N>
+void resolveSamples(const MultisampleFramebuffer& ms, Framebuffer& fb) {
+    int tilesY = (ms.height + MULTISAMPLE_TILE_SIZE - 1) / MULTISAMPLE_TILE_SIZE;
+    for (int ty = 0; ty < tilesY; ty++) {
+        int y0 = ty * MULTISAMPLE_TILE_SIZE;
+        int y1 = std::min(y0 + MULTISAMPLE_TILE_SIZE, ms.height);
+        for (int tx = 0; tx < ms.tilesX; tx++) {
+            int x0 = tx * MULTISAMPLE_TILE_SIZE;
+            int x1 = std::min(x0 + MULTISAMPLE_TILE_SIZE, ms.width);
+            SampleTile tile = ms.tiles[static_cast<size_t>(ty) * ms.tilesX + tx];
+            if (tile == SampleTile::Cleared) {
+                for (int y = y0; y < y1; y++) {
+                    size_t row = static_cast<size_t>(y) * ms.width;
+                    std::fill(fb.color.begin() + row + x0, fb.color.begin() + row + x1, ms.clearColor);
+                    std::fill(fb.depth.begin() + row + x0, fb.depth.begin() + row + x1, DEPTH_CLEAR);
+                }
+                continue;
+            }
+            bool edges = tile == SampleTile::Edges;
+            for (int y = y0; y < y1; y++) {
+                size_t row = static_cast<size_t>(y) * ms.width;
+                for (int x = x0; x < x1; x++) {
+                    const Color* samples = &ms.color[(row + x) * N];
+                    const float* depths = &ms.depth[(row + x) * N];
+                    fb.color[row + x] = edges ? averageSamples<N>(samples) : samples[0];
+                    float nearest = depths[0];
+                    for (int s = 1; s < N; s++) {
+                        nearest = std::min(nearest, depths[s]);
+                    }
+                    fb.depth[row + x] = nearest;
+                }
+            }
+        }
+    }
+}
+
+// Función para resolver el framebuffer multimuestra en 'fb' (del mismo tamaño): el color es el promedio de
+// las muestras (la primera en los mosaicos sin bordes y el de limpieza en los que no tocó ningún triángulo) y
+// la profundidad la de la muestra más cercana
+void resolveMultisample(const MultisampleFramebuffer& ms, Framebuffer& fb) {
+    PROFILE_ZONE("resolve");
+    switch (ms.samples) {
+        case 2: resolveSamples<2>(ms, fb); break;
+        case 4: resolveSamples<4>(ms, fb); break;
+        default: resolveSamples<8>(ms, fb); break;
+    }
+}
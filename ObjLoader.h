@@ -5,18 +5,70 @@
 #include <sstream>
 #include <fstream>
 #include <array>
+#include <limits>
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
 // Definición de una estructura 'Face' que representa una cara del modelo 3D
 struct Face {
-    std::vector<std::array<int, 3>> vertexIndices; // Índices de los vértices de la cara
+    std::vector<std::array<int, 3>> vertexIndices; // Índices de posición, coordenada de textura y normal de cada vértice
 };
 
-// Función para cargar un archivo OBJ y extraer vértices y caras
-bool loadOBJ(const std::string& path, std::vector<glm::vec3>& out_vertices, std::vector<Face>& out_faces) {
+// Caja envolvente alineada con los ejes
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    bool empty() const {
+        return min.x > max.x;
+    }
+
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const AABB& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    glm::vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+
+    // Caja que contiene a esta caja transformada por la matriz (método de Arvo, sin recorrer las 8 esquinas)
+    AABB transformed(const glm::mat4& m) const {
+        AABB result;
+        result.min = result.max = glm::vec3(m[3]);
+        for (int axis = 0; axis < 3; axis++) {
+            glm::vec3 a = glm::vec3(m[axis]) * min[axis];
+            glm::vec3 b = glm::vec3(m[axis]) * max[axis];
+            result.min += glm::min(a, b);
+            result.max += glm::max(a, b);
+        }
+        return result;
+    }
+};
+
+// Función para convertir un índice de una cara OBJ (base 1, o negativo relativo al final) a base 0; -1 si falta
+int objIndex(const std::string& token, size_t count) {
+    if (token.empty()) {
+        return -1;
+    }
+    int index = std::stoi(token);
+    return index > 0 ? index - 1 : static_cast<int>(count) + index;
+}
+
+// Función para cargar un archivo OBJ con sus coordenadas de textura (vt) y normales (vn).
+// Cada vértice de una cara guarda los índices de posición, coordenada y normal; los que faltan quedan en -1.
+bool loadOBJ(const std::string& path, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec2>& out_texcoords,
+             std::vector<glm::vec3>& out_normals, std::vector<Face>& out_faces, AABB& out_bounds) {
     out_vertices.clear();
+    out_texcoords.clear();
+    out_normals.clear();
     out_faces.clear();
+    out_bounds = AABB();
 
     // Abrir el archivo OBJ
     std::ifstream file(path);
@@ -35,19 +87,28 @@ bool loadOBJ(const std::string& path, std::vector<glm::vec3>& out_vertices, std:
             glm::vec3 vertex;
             iss >> vertex.x >> vertex.y >> vertex.z;
             out_vertices.push_back(vertex);
+            out_bounds.expand(vertex);
+        } else if (type == "vt") { // Coordenada de textura
+            glm::vec2 texcoord;
+            iss >> texcoord.x >> texcoord.y;
+            out_texcoords.push_back(texcoord);
+        } else if (type == "vn") { // Normal
+            glm::vec3 normal;
+            iss >> normal.x >> normal.y >> normal.z;
+            out_normals.push_back(normal);
         } else if (type == "f") { // Si la línea contiene una cara
             std::string lineHeader;
             Face face;
+            const size_t counts[3] = {out_vertices.size(), out_texcoords.size(), out_normals.size()};
             while (iss >> lineHeader)
             {
                 std::istringstream tokenstream(lineHeader);
                 std::string token;
-                std::array<int, 3> vertexIndices{};
+                std::array<int, 3> vertexIndices = {-1, -1, -1};
 
-                // Leer los tres valores separados por '/' para cada vértice de la cara
-                for (int i = 0; i < 3; ++i) {
-                    std::getline(tokenstream, token, '/');
-                    vertexIndices[i] = std::stoi(token) - 1; // Restar 1 para convertir a índices basados en 0
+                // Leer hasta tres valores separados por '/' (v, v/vt, v//vn o v/vt/vn)
+                for (int i = 0; i < 3 && std::getline(tokenstream, token, '/'); ++i) {
+                    vertexIndices[i] = objIndex(token, counts[i]);
                 }
 
                 face.vertexIndices.push_back(vertexIndices);
@@ -60,6 +121,19 @@ bool loadOBJ(const std::string& path, std::vector<glm::vec3>& out_vertices, std:
     return true;
 }
 
+// Función para cargar un archivo OBJ y extraer vértices, caras y la caja envolvente de los vértices
+bool loadOBJ(const std::string& path, std::vector<glm::vec3>& out_vertices, std::vector<Face>& out_faces, AABB& out_bounds) {
+    std::vector<glm::vec2> texcoords;
+    std::vector<glm::vec3> normals;
+    return loadOBJ(path, out_vertices, texcoords, normals, out_faces, out_bounds);
+}
+
+// Función para cargar un archivo OBJ y extraer vértices y caras
+bool loadOBJ(const std::string& path, std::vector<glm::vec3>& out_vertices, std::vector<Face>& out_faces) {
+    AABB bounds;
+    return loadOBJ(path, out_vertices, out_faces, bounds);
+}
+
 // Función para construir un arreglo de vértices a partir de vértices y caras
 std::vector<glm::vec3> setupVertexArray(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces) {
     std::vector<glm::vec3> vertexArray;
@@ -0,0 +1,87 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include "Framebuffer.h"
+
+// Utilidades para dibujar información de depuración directamente en el framebuffer.
+// Las escrituras ignoran el z-buffer para quedar siempre por encima de la escena.
+
+// Devuelve el glifo de 3x5 píxeles de un carácter (15 bits, fila superior en los bits más altos)
+uint16_t glyph3x5(char c) {
+    if (c >= 'a' && c <= 'z') {
+        c = static_cast<char>(c - 'a' + 'A');
+    }
+    switch (c) {
+        case '0': return 0x7B6F;
+        case '1': return 0x2C97;
+        case '2': return 0x73E7;
+        case '3': return 0x73CF;
+        case '4': return 0x5BC9;
+        case '5': return 0x79CF;
+        case '6': return 0x79EF;
+        case '7': return 0x7249;
+        case '8': return 0x7BEF;
+        case '9': return 0x7BCF;
+        case 'A': return 0x2BED;
+        case 'B': return 0x6BAE;
+        case 'C': return 0x3923;
+        case 'D': return 0x6B6E;
+        case 'E': return 0x79A7;
+        case 'F': return 0x79A4;
+        case 'G': return 0x396B;
+        case 'H': return 0x5BED;
+        case 'I': return 0x7497;
+        case 'J': return 0x126A;
+        case 'K': return 0x5BAD;
+        case 'L': return 0x4927;
+        case 'M': return 0x5FED;
+        case 'N': return 0x6B6D;
+        case 'O': return 0x2B6A;
+        case 'P': return 0x6BA4;
+        case 'Q': return 0x2B73;
+        case 'R': return 0x6BAD;
+        case 'S': return 0x388E;
+        case 'T': return 0x7492;
+        case 'U': return 0x5B6F;
+        case 'V': return 0x5B6A;
+        case 'W': return 0x5BFD;
+        case 'X': return 0x5AAD;
+        case 'Y': return 0x5A92;
+        case 'Z': return 0x72A7;
+        case '.': return 0x0002;
+        case ':': return 0x0410;
+        case '-': return 0x01C0;
+        case '/': return 0x12A4;
+        case '%': return 0x52A5;
+        case '=': return 0x0E38;
+        case '(': return 0x2922;
+        case ')': return 0x224A;
+        default: return 0x0000;
+    }
+}
+
+// Función para rellenar un rectángulo (recortado a los límites del framebuffer)
+void fillRect(Framebuffer& fb, int x0, int y0, int w, int h, const Color& color) {
+    int x1 = std::min(x0 + w, fb.width);
+    int y1 = std::min(y0 + h, fb.height);
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    for (int y = y0; y < y1; y++) {
+        std::fill(&fb.colorAt(x0, y), &fb.colorAt(x0, y) + std::max(x1 - x0, 0), color);
+    }
+}
+
+// Función para escribir texto con la fuente de 3x5; 'scale' agranda cada píxel del glifo
+void drawText(Framebuffer& fb, int x, int y, const std::string& text, const Color& color, int scale = 1) {
+    for (char c : text) {
+        uint16_t glyph = glyph3x5(c);
+        for (int row = 0; row < 5; row++) {
+            for (int col = 0; col < 3; col++) {
+                if (glyph & (1 << (14 - (row * 3 + col)))) {
+                    fillRect(fb, x + col * scale, y + row * scale, scale, scale, color);
+                }
+            }
+        }
+        x += 4 * scale;
+    }
+}
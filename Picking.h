@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "Framebuffer.h"
+#include "Scene.h"
+#include "Renderer.h"
+#include "VisibilityBuffer.h"
+#include "RayCaster.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+// Consultas por píxel sobre el cuadro ya dibujado: qué instancia y qué triángulo se ven en (x, y) y a qué
+// profundidad. Se responden en lotes repartidos entre hilos y sin volver a dibujar. Con el búfer de visibilidad
+// del cuadro (ver VisibilityBuffer.h) cada consulta es una lectura y una búsqueda entre las llamadas; sin él se
+// traza un rayo por consulta contra la jerarquía de instancias de la escena y las de triángulos de sus mallas
+// (ver RayCaster.h), que da el mismo resultado salvo en píxeles de borde.
+
+const size_t PICK_BATCH_SIZE = 256; // Consultas por tarea
+
+// Respuesta a una consulta
+struct PickResult {
+    bool hit = false;      // false si en el píxel no hay geometría (o está fuera de la pantalla)
+    uint32_t instance = 0; // VisibilityDraw::instance con el búfer de visibilidad; índice en Scene::instances con rayos
+    uint32_t triangle = 0; // Triángulo dentro de VisibilityDraw::indices, o de Mesh::levelIndices(level) con rayos
+    uint32_t level = 0;    // Nivel de detalle dibujado de la malla (0 con el búfer de visibilidad)
+    float depth = DEPTH_CLEAR;
+};
+
+// Función para responder las consultas con el búfer de visibilidad del cuadro
+void pickVisibility(const VisibilityBuffer& vb, const std::vector<glm::ivec2>& points, std::vector<PickResult>& results,
+                    ThreadPool& pool = threadPool()) {
+    PROFILE_ZONE("pick");
+    results.assign(points.size(), PickResult());
+    size_t tasks = (points.size() + PICK_BATCH_SIZE - 1) / PICK_BATCH_SIZE;
+    pool.run(tasks, [&](size_t task) {
+        size_t end = std::min(points.size(), (task + 1) * PICK_BATCH_SIZE);
+        for (size_t i = task * PICK_BATCH_SIZE; i < end; i++) {
+            glm::ivec2 p = points[i];
+            VisibilityHit hit;
+            if (p.x < 0 || p.y < 0 || p.x >= vb.ids.width || p.y >= vb.ids.height || !vb.hitAt(p.x, p.y, hit)) {
+                continue;
+            }
+            results[i] = PickResult{true, vb.draws[hit.draw].instance, hit.triangle, 0, hit.depth};
+        }
+    });
+}
+
+// Función para responder las consultas con rayos sobre la escena dibujada con renderScene(uniform) en un
+// framebuffer de width x height. Cada instancia se prueba con el nivel de detalle que eligió renderScene()
+// (selectLevel() con los mismos datos) y las mallas cuantizadas con las posiciones que decodificó. Las mallas
+// necesitan buildTriangleBVH() después de generateLODs() y quantizeMesh() (los niveles sin jerarquía no se ven);
+// la jerarquía de instancias se usa si está al día (updateBVH()) y si no se prueban todas las instancias.
+void pickScene(const Scene& scene, const Uniform& uniform, int width, int height, const std::vector<glm::ivec2>& points,
+               std::vector<PickResult>& results, ThreadPool& pool = threadPool()) {
+    PROFILE_ZONE("pick");
+    results.assign(points.size(), PickResult());
+    glm::mat4 viewProjection = uniform.viewport * uniform.projection * uniform.view;
+    glm::mat4 inverse = glm::inverse(viewProjection * uniform.model);
+    float nearZ = (uniform.viewport * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f)).z;
+    float farZ = (uniform.viewport * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)).z;
+    // El rayo se lleva al espacio de cada malla; su parámetro no cambia con una transformación afín
+    std::vector<glm::mat4> toModel(scene.instances.size());
+    std::vector<uint8_t> levels(scene.instances.size());
+    for (size_t i = 0; i < scene.instances.size(); i++) {
+        const Instance& instance = scene.instances[i];
+        toModel[i] = glm::inverse(instance.model);
+        levels[i] = static_cast<uint8_t>(selectLevel(scene.meshes[instance.mesh], uniform.view * uniform.model * instance.model,
+                                                     uniform.projection, height, scene.lodPixelError));
+    }
+    bool useBVH = !scene.bvh.empty() && !scene.bvhDirty;
+
+    size_t tasks = (points.size() + PICK_BATCH_SIZE - 1) / PICK_BATCH_SIZE;
+    pool.run(tasks, [&](size_t task) {
+        size_t end = std::min(points.size(), (task + 1) * PICK_BATCH_SIZE);
+        for (size_t i = task * PICK_BATCH_SIZE; i < end; i++) {
+            glm::ivec2 p = points[i];
+            // Los mismos píxeles que cubre la rasterización (ver rasterBounds())
+            if (p.x < 1 || p.y < 1 || p.x >= width || p.y >= height) {
+                continue;
+            }
+            glm::vec4 a = inverse * glm::vec4(static_cast<float>(p.x), static_cast<float>(p.y), nearZ, 1.0f);
+            glm::vec4 b = inverse * glm::vec4(static_cast<float>(p.x), static_cast<float>(p.y), farZ, 1.0f);
+            glm::vec3 origin = glm::vec3(a) / a.w;
+            glm::vec3 direction = glm::vec3(b) / b.w - origin;
+            RayPacket<1> ray;
+            setRay(ray, 0, origin, direction, 1.0f);
+            uint32_t instance = UINT32_MAX;
+
+            auto testInstance = [&](uint32_t index) {
+                const Mesh& mesh = scene.meshes[scene.instances[index].mesh];
+                if (mesh.levelBVH(levels[index]).empty()) {
+                    return;
+                }
+                RayPacket<1> local;
+                setRay(local, 0, glm::vec3(toModel[index] * glm::vec4(origin, 1.0f)),
+                       glm::vec3(toModel[index] * glm::vec4(direction, 0.0f)), ray.t[0]);
+                traversePacket(mesh, local, levels[index]);
+                if (local.triangle[0] != UINT32_MAX) {
+                    ray.t[0] = local.t[0];
+                    ray.triangle[0] = local.triangle[0];
+                    instance = index;
+                }
+            };
+
+            if (useBVH) {
+                // La jerarquía de instancias corta por la mediana: su profundidad no pasa de log2 de las instancias
+                uint32_t stack[64];
+                int top = 0;
+                stack[top++] = 0;
+                while (top > 0) {
+                    const BVHNode& node = scene.bvh.nodes[stack[--top]];
+                    if (!packetHitsBox(ray, node.bounds)) {
+                        continue;
+                    }
+                    if (node.left == 0) {
+                        for (uint32_t k = node.first; k < node.first + node.count; k++) {
+                            uint32_t item = scene.bvh.items[k];
+                            if (packetHitsBox(ray, scene.bvh.itemBounds[item])) {
+                                testInstance(item);
+                            }
+                        }
+                    } else {
+                        stack[top++] = node.left + 1;
+                        stack[top++] = node.left;
+                    }
+                }
+            } else {
+                for (uint32_t k = 0; k < scene.instances.size(); k++) {
+                    testInstance(k);
+                }
+            }
+            if (instance == UINT32_MAX) {
+                continue;
+            }
+
+            // Profundidad con las mismas matrices y fórmulas que el dibujo de la instancia
+            glm::mat4 transform = viewProjection * (uniform.model * scene.instances[instance].model);
+            glm::vec3 screen[3];
+            projectTriangle(scene.meshes[scene.instances[instance].mesh], transform, ray.triangle[0], screen, levels[instance]);
+            results[i] = PickResult{true, instance, ray.triangle[0], levels[instance], screenDepth(screen, p.x, p.y)};
+        }
+    });
+}
+
+// Función para responder las consultas sobre el cuadro: con el búfer de visibilidad si se dibujó con él ('vb'
+// no nulo y con llamadas, usando el índice de la instancia como VisibilityDraw::instance) o con rayos si no
+void pickFrame(const VisibilityBuffer* vb, const Scene& scene, const Uniform& uniform, int width, int height,
+               const std::vector<glm::ivec2>& points, std::vector<PickResult>& results, ThreadPool& pool = threadPool()) {
+    if (vb && !vb->draws.empty()) {
+        pickVisibility(*vb, points, results, pool);
+    } else {
+        pickScene(scene, uniform, width, height, points, results, pool);
+    }
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "ShaderUtilities.h"
+#include "Framebuffer.h"
+#include "PipelineStats.h"
+
+// Estado fijo del pipeline que se elige por llamada de dibujo. Cada combinación se compila como una
+// instancia distinta de rasterTriangle(): las decisiones de estado se toman al compilar y el bucle por
+// píxel solo contiene las operaciones de esa combinación. Las funciones de dibujo buscan el núcleo una
+// vez con selectRasterKernel() y lo llaman por triángulo a través de un puntero.
+
+// Caras que se descartan según el sentido de sus vértices en pantalla (antihorario = frontal)
+enum class CullMode : uint8_t { None, Back, Front };
+
+// Comparación de la profundidad del fragmento contra la del z-buffer
+enum class DepthFunc : uint8_t { Less, LessEqual, Always };
+
+// Cómo se calcula el color del triángulo
+enum class ShadingModel : uint8_t {
+    Flat,  // Iluminación por cara con la luz global (el sombreado original)
+    Unlit  // Color del primer vértice, sin iluminación
+};
+
+// Búferes que escribe el núcleo
+enum class OutputFormat : uint8_t {
+    Color,    // Color y profundidad
+    DepthOnly // Solo profundidad (pasadas previas de Z, mapas de sombras)
+};
+
+const int CULL_MODE_COUNT = 3;
+const int DEPTH_FUNC_COUNT = 3;
+const int SHADING_MODEL_COUNT = 2;
+const int OUTPUT_FORMAT_COUNT = 2;
+
+struct PipelineState {
+    CullMode cull = CullMode::None;
+    DepthFunc depthFunc = DepthFunc::Less;
+    bool depthWrite = true;
+    ShadingModel shading = ShadingModel::Flat;
+    OutputFormat output = OutputFormat::Color;
+};
+
+// Función para multiplicar un color sombreado por el color de una instancia
+Color modulate(const Color& color, const Color& tint) {
+    return Color(color.r * tint.r / 255, color.g * tint.g / 255, color.b * tint.b / 255, color.a);
+}
+
+template <DepthFunc Func>
+inline bool depthTest(float z, float stored) {
+    if constexpr (Func == DepthFunc::Less) {
+        return z < stored;
+    } else if constexpr (Func == DepthFunc::LessEqual) {
+        return z <= stored;
+    } else {
+        return true;
+    }
+}
+
+// Función para saber si el modo de descarte elimina el triángulo de vértices A, B, C (en pantalla)
+template <CullMode Cull>
+inline bool faceCulled(const glm::vec3& A, const glm::vec3& B, const glm::vec3& C) {
+    if constexpr (Cull == CullMode::None) {
+        return false;
+    } else {
+        float area = (B.x - A.x) * (C.y - A.y) - (C.x - A.x) * (B.y - A.y);
+        return Cull == CullMode::Back ? area < 0.0f : area > 0.0f;
+    }
+}
+
+// Rectángulo de píxeles, con los extremos incluidos
+struct PixelRect {
+    int minX, minY, maxX, maxY;
+};
+
+// Función para obtener los píxeles que un triángulo puede cubrir: su caja recortada a 0 < x < ancho y
+// 0 < y < alto, que es lo que point() acepta
+PixelRect rasterBounds(const Framebuffer& fb, const glm::vec3& A, const glm::vec3& B, const glm::vec3& C) {
+    float width = static_cast<float>(fb.width);
+    float height = static_cast<float>(fb.height);
+    return PixelRect{
+            static_cast<int>(std::clamp(std::floor(std::min(std::min(A.x, B.x), C.x)), 1.0f, width)),
+            static_cast<int>(std::clamp(std::floor(std::min(std::min(A.y, B.y), C.y)), 1.0f, height)),
+            static_cast<int>(std::clamp(std::ceil(std::max(std::max(A.x, B.x), C.x)), 0.0f, width - 1)),
+            static_cast<int>(std::clamp(std::ceil(std::max(std::max(A.y, B.y), C.y)), 0.0f, height - 1))
+    };
+}
+
+// Función para rasterizar un triángulo en pantalla directamente sobre el framebuffer.
+// Con el estado por defecto produce los mismos píxeles que triangle() seguido de point(); el color,
+// constante en el triángulo, se calcula una sola vez antes del bucle.
+template <CullMode Cull, DepthFunc Func, bool DepthWrite, ShadingModel Shading, OutputFormat Output>
+void rasterTriangle(Framebuffer& fb, const Vertex& a, const Vertex& b, const Vertex& c, const Color& tint) {
+    glm::vec3 A = a.position;
+    glm::vec3 B = b.position;
+    glm::vec3 C = c.position;
+
+    if (faceCulled<Cull>(A, B, C)) {
+        STATS(pipelineStats.trianglesCulled++);
+        return;
+    }
+
+    Color color;
+    if constexpr (Output == OutputFormat::Color) {
+        if constexpr (Shading == ShadingModel::Flat) {
+            color = intensityColor(lightIntensity(glm::normalize(glm::cross(B - A, C - A))));
+        } else {
+            color = a.color;
+        }
+        color = modulate(color, tint);
+    }
+
+    PixelRect box = rasterBounds(fb, A, B, C);
+    for (int y = box.minY; y <= box.maxY; y++) {
+        float* depthRow = &fb.depth[static_cast<size_t>(y) * fb.width];
+        Color* colorRow = &fb.color[static_cast<size_t>(y) * fb.width];
+        for (int x = box.minX; x <= box.maxX; x++) {
+            STATS(pipelineStats.boxPixels++);
+            glm::vec3 bar = barycentricCoordinates(glm::vec3(x, y, 0), A, B, C);
+            bool inside = bar.x <= 1 && bar.x >= 0 && bar.y <= 1 && bar.y >= 0 && bar.z <= 1 && bar.z >= 0;
+            float z = A.z * bar.x + B.z * bar.y + C.z * bar.z;
+
+            // Selecciones en lugar de saltos: el compilador puede convertirlas en movimientos condicionales
+            bool passed = inside && depthTest<Func>(z, depthRow[x]);
+            STATS(if (inside) { pipelineStats.coveredPixels++; pipelineStats.countDepthTest(x, y, passed); });
+            if constexpr (DepthWrite) {
+                depthRow[x] = passed ? z : depthRow[x];
+            }
+            if constexpr (Output == OutputFormat::Color) {
+                colorRow[x] = passed ? color : colorRow[x];
+            }
+        }
+    }
+}
+
+using RasterKernel = void (*)(Framebuffer&, const Vertex&, const Vertex&, const Vertex&, const Color&);
+
+// Posición de un estado en la tabla de núcleos
+constexpr size_t rasterKernelIndex(CullMode cull, DepthFunc depthFunc, bool depthWrite, ShadingModel shading, OutputFormat output) {
+    return (((static_cast<size_t>(cull) * DEPTH_FUNC_COUNT + static_cast<size_t>(depthFunc)) * 2 + (depthWrite ? 1 : 0)) * SHADING_MODEL_COUNT +
+            static_cast<size_t>(shading)) * OUTPUT_FORMAT_COUNT + static_cast<size_t>(output);
+}
+
+const size_t RASTER_KERNEL_COUNT = CULL_MODE_COUNT * DEPTH_FUNC_COUNT * 2 * SHADING_MODEL_COUNT * OUTPUT_FORMAT_COUNT;
+
+// Núcleo de la posición I de la tabla, decodificando el estado en el orden de rasterKernelIndex()
+template <size_t I>
+constexpr RasterKernel rasterKernelAt() {
+    constexpr OutputFormat output = static_cast<OutputFormat>(I % OUTPUT_FORMAT_COUNT);
+    constexpr ShadingModel shading = static_cast<ShadingModel>(I / OUTPUT_FORMAT_COUNT % SHADING_MODEL_COUNT);
+    constexpr bool depthWrite = I / (OUTPUT_FORMAT_COUNT * SHADING_MODEL_COUNT) % 2 == 1;
+    constexpr DepthFunc depthFunc = static_cast<DepthFunc>(I / (OUTPUT_FORMAT_COUNT * SHADING_MODEL_COUNT * 2) % DEPTH_FUNC_COUNT);
+    constexpr CullMode cull = static_cast<CullMode>(I / (OUTPUT_FORMAT_COUNT * SHADING_MODEL_COUNT * 2 * DEPTH_FUNC_COUNT));
+    static_assert(rasterKernelIndex(cull, depthFunc, depthWrite, shading, output) == I, "orden de la tabla de núcleos");
+    return &rasterTriangle<cull, depthFunc, depthWrite, shading, output>;
+}
+
+template <size_t... I>
+constexpr std::array<RasterKernel, sizeof...(I)> makeRasterKernels(std::index_sequence<I...>) {
+    return {{rasterKernelAt<I>()...}};
+}
+
+// Tabla con todas las combinaciones de estado, generada al compilar
+const std::array<RasterKernel, RASTER_KERNEL_COUNT> rasterKernels = makeRasterKernels(std::make_index_sequence<RASTER_KERNEL_COUNT>());
+
+// Función para obtener el núcleo de rasterización de un estado; se llama una vez por llamada de dibujo
+RasterKernel selectRasterKernel(const PipelineState& state) {
+    return rasterKernels[rasterKernelIndex(state.cull, state.depthFunc, state.depthWrite, state.shading, state.output)];
+}
+
+// Función para llamar a 'f' con el estado convertido en constantes de compilación (std::integral_constant de
+// descarte, función de profundidad, escritura de profundidad y formato de salida). Así una función de dibujo
+// instancia su bucle completo para cada combinación y decide una sola vez por llamada cuál ejecuta.
+// El modelo de sombreado no se pasa: con programas de sombreado (ver ShaderProgram.h) lo decide el programa.
+template <typename F>
+void withPipelineState(const PipelineState& state, F&& f) {
+    auto withOutput = [&](auto cull, auto depthFunc, auto depthWrite) {
+        if (state.output == OutputFormat::Color) {
+            f(cull, depthFunc, depthWrite, std::integral_constant<OutputFormat, OutputFormat::Color>());
+        } else {
+            f(cull, depthFunc, depthWrite, std::integral_constant<OutputFormat, OutputFormat::DepthOnly>());
+        }
+    };
+    auto withDepthWrite = [&](auto cull, auto depthFunc) {
+        if (state.depthWrite) {
+            withOutput(cull, depthFunc, std::true_type());
+        } else {
+            withOutput(cull, depthFunc, std::false_type());
+        }
+    };
+    auto withDepthFunc = [&](auto cull) {
+        switch (state.depthFunc) {
+            case DepthFunc::Less: withDepthWrite(cull, std::integral_constant<DepthFunc, DepthFunc::Less>()); break;
+            case DepthFunc::LessEqual: withDepthWrite(cull, std::integral_constant<DepthFunc, DepthFunc::LessEqual>()); break;
+            case DepthFunc::Always: withDepthWrite(cull, std::integral_constant<DepthFunc, DepthFunc::Always>()); break;
+        }
+    };
+    switch (state.cull) {
+        case CullMode::None: withDepthFunc(std::integral_constant<CullMode, CullMode::None>()); break;
+        case CullMode::Back: withDepthFunc(std::integral_constant<CullMode, CullMode::Back>()); break;
+        case CullMode::Front: withDepthFunc(std::integral_constant<CullMode, CullMode::Front>()); break;
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "GraphicsStructures.h"
+#include "Bitmap.h"
+
+// Contadores del pipeline por cuadro, al estilo de las consultas de estadísticas de una GPU.
+// Con SR_PIPELINE_STATS=0 la macro STATS se expande a nada y los contadores no cuestan nada.
+#ifndef SR_PIPELINE_STATS
+#define SR_PIPELINE_STATS 1
+#endif
+
+struct PipelineStats {
+    uint64_t verticesShaded = 0;      // Invocaciones del sombreador de vértices
+    uint64_t trianglesAssembled = 0;  // Triángulos formados por el ensamblado de primitivas
+    uint64_t trianglesCulled = 0;     // Triángulos descartados antes de rasterizar
+    uint64_t trianglesClipped = 0;    // Triángulos parcialmente fuera de la pantalla (caja recortada)
+    uint64_t boxPixels = 0;           // Píxeles de la caja envolvente visitados en triangle()
+    uint64_t coveredPixels = 0;       // Píxeles de la caja que cubre el triángulo (fragmentos generados)
+    uint64_t depthPassed = 0;         // Fragmentos que pasan la prueba de profundidad en point()
+    uint64_t depthFailed = 0;         // Fragmentos que fallan la prueba de profundidad en point()
+    uint64_t meshletsTested = 0;          // Grupos de triángulos evaluados por renderMeshlets()
+    uint64_t meshletsCulledFrustum = 0;   // Grupos fuera del frustum
+    uint64_t meshletsCulledCone = 0;      // Grupos con todas las caras hacia atrás
+    uint64_t meshletsCulledOcclusion = 0; // Grupos ocultos según el Z jerárquico
+    uint64_t bvhNodesVisited = 0;         // Nodos de la jerarquía de instancias probados contra el frustum
+    uint64_t instancesCulled = 0;         // Instancias de la escena fuera del frustum
+    uint64_t instancesSimplified = 0;     // Instancias dibujadas con un nivel de detalle simplificado
+    uint64_t chunksDrawn = 0;             // Trozos de mallas fuera de memoria dibujados
+    uint64_t chunksMissing = 0;           // Trozos visibles que aún no estaban en memoria
+
+    int width = 0;
+    int height = 0;
+    std::vector<uint16_t> overdraw;   // Fragmentos probados por píxel
+
+    // Reinicia los contadores al comienzo de un cuadro
+    void reset(int w, int h) {
+        *this = PipelineStats{};
+        width = w;
+        height = h;
+        overdraw.assign(static_cast<size_t>(w) * h, 0);
+    }
+
+    void countDepthTest(int x, int y, bool passed) {
+        // Las pasadas a otros búferes (mapas de sombras) cuentan pruebas pero no entran en el mapa de sobredibujo
+        if (x < width && y < height) {
+            uint16_t& count = overdraw[static_cast<size_t>(y) * width + x];
+            count = static_cast<uint16_t>(std::min<int>(count + 1, 0xFFFF));
+        }
+        if (passed) {
+            depthPassed++;
+        } else {
+            depthFailed++;
+        }
+    }
+
+    // Sobredibujo medio: fragmentos probados por cada píxel que recibió al menos uno
+    double averageOverdraw() const {
+        uint64_t touched = 0;
+        uint64_t total = 0;
+        for (uint16_t count : overdraw) {
+            if (count > 0) {
+                touched++;
+                total += count;
+            }
+        }
+        return touched ? static_cast<double>(total) / static_cast<double>(touched) : 0.0;
+    }
+
+    std::string summary() const {
+        std::ostringstream ss;
+        ss.setf(std::ios::fixed);
+        ss.precision(2);
+        ss << "vertices: " << verticesShaded
+           << " | triangulos: " << trianglesAssembled
+           << " (descartados " << trianglesCulled << ", recortados " << trianglesClipped << ")"
+           << " | pixeles caja/cubiertos: " << boxPixels << "/" << coveredPixels
+           << " | profundidad pasa/falla: " << depthPassed << "/" << depthFailed
+           << " | sobredibujo medio: " << averageOverdraw();
+        if (meshletsTested > 0) {
+            ss << " | grupos: " << meshletsTested << " (frustum " << meshletsCulledFrustum
+               << ", cono " << meshletsCulledCone << ", oclusion " << meshletsCulledOcclusion << ")";
+        }
+        if (bvhNodesVisited > 0) {
+            ss << " | instancias descartadas: " << instancesCulled << " (nodos probados " << bvhNodesVisited << ")";
+        }
+        if (chunksDrawn + chunksMissing > 0) {
+            ss << " | trozos dibujados/faltantes: " << chunksDrawn << "/" << chunksMissing;
+        }
+        if (instancesSimplified > 0) {
+            ss << " | instancias simplificadas: " << instancesSimplified;
+        }
+        return ss.str();
+    }
+};
+
+// Contadores del cuadro actual
+PipelineStats pipelineStats;
+
+#if SR_PIPELINE_STATS
+#define STATS(statement) statement
+#else
+#define STATS(statement) ((void)0)
+#endif
+
+// Función para convertir un número de fragmentos por píxel en un color de la rampa negro-azul-verde-amarillo-rojo-blanco
+Color heatColor(uint16_t count) {
+    const Color ramp[] = {
+            Color(0, 0, 0), Color(0, 0, 255), Color(0, 255, 0),
+            Color(255, 255, 0), Color(255, 0, 0), Color(255, 255, 255)
+    };
+    int index = std::min<int>(count, 5);
+    return ramp[index];
+}
+
+// Función para escribir el mapa de calor de sobredibujo del último cuadro
+bool writeOverdrawBMP(const std::string& filename, const PipelineStats& stats) {
+    std::vector<Color> pixels(stats.overdraw.size());
+    std::transform(stats.overdraw.begin(), stats.overdraw.end(), pixels.begin(), heatColor);
+    return writeBMP24(filename, stats.width, stats.height, pixels);
+}
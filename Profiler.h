@@ -0,0 +1,225 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Framebuffer.h"
+#include "Overlay.h"
+
+// Perfilador por zonas para las etapas del pipeline.
+// Con SR_PROFILER=0 las macros PROFILE_ZONE se expanden a nada y las sondas desaparecen del binario.
+#ifndef SR_PROFILER
+#define SR_PROFILER 1
+#endif
+
+// Evento de una zona: nombre (literal de cadena) e instantes de inicio y fin en nanosegundos
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Búfer circular de eventos de un solo hilo.
+// Solo el hilo dueño escribe; 'head' se publica con release para que el exportador lo lea sin bloqueos.
+// Si el exportador lee mientras el dueño sobrescribe la ranura más antigua, ese evento puede salir
+// inconsistente; es un costo aceptable para no sincronizar el camino caliente.
+struct ProfileRing {
+    static const size_t CAPACITY = 1 << 14;
+
+    std::array<ProfileEvent, CAPACITY> events;
+    std::atomic<uint64_t> head{0};
+    int threadIndex = 0;
+
+    void push(const ProfileEvent& e) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        events[h & (CAPACITY - 1)] = e;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Copia los eventos aún presentes en el búfer (del más antiguo al más reciente)
+    void snapshot(std::vector<ProfileEvent>& out) const {
+        uint64_t h = head.load(std::memory_order_acquire);
+        uint64_t first = h > CAPACITY ? h - CAPACITY : 0;
+        for (uint64_t i = first; i < h; i++) {
+            out.push_back(events[i & (CAPACITY - 1)]);
+        }
+    }
+};
+
+// Estado global del perfilador: registro de búferes por hilo y resumen del último cuadro
+struct Profiler {
+    std::mutex registryMutex; // Solo se usa al registrar un hilo nuevo o al exportar
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    uint64_t frameStart = 0;
+    std::vector<std::pair<const char*, double>> lastFrame; // Milisegundos por etapa del último cuadro
+
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    uint64_t now() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    // Búfer del hilo actual; se crea y registra la primera vez que el hilo emite un evento
+    ProfileRing& threadRing() {
+        thread_local ProfileRing* ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            rings.push_back(std::make_unique<ProfileRing>());
+            ring = rings.back().get();
+            ring->threadIndex = static_cast<int>(rings.size());
+        }
+        return *ring;
+    }
+
+    std::vector<std::pair<int, ProfileEvent>> collect() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::vector<std::pair<int, ProfileEvent>> all;
+        std::vector<ProfileEvent> events;
+        for (const auto& ring : rings) {
+            events.clear();
+            ring->snapshot(events);
+            for (const ProfileEvent& e : events) {
+                all.emplace_back(ring->threadIndex, e);
+            }
+        }
+        return all;
+    }
+
+    // Marca el inicio de un cuadro
+    void beginFrame() {
+        frameStart = now();
+    }
+
+    // Cierra el cuadro y acumula el tiempo de cada etapa para el overlay.
+    // Recorre cada búfer desde el evento más reciente y se detiene al llegar a eventos de cuadros anteriores.
+    void endFrame() {
+        lastFrame.clear();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& ring : rings) {
+            uint64_t h = ring->head.load(std::memory_order_acquire);
+            uint64_t first = h > ProfileRing::CAPACITY ? h - ProfileRing::CAPACITY : 0;
+            for (uint64_t i = h; i > first; i--) {
+                const ProfileEvent& e = ring->events[(i - 1) & (ProfileRing::CAPACITY - 1)];
+                if (e.start < frameStart) {
+                    break;
+                }
+                double ms = static_cast<double>(e.end - e.start) / 1.0e6;
+                auto it = std::find_if(lastFrame.begin(), lastFrame.end(), [&](const auto& stage) {
+                    return std::string(stage.first) == e.name;
+                });
+                if (it == lastFrame.end()) {
+                    lastFrame.emplace_back(e.name, ms);
+                } else {
+                    it->second += ms;
+                }
+            }
+        }
+    }
+};
+
+// Zona RAII: registra el intervalo entre su construcción y su destrucción
+struct ProfileZone {
+    const char* name;
+    uint64_t start;
+
+    explicit ProfileZone(const char* zoneName) : name(zoneName), start(Profiler::instance().now()) {}
+
+    ~ProfileZone() {
+        Profiler& profiler = Profiler::instance();
+        profiler.threadRing().push(ProfileEvent{name, start, profiler.now()});
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define SR_PROFILE_CONCAT_INNER(a, b) a##b
+#define SR_PROFILE_CONCAT(a, b) SR_PROFILE_CONCAT_INNER(a, b)
+
+#if SR_PROFILER
+#define PROFILE_ZONE(name) ProfileZone SR_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_BEGIN_FRAME() Profiler::instance().beginFrame()
+#define PROFILE_END_FRAME() Profiler::instance().endFrame()
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_BEGIN_FRAME() ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+#endif
+
+// Función para exportar los eventos registrados en formato JSON de Chrome Trace (chrome://tracing, Perfetto)
+bool writeChromeTrace(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "No se pudo abrir el archivo para escribir: " << filename << "\n";
+        return false;
+    }
+
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& entry : Profiler::instance().collect()) {
+        const ProfileEvent& e = entry.second;
+        if (!first) {
+            file << ",\n";
+        }
+        first = false;
+        // Los tiempos de Chrome Trace se expresan en microsegundos
+        file << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << entry.first
+             << ",\"ts\":" << static_cast<double>(e.start) / 1000.0
+             << ",\"dur\":" << static_cast<double>(e.end - e.start) / 1000.0 << "}";
+    }
+    file << "\n]}\n";
+
+    std::cout << "Traza guardada: " << filename << "\n";
+    return true;
+}
+
+const int PROFILER_OVERLAY_SCALE = 2;                         // Escala del texto de la superposición
+const int PROFILER_OVERLAY_LINE = 7 * PROFILER_OVERLAY_SCALE; // Alto de cada etapa, en píxeles
+
+// Función para obtener la altura en píxeles de la franja superior que ocupa drawProfilerOverlay()
+int profilerOverlayHeight() {
+    return static_cast<int>(Profiler::instance().lastFrame.size()) * PROFILER_OVERLAY_LINE + 4;
+}
+
+// Función para dibujar en el framebuffer los tiempos por etapa del último cuadro.
+// Cada etapa tiene una barra proporcional a su tiempo; el ancho completo equivale a 'budgetMs'.
+void drawProfilerOverlay(Framebuffer& fb, double budgetMs) {
+    const Color palette[] = {
+            Color(230, 80, 80), Color(80, 200, 90), Color(80, 140, 240),
+            Color(240, 200, 60), Color(200, 90, 220), Color(60, 210, 210)
+    };
+    const int scale = PROFILER_OVERLAY_SCALE;
+    const int lineHeight = PROFILER_OVERLAY_LINE;
+    const int barWidth = fb.width / 3;
+
+    const auto& stages = Profiler::instance().lastFrame;
+    fillRect(fb, 0, 0, fb.width, profilerOverlayHeight(), Color(0, 0, 0));
+
+    int y = 2;
+    int index = 0;
+    for (const auto& stage : stages) {
+        const Color& color = palette[index++ % 6];
+        int length = static_cast<int>(std::min(stage.second / budgetMs, 1.0) * barWidth);
+        fillRect(fb, 2, y, std::max(length, 1), 5 * scale, color);
+
+        char value[32];
+        std::snprintf(value, sizeof(value), "%.2f MS", stage.second);
+        drawText(fb, barWidth + 8, y, std::string(stage.first) + " " + value, color, scale);
+        y += lineHeight;
+    }
+}
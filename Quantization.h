@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "Mesh.h"
+
+// Formato de vértice comprimido para mallas grandes. Las posiciones se guardan como enteros de 16 bits dentro
+// de la caja de la malla; la decodificación es una transformación afín (Mesh::dequantize) que renderScene()
+// multiplica una vez por instancia a la matriz combinada, así que transformar un vértice cuantizado cuesta
+// lo mismo que uno en punto flotante.
+
+const float QUANTIZED_POSITION_MAX = 65535.0f;
+const float QUANTIZED_NORMAL_MAX = 32767.0f;
+
+// Función para codificar una normal unitaria en el octaedro desplegado, con componentes en [-1, 1]
+glm::vec2 octahedralEncode(const glm::vec3& n) {
+    glm::vec2 p = glm::vec2(n.x, n.y) / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    if (n.z < 0.0f) {
+        glm::vec2 sign(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+        p = (glm::vec2(1.0f) - glm::abs(glm::vec2(p.y, p.x))) * sign;
+    }
+    return p;
+}
+
+// Función para recuperar la normal unitaria de su codificación octaédrica
+glm::vec3 octahedralDecode(const glm::vec2& p) {
+    glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+    if (n.z < 0.0f) {
+        glm::vec2 sign(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+        glm::vec2 folded = (glm::vec2(1.0f) - glm::abs(glm::vec2(n.y, n.x))) * sign;
+        n.x = folded.x;
+        n.y = folded.y;
+    }
+    return glm::normalize(n);
+}
+
+// Función para obtener la normal de un vértice comprimido
+glm::vec3 quantizedNormal(const QuantizedVertex& v) {
+    return octahedralDecode(glm::vec2(v.normal[0], v.normal[1]) / QUANTIZED_NORMAL_MAX);
+}
+
+// Función para obtener la posición de un vértice comprimido en el espacio del modelo
+glm::vec3 quantizedPosition(const Mesh& mesh, const QuantizedVertex& v) {
+    return glm::vec3(mesh.dequantize * glm::vec4(v.position[0], v.position[1], v.position[2], 1.0f));
+}
+
+// Función para comprimir los vértices de la malla e informar la pérdida de precisión.
+// Va después de optimizeMesh(), generateLODs() y buildMeshlets(), que trabajan sobre 'positions';
+// la malla resultante se dibuja con renderScene(). Usa las normales de la malla, o las calcula si no tiene.
+void quantizeMesh(Mesh& mesh) {
+    glm::vec3 extent = mesh.bounds.max - mesh.bounds.min;
+    glm::vec3 step = extent / QUANTIZED_POSITION_MAX;
+    mesh.dequantize = glm::scale(glm::translate(glm::mat4(1.0f), mesh.bounds.min), step);
+
+    std::vector<glm::vec3> normals = mesh.normals.empty() ? computeVertexNormals(mesh) : mesh.normals;
+    mesh.quantized.resize(mesh.positions.size());
+
+    float maxPositionError = 0.0f;
+    float maxNormalError = 0.0f;
+    for (size_t i = 0; i < mesh.positions.size(); i++) {
+        QuantizedVertex& q = mesh.quantized[i];
+        for (int axis = 0; axis < 3; axis++) {
+            float t = extent[axis] > 0.0f ? (mesh.positions[i][axis] - mesh.bounds.min[axis]) / extent[axis] : 0.0f;
+            q.position[axis] = static_cast<uint16_t>(std::lround(std::clamp(t, 0.0f, 1.0f) * QUANTIZED_POSITION_MAX));
+        }
+        glm::vec2 oct = octahedralEncode(normals[i]);
+        q.normal[0] = static_cast<int16_t>(std::lround(std::clamp(oct.x, -1.0f, 1.0f) * QUANTIZED_NORMAL_MAX));
+        q.normal[1] = static_cast<int16_t>(std::lround(std::clamp(oct.y, -1.0f, 1.0f) * QUANTIZED_NORMAL_MAX));
+
+        maxPositionError = std::max(maxPositionError, glm::length(quantizedPosition(mesh, q) - mesh.positions[i]));
+        float cosine = std::clamp(glm::dot(quantizedNormal(q), normals[i]), -1.0f, 1.0f);
+        maxNormalError = std::max(maxNormalError, glm::degrees(std::acos(cosine)));
+    }
+
+    size_t before = mesh.positions.size() * sizeof(glm::vec3) * 2;
+    size_t after = mesh.quantized.size() * sizeof(QuantizedVertex);
+    std::cout << "Cuantización de vértices: error máximo de posición " << maxPositionError
+              << " (" << 100.0f * maxPositionError / std::max(glm::length(extent), 1e-20f) << "% de la diagonal)"
+              << ", de normal " << maxNormalError << " grados; posición + normal " << before << " -> " << after << " bytes\n";
+
+    mesh.positions.clear();
+    mesh.positions.shrink_to_fit();
+    mesh.normals.clear();
+    mesh.normals.shrink_to_fit();
+}
@@ -0,0 +1,465 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "Framebuffer.h"
+#include "ObjLoader.h"
+#include "Mesh.h"
+#include "Quantization.h"
+#include "Scene.h"
+#include "PipelineState.h"
+#include "ShaderUtilities.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+// Trazado de rayos primarios como alternativa a la rasterización. Cada malla lleva una jerarquía de triángulos
+// construida con la heurística de área de superficie (SAH); los rayos salen en paquetes de 4 u 8 píxeles vecinos
+// que recorren la jerarquía juntos, con las pruebas de caja y de triángulo escritas carril por carril para que
+// el compilador las vectorice, y la pantalla se reparte en mosaicos entre hilos. El costo por píxel crece con el
+// logaritmo del número de triángulos en lugar de con el número de triángulos.
+//
+// Con el mismo Uniform la imagen es la del pipeline fijo: el rayo del píxel (x, y) es la recta de pantalla que
+// lo atraviesa entre los planos cercano y lejano, y del triángulo más cercano se calculan la profundidad y el
+// color plano con las mismas fórmulas que rasterTriangle(). Solo pueden cambiar píxeles de borde (la prueba de
+// triángulo del rayo y la de coordenadas baricéntricas redondean distinto) y los triángulos que cruzan el plano
+// cercano, que el rasterizador no recorta.
+
+const uint32_t TRIANGLE_BVH_LEAF_SIZE = 4; // Una hoja de hasta este tamaño no se divide
+const uint32_t TRIANGLE_BVH_MAX_LEAF = 16; // Más triángulos siempre se dividen, aunque la SAH prefiera la hoja
+const int TRIANGLE_BVH_BINS = 16;          // Cubetas por eje para evaluar la SAH
+const int RAY_TILE_SIZE = 16;              // Lado de los mosaicos que se reparten entre hilos
+const int TRAVERSAL_STACK_SIZE = 64;       // Entradas fijas de la pila de recorrido (ver TraversalStack)
+
+// Función para obtener el área de superficie de una caja (0 si está vacía)
+inline float surfaceArea(const AABB& box) {
+    if (box.empty()) {
+        return 0.0f;
+    }
+    glm::vec3 e = box.max - box.min;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// Función para obtener la posición del vértice v en el espacio del modelo, esté o no cuantizada la malla
+inline glm::vec3 modelPosition(const Mesh& mesh, uint32_t v) {
+    return mesh.quantized.empty() ? mesh.positions[v] : quantizedPosition(mesh, mesh.quantized[v]);
+}
+
+// Función para construir la jerarquía de los triángulos 'indices' de la malla. Divide cada nodo en el plano de
+// cubeta de menor costo SAH de los tres ejes, o lo deja como hoja si dividirlo no sale más barato.
+void buildTriangleBVH(const Mesh& mesh, const std::vector<uint32_t>& indices, std::vector<TriangleBVHNode>& nodes,
+                      std::vector<uint32_t>& triangles) {
+    size_t triangleCount = indices.size() / 3;
+    nodes.clear();
+    triangles.resize(triangleCount);
+    if (triangleCount == 0 || mesh.vertexCount() == 0) {
+        return;
+    }
+
+    std::vector<AABB> bounds(triangleCount);
+    std::vector<glm::vec3> centers(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            bounds[t].expand(modelPosition(mesh, indices[t * 3 + k]));
+        }
+        centers[t] = bounds[t].center();
+        triangles[t] = static_cast<uint32_t>(t);
+    }
+
+    nodes.push_back(TriangleBVHNode{AABB(), 0, 0, static_cast<uint32_t>(triangleCount)});
+    std::vector<uint32_t> pending = {0};
+    while (!pending.empty()) {
+        uint32_t index = pending.back();
+        pending.pop_back();
+        uint32_t first = nodes[index].first;
+        uint32_t count = nodes[index].count;
+
+        AABB nodeBounds;
+        AABB centerBounds;
+        for (uint32_t i = first; i < first + count; i++) {
+            nodeBounds.expand(bounds[triangles[i]]);
+            centerBounds.expand(centers[triangles[i]]);
+        }
+        nodes[index].bounds = nodeBounds;
+        if (count <= TRIANGLE_BVH_LEAF_SIZE) {
+            continue;
+        }
+
+        // Costo de cada plano entre cubetas: área a cada lado por triángulos a cada lado
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        int bestSplit = 0;
+        glm::vec3 extent = centerBounds.max - centerBounds.min;
+        for (int axis = 0; axis < 3; axis++) {
+            if (extent[axis] <= 0.0f) {
+                continue;
+            }
+            AABB binBounds[TRIANGLE_BVH_BINS];
+            uint32_t binCounts[TRIANGLE_BVH_BINS] = {};
+            float scale = TRIANGLE_BVH_BINS / extent[axis];
+            for (uint32_t i = first; i < first + count; i++) {
+                uint32_t t = triangles[i];
+                int bin = std::min(static_cast<int>((centers[t][axis] - centerBounds.min[axis]) * scale), TRIANGLE_BVH_BINS - 1);
+                binBounds[bin].expand(bounds[t]);
+                binCounts[bin]++;
+            }
+            // Barrido de derecha a izquierda para las áreas de la derecha y luego de izquierda a derecha
+            float rightArea[TRIANGLE_BVH_BINS];
+            uint32_t rightCount[TRIANGLE_BVH_BINS];
+            AABB right;
+            uint32_t rightTotal = 0;
+            for (int b = TRIANGLE_BVH_BINS - 1; b > 0; b--) {
+                right.expand(binBounds[b]);
+                rightTotal += binCounts[b];
+                rightArea[b] = surfaceArea(right);
+                rightCount[b] = rightTotal;
+            }
+            AABB left;
+            uint32_t leftTotal = 0;
+            for (int b = 1; b < TRIANGLE_BVH_BINS; b++) {
+                left.expand(binBounds[b - 1]);
+                leftTotal += binCounts[b - 1];
+                if (leftTotal == 0 || rightCount[b] == 0) {
+                    continue;
+                }
+                float cost = surfaceArea(left) * leftTotal + rightArea[b] * rightCount[b];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        // Dividir cuesta un recorrido de nodo (la unidad) más los triángulos de cada lado según su área
+        float leafCost = static_cast<float>(count);
+        float splitCost = 1.0f + bestCost / std::max(surfaceArea(nodeBounds), 1e-30f);
+        if ((bestAxis < 0 || splitCost >= leafCost) && count <= TRIANGLE_BVH_MAX_LEAF) {
+            continue;
+        }
+
+        uint32_t* begin = &triangles[first];
+        uint32_t* middle;
+        if (bestAxis >= 0) {
+            float scale = TRIANGLE_BVH_BINS / extent[bestAxis];
+            float minimum = centerBounds.min[bestAxis];
+            middle = std::partition(begin, begin + count, [&](uint32_t t) {
+                return std::min(static_cast<int>((centers[t][bestAxis] - minimum) * scale), TRIANGLE_BVH_BINS - 1) < bestSplit;
+            });
+        } else {
+            // Todos los centros coinciden: se parte la lista por la mitad
+            middle = begin + count / 2;
+        }
+        uint32_t half = static_cast<uint32_t>(middle - begin);
+
+        uint32_t left = static_cast<uint32_t>(nodes.size());
+        nodes[index].left = left;
+        nodes.push_back(TriangleBVHNode{AABB(), 0, first, half});
+        nodes.push_back(TriangleBVHNode{AABB(), 0, first + half, count - half});
+        pending.push_back(left);
+        pending.push_back(left + 1);
+    }
+}
+
+// Función para construir la jerarquía de triángulos de la malla (Mesh::triangleBVH) y la de cada nivel de detalle.
+// Va después de las operaciones que reordenan triángulos o vértices (optimizeMesh()) y de generateLODs() y
+// quantizeMesh().
+void buildTriangleBVH(Mesh& mesh) {
+    buildTriangleBVH(mesh, mesh.indices, mesh.triangleBVH, mesh.bvhTriangles);
+    for (MeshLOD& lod : mesh.lods) {
+        buildTriangleBVH(mesh, lod.indices, lod.triangleBVH, lod.bvhTriangles);
+    }
+}
+
+// Paquete de N rayos en el espacio del modelo, componente por componente para recorrerlos juntos.
+// El parámetro va de 0 (plano cercano) a 1 (plano lejano); 't' es el del triángulo más cercano hasta ahora.
+template <int N>
+struct RayPacket {
+    float ox[N], oy[N], oz[N];
+    float dx[N], dy[N], dz[N];
+    float ix[N], iy[N], iz[N]; // 1 / dirección
+    float t[N];
+    uint32_t triangle[N];
+};
+
+// Función para cargar un rayo en un carril del paquete, sin triángulo y con 't' como parámetro máximo
+template <int N>
+inline void setRay(RayPacket<N>& p, int lane, const glm::vec3& origin, const glm::vec3& direction, float t) {
+    p.ox[lane] = origin.x;
+    p.oy[lane] = origin.y;
+    p.oz[lane] = origin.z;
+    p.dx[lane] = direction.x;
+    p.dy[lane] = direction.y;
+    p.dz[lane] = direction.z;
+    p.ix[lane] = 1.0f / direction.x;
+    p.iy[lane] = 1.0f / direction.y;
+    p.iz[lane] = 1.0f / direction.z;
+    p.t[lane] = t;
+    p.triangle[lane] = UINT32_MAX;
+}
+
+// Función para saber si algún rayo activo del paquete cruza la caja antes de su triángulo más cercano
+template <int N>
+inline bool packetHitsBox(const RayPacket<N>& p, const AABB& box) {
+    bool any = false;
+    for (int i = 0; i < N; i++) {
+        float tx0 = (box.min.x - p.ox[i]) * p.ix[i];
+        float tx1 = (box.max.x - p.ox[i]) * p.ix[i];
+        float ty0 = (box.min.y - p.oy[i]) * p.iy[i];
+        float ty1 = (box.max.y - p.oy[i]) * p.iy[i];
+        float tz0 = (box.min.z - p.oz[i]) * p.iz[i];
+        float tz1 = (box.max.z - p.oz[i]) * p.iz[i];
+        float near = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+        float far = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+        any |= near <= far && near < p.t[i];
+    }
+    return any;
+}
+
+// Función para cortar los rayos del paquete con un triángulo (Möller-Trumbore, de las dos caras)
+template <int N>
+inline void packetHitsTriangle(RayPacket<N>& p, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, uint32_t triangle) {
+    glm::vec3 e1 = v1 - v0;
+    glm::vec3 e2 = v2 - v0;
+    for (int i = 0; i < N; i++) {
+        // p = d x e2, det = e1 . p
+        float px = p.dy[i] * e2.z - p.dz[i] * e2.y;
+        float py = p.dz[i] * e2.x - p.dx[i] * e2.z;
+        float pz = p.dx[i] * e2.y - p.dy[i] * e2.x;
+        float det = e1.x * px + e1.y * py + e1.z * pz;
+        float inv = 1.0f / det;
+        float sx = p.ox[i] - v0.x;
+        float sy = p.oy[i] - v0.y;
+        float sz = p.oz[i] - v0.z;
+        float u = (sx * px + sy * py + sz * pz) * inv;
+        // q = s x e1
+        float qx = sy * e1.z - sz * e1.y;
+        float qy = sz * e1.x - sx * e1.z;
+        float qz = sx * e1.y - sy * e1.x;
+        float v = (p.dx[i] * qx + p.dy[i] * qy + p.dz[i] * qz) * inv;
+        float t = (e2.x * qx + e2.y * qy + e2.z * qz) * inv;
+        bool hit = det != 0.0f && u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < p.t[i];
+        p.t[i] = hit ? t : p.t[i];
+        p.triangle[i] = hit ? triangle : p.triangle[i];
+    }
+}
+
+// Pila de nodos pendientes de un recorrido. La SAH suele dar árboles de profundidad cercana a log2 del número de
+// triángulos, pero nada en buildTriangleBVH() la acota (con entradas muy desparejas cada corte puede separar
+// pocos triángulos): lo que no cabe en las entradas fijas sigue en un vector, que solo reserva memoria entonces.
+struct TraversalStack {
+    uint32_t fixed[TRAVERSAL_STACK_SIZE];
+    int top = 0;
+    std::vector<uint32_t> overflow; // Los nodos más recientes cuando 'fixed' está llena
+
+    bool empty() const {
+        return top == 0;
+    }
+
+    void push(uint32_t node) {
+        if (top < TRAVERSAL_STACK_SIZE) {
+            fixed[top++] = node;
+        } else {
+            overflow.push_back(node);
+        }
+    }
+
+    uint32_t pop() {
+        if (!overflow.empty()) {
+            uint32_t node = overflow.back();
+            overflow.pop_back();
+            return node;
+        }
+        return fixed[--top];
+    }
+};
+
+// Función para recorrer la jerarquía del nivel de detalle 'level' de la malla con el paquete; deja en cada carril
+// su triángulo más cercano (un índice en Mesh::levelIndices(level))
+template <int N>
+void traversePacket(const Mesh& mesh, RayPacket<N>& p, size_t level = 0) {
+    const std::vector<TriangleBVHNode>& nodes = mesh.levelBVH(level);
+    const std::vector<uint32_t>& triangles = mesh.levelBVHTriangles(level);
+    const std::vector<uint32_t>& indices = mesh.levelIndices(level);
+    bool quantized = !mesh.quantized.empty();
+    TraversalStack stack;
+    stack.push(0);
+    while (!stack.empty()) {
+        const TriangleBVHNode& node = nodes[stack.pop()];
+        if (!packetHitsBox(p, node.bounds)) {
+            continue;
+        }
+        if (node.left == 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                uint32_t t = triangles[i];
+                const uint32_t* index = &indices[static_cast<size_t>(t) * 3];
+                if (quantized) {
+                    packetHitsTriangle(p, modelPosition(mesh, index[0]), modelPosition(mesh, index[1]), modelPosition(mesh, index[2]), t);
+                } else {
+                    packetHitsTriangle(p, mesh.positions[index[0]], mesh.positions[index[1]], mesh.positions[index[2]], t);
+                }
+            }
+            continue;
+        }
+        // Primero el hijo más cercano según la dirección del primer rayo: el lejano se apila antes
+        const TriangleBVHNode& a = nodes[node.left];
+        const TriangleBVHNode& b = nodes[node.left + 1];
+        glm::vec3 toB = b.bounds.center() - a.bounds.center();
+        bool bFirst = toB.x * p.dx[0] + toB.y * p.dy[0] + toB.z * p.dz[0] < 0.0f;
+        stack.push(bFirst ? node.left : node.left + 1);
+        stack.push(bFirst ? node.left + 1 : node.left);
+    }
+}
+
+// Función para llevar a pantalla los vértices de un triángulo del nivel 'level' de la malla, como vertexShader()
+// o, con vértices cuantizados, como renderScene() (la decodificación va en la matriz)
+inline void projectTriangle(const Mesh& mesh, const glm::mat4& transform, uint32_t triangle, glm::vec3 screen[3],
+                            size_t level = 0) {
+    const uint32_t* index = &mesh.levelIndices(level)[static_cast<size_t>(triangle) * 3];
+    bool quantized = !mesh.quantized.empty();
+    glm::mat4 matrix = quantized ? transform * mesh.dequantize : transform;
+    for (int k = 0; k < 3; k++) {
+        glm::vec4 position;
+        if (quantized) {
+            const uint16_t* p = mesh.quantized[index[k]].position;
+            position = glm::vec4(p[0], p[1], p[2], 1.0f);
+        } else {
+            position = glm::vec4(mesh.positions[index[k]], 1.0f);
+        }
+        glm::vec4 r = matrix * position;
+        screen[k] = glm::vec3(r.x / r.w, r.y / r.w, r.z / r.w);
+    }
+}
+
+// Función para obtener la profundidad de un triángulo en pantalla en el píxel (x, y), como rasterTriangle()
+inline float screenDepth(const glm::vec3 screen[3], int x, int y) {
+    glm::vec3 bar = barycentricCoordinates(glm::vec3(x, y, 0), screen[0], screen[1], screen[2]);
+    return screen[0].z * bar.x + screen[1].z * bar.y + screen[2].z * bar.z;
+}
+
+// Función para trazar los píxeles de un mosaico con paquetes de N = W x H rayos
+template <int W, int H>
+void rayCastTile(Framebuffer& fb, const Mesh& mesh, const glm::mat4& transform, const glm::mat4& inverse,
+                 float nearZ, float farZ, const Color& tint, int minX, int minY, int maxX, int maxY) {
+    constexpr int N = W * H;
+    RayPacket<N> packet;
+    // Los puntos de los planos cercano y lejano en coordenadas homogéneas son lineales en x e y
+    glm::vec4 nearBase = inverse[2] * nearZ + inverse[3];
+    glm::vec4 farBase = inverse[2] * farZ + inverse[3];
+    // Triángulo del último píxel sombreado: los vecinos suelen caer en el mismo
+    uint32_t lastTriangle = UINT32_MAX;
+    glm::vec3 screen[3] = {glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f)};
+    Color color;
+    for (int y0 = minY; y0 <= maxY; y0 += H) {
+        for (int x0 = minX; x0 <= maxX; x0 += W) {
+            // Rayo de cada píxel: del punto del plano cercano al del lejano que se proyectan en él
+            for (int i = 0; i < N; i++) {
+                int x = x0 + i % W;
+                int y = y0 + i / W;
+                glm::vec4 offset = inverse[0] * static_cast<float>(x) + inverse[1] * static_cast<float>(y);
+                glm::vec4 a = nearBase + offset;
+                glm::vec4 b = farBase + offset;
+                glm::vec3 origin = glm::vec3(a) / a.w;
+                // Los carriles fuera del mosaico no cortan nada
+                setRay(packet, i, origin, glm::vec3(b) / b.w - origin, x <= maxX && y <= maxY ? 1.0f : 0.0f);
+            }
+            traversePacket(mesh, packet);
+
+            // Profundidad y color del triángulo más cercano con las fórmulas de rasterTriangle()
+            for (int i = 0; i < N; i++) {
+                uint32_t triangle = packet.triangle[i];
+                if (triangle == UINT32_MAX) {
+                    continue;
+                }
+                if (triangle != lastTriangle) {
+                    lastTriangle = triangle;
+                    projectTriangle(mesh, transform, triangle, screen);
+                    color = modulate(intensityColor(lightIntensity(glm::normalize(glm::cross(screen[1] - screen[0], screen[2] - screen[0])))), tint);
+                }
+                int x = x0 + i % W;
+                int y = y0 + i / W;
+                float z = screenDepth(screen, x, y);
+                size_t pixel = static_cast<size_t>(y) * fb.width + x;
+                if (z < fb.depth[pixel]) {
+                    fb.depth[pixel] = z;
+                    fb.color[pixel] = color;
+                }
+            }
+        }
+    }
+}
+
+// Función para dibujar una malla trazando rayos, con el estado por defecto del pipeline (profundidad Less con
+// escritura, sin descarte de caras). Necesita buildTriangleBVH(). Solo se trazan los píxeles de la caja en
+// pantalla de la malla, repartidos en mosaicos entre hilos; 'packetSize' es 4 (paquetes de 2x2) u 8 (4x2).
+void rayCastMesh(Framebuffer& fb, const Mesh& mesh, const Uniform& uniform, const Color& tint = Color(255, 255, 255),
+                 int packetSize = 4, ThreadPool& pool = threadPool()) {
+    PROFILE_ZONE("rayCast");
+    if (mesh.triangleBVH.empty()) {
+        return;
+    }
+    // La misma matriz que vertexShader(), para que los vértices en pantalla coincidan bit a bit
+    glm::mat4 transform = uniform.viewport * uniform.projection * uniform.view * uniform.model;
+    glm::mat4 inverse = glm::inverse(transform);
+    float nearZ = (uniform.viewport * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f)).z;
+    float farZ = (uniform.viewport * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)).z;
+
+    // Caja en pantalla de la malla; si cruza el plano de la cámara, toda la pantalla. La fila y la columna 0
+    // no se trazan, igual que no se rasterizan (ver rasterBounds()).
+    int minX = 1;
+    int minY = 1;
+    int maxX = fb.width - 1;
+    int maxY = fb.height - 1;
+    glm::vec2 low(std::numeric_limits<float>::max());
+    glm::vec2 high(std::numeric_limits<float>::lowest());
+    bool crossesCamera = false;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 p((corner & 1) ? mesh.bounds.max.x : mesh.bounds.min.x, (corner & 2) ? mesh.bounds.max.y : mesh.bounds.min.y,
+                    (corner & 4) ? mesh.bounds.max.z : mesh.bounds.min.z);
+        glm::vec4 r = transform * glm::vec4(p, 1.0f);
+        if (r.w <= 0.0f) {
+            crossesCamera = true;
+            break;
+        }
+        low = glm::min(low, glm::vec2(r) / r.w);
+        high = glm::max(high, glm::vec2(r) / r.w);
+    }
+    if (!crossesCamera) {
+        minX = std::max(minX, static_cast<int>(std::floor(low.x)));
+        minY = std::max(minY, static_cast<int>(std::floor(low.y)));
+        maxX = std::min(maxX, static_cast<int>(std::ceil(high.x)));
+        maxY = std::min(maxY, static_cast<int>(std::ceil(high.y)));
+    }
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    int tilesX = (maxX - minX) / RAY_TILE_SIZE + 1;
+    int tilesY = (maxY - minY) / RAY_TILE_SIZE + 1;
+    pool.run(static_cast<size_t>(tilesX) * tilesY, [&](size_t tile) {
+        int x0 = minX + static_cast<int>(tile % tilesX) * RAY_TILE_SIZE;
+        int y0 = minY + static_cast<int>(tile / tilesX) * RAY_TILE_SIZE;
+        int x1 = std::min(x0 + RAY_TILE_SIZE - 1, maxX);
+        int y1 = std::min(y0 + RAY_TILE_SIZE - 1, maxY);
+        if (packetSize >= 8) {
+            rayCastTile<4, 2>(fb, mesh, transform, inverse, nearZ, farZ, tint, x0, y0, x1, y1);
+        } else {
+            rayCastTile<2, 2>(fb, mesh, transform, inverse, nearZ, farZ, tint, x0, y0, x1, y1);
+        }
+    });
+}
+
+// Función para dibujar todas las instancias de una escena trazando rayos; uniform.model se aplica a toda la
+// escena, como en renderScene(). Se traza el nivel 0 de cada malla; las que no tienen jerarquía de triángulos
+// no se dibujan.
+void rayCastScene(Framebuffer& fb, const Scene& scene, const Uniform& uniform, int packetSize = 4) {
+    for (const Instance& instance : scene.instances) {
+        const Mesh& mesh = scene.meshes[instance.mesh];
+        Uniform instanceUniform = uniform;
+        instanceUniform.model = uniform.model * instance.model;
+        rayCastMesh(fb, mesh, instanceUniform, instance.color, packetSize);
+    }
+}
@@ -0,0 +1,651 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "GraphicsStructures.h"
+#include "ShaderUtilities.h"
+#include "Framebuffer.h"
+#include "Profiler.h"
+#include "PipelineStats.h"
+#include "PipelineState.h"
+#include "Bitmap.h"
+#include "Mesh.h"
+#include "Meshlet.h"
+#include "Scene.h"
+#include "StreamedMesh.h"
+#include "DirtyRegion.h"
+
+// Pipeline de renderizado independiente de SDL: lo comparten el visor interactivo y los benchmarks.
+
+// Función para limpiar el framebuffer y el z-buffer
+void clear(Framebuffer& fb, const Color& clearColor) {
+    PROFILE_ZONE("clear");
+
+    // Limpiar el color e inicializar el z-buffer con valores máximos
+    fb.clear(clearColor);
+}
+
+// Función para dibujar un píxel en el framebuffer y actualizar el z-buffer
+void point(Framebuffer& fb, Fragment f) {
+    if (f.position.y < fb.height && f.position.x < fb.width && f.position.y > 0 && f.position.x > 0) {
+        bool passed = f.position.z < fb.depthAt(f.position.x, f.position.y);
+        STATS(pipelineStats.countDepthTest(f.position.x, f.position.y, passed));
+
+        if (passed) {
+            fb.colorAt(f.position.x, f.position.y) = f.color;
+            fb.depthAt(f.position.x, f.position.y) = f.position.z;
+        }
+    }
+}
+
+// Función para ensamblar los vértices transformados en triángulos
+std::vector<std::vector<Vertex>> primitiveAssembly(
+        const std::vector<Vertex>& transformedVertices
+) {
+    std::vector<std::vector<Vertex>> groupedVertices;
+
+    // Agrupar vértices en conjuntos de tres para formar triángulos
+    for (int i = 0; i < transformedVertices.size(); i += 3) {
+        std::vector<Vertex> vertexGroup;
+        vertexGroup.push_back(transformedVertices[i]);
+        vertexGroup.push_back(transformedVertices[i+1]);
+        vertexGroup.push_back(transformedVertices[i+2]);
+
+        groupedVertices.push_back(vertexGroup);
+    }
+
+    return groupedVertices;
+}
+
+// Función para saber si un triángulo puede producir fragmentos dentro de la pantalla.
+// Descarta los triángulos degenerados (área cero) y los que quedan completamente fuera;
+// cuenta como recortados los que solo están parcialmente dentro.
+bool triangleOnScreen(const Vertex& a, const Vertex& b, const Vertex& c, int width, int height) {
+    glm::vec3 A = a.position;
+    glm::vec3 B = b.position;
+    glm::vec3 C = c.position;
+
+    float area = (B.x - A.x) * (C.y - A.y) - (C.x - A.x) * (B.y - A.y);
+    if (area == 0.0f || std::isnan(area)) {
+        return false;
+    }
+
+    float minX = std::floor(std::min(std::min(A.x, B.x), C.x));
+    float minY = std::floor(std::min(std::min(A.y, B.y), C.y));
+    float maxX = std::ceil(std::max(std::max(A.x, B.x), C.x));
+    float maxY = std::ceil(std::max(std::max(A.y, B.y), C.y));
+
+    // point() solo acepta 0 < x < width y 0 < y < height
+    if (maxX <= 0 || maxY <= 0 || minX >= width || minY >= height) {
+        return false;
+    }
+
+    if (minX <= 0 || minY <= 0 || maxX >= width || maxY >= height) {
+        STATS(pipelineStats.trianglesClipped++);
+    }
+    return true;
+}
+
+// Función principal para realizar la renderización
+void render(Framebuffer& fb, const std::vector<glm::vec3>& VBO, const Uniform& uniform) {
+    PROFILE_ZONE("render");
+    std::vector<Vertex> transformedVertices;
+
+    // Transformar los vértices del modelo 3D
+    {
+        PROFILE_ZONE("vertexShader");
+        for (int i = 0; i < VBO.size(); i++) {
+            glm::vec3 v = VBO[i];
+
+            Vertex vertex = {v, Color(255, 255, 255)};
+            Vertex transformedVertex = vertexShader(vertex, uniform);
+            transformedVertices.push_back(transformedVertex);
+        }
+        STATS(pipelineStats.verticesShaded += VBO.size());
+    }
+
+    // Ensamblar los triángulos a partir de los vértices transformados
+    std::vector<std::vector<Vertex>> triangles;
+    {
+        PROFILE_ZONE("primitiveAssembly");
+        triangles = primitiveAssembly(transformedVertices);
+        STATS(pipelineStats.trianglesAssembled += triangles.size());
+    }
+
+    std::vector<Fragment> fragments;
+    {
+        PROFILE_ZONE("rasterize");
+        for (const std::vector<Vertex>& triangleVertices : triangles) {
+            // Descartar triángulos que no pueden producir fragmentos visibles
+            if (!triangleOnScreen(triangleVertices[0], triangleVertices[1], triangleVertices[2], fb.width, fb.height)) {
+                STATS(pipelineStats.trianglesCulled++);
+                continue;
+            }
+
+            // Rasterizar el triángulo y obtener fragmentos
+            std::vector<Fragment> rasterizedTriangle = triangle(
+                    triangleVertices[0],
+                    triangleVertices[1],
+                    triangleVertices[2]
+            );
+
+            // Agregar los fragmentos al vector de fragmentos
+            fragments.insert(
+                    fragments.end(),
+                    rasterizedTriangle.begin(),
+                    rasterizedTriangle.end()
+            );
+        }
+    }
+
+    // Dibujar los fragmentos en el framebuffer
+    {
+        PROFILE_ZONE("point");
+        for (Fragment fragment : fragments) {
+            point(fb, fragmentShader(fragment));
+        }
+    }
+}
+
+// Función para dibujar una malla indexada.
+// Los vértices transformados se reutilizan con una caché FIFO de VERTEX_CACHE_SIZE entradas, igual que la
+// caché post-transformación de una GPU: el sombreador de vértices solo se invoca en los fallos, así que el
+// orden de los triángulos (ver MeshOptimizer.h) decide cuántas invocaciones cuesta la malla.
+void renderIndexed(Framebuffer& fb, const Mesh& mesh, const Uniform& uniform, const PipelineState& state = PipelineState()) {
+    PROFILE_ZONE("render");
+    std::vector<Vertex> assembled(mesh.indices.size());
+
+    // Transformar los vértices a través de la caché y ensamblar los triángulos
+    {
+        PROFILE_ZONE("vertexShader");
+        std::vector<Vertex> transformed(mesh.positions.size());
+        std::vector<int64_t> insertedAt(mesh.positions.size(), -VERTEX_CACHE_SIZE - 1);
+        int64_t misses = 0;
+
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            uint32_t index = mesh.indices[i];
+            if (misses - insertedAt[index] > VERTEX_CACHE_SIZE) {
+                transformed[index] = vertexShader(Vertex{mesh.positions[index], Color(255, 255, 255)}, uniform);
+                insertedAt[index] = misses++;
+            }
+            assembled[i] = transformed[index];
+        }
+        STATS(pipelineStats.verticesShaded += misses);
+        STATS(pipelineStats.trianglesAssembled += mesh.triangleCount());
+    }
+
+    PROFILE_ZONE("rasterize");
+    RasterKernel raster = selectRasterKernel(state);
+    Color white(255, 255, 255);
+    for (size_t i = 0; i < assembled.size(); i += 3) {
+        // Descartar triángulos que no pueden producir fragmentos visibles
+        if (!triangleOnScreen(assembled[i], assembled[i + 1], assembled[i + 2], fb.width, fb.height)) {
+            STATS(pipelineStats.trianglesCulled++);
+            continue;
+        }
+        raster(fb, assembled[i], assembled[i + 1], assembled[i + 2], white);
+    }
+}
+
+// Función para obtener el mayor factor de escala de una matriz (longitud de la columna más larga)
+float maxScale(const glm::mat4& m) {
+    return std::sqrt(std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+                               glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+                               glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))}));
+}
+
+// Pruebas de descarte por grupo que aplica renderMeshlets()
+struct MeshletCulling {
+    bool frustum = true;   // Esfera completamente fuera del frustum
+    bool cone = false;     // Todas las caras del grupo miran hacia atrás; solo para mallas cerradas con
+                           // caras en sentido antihorario, porque el rasterizador dibuja ambas caras
+    bool occlusion = true; // Esfera detrás del Z jerárquico de lo ya dibujado
+};
+
+// Función para dibujar una malla por grupos (ver Meshlet.h).
+// Los grupos se descartan enteros antes de transformar un solo vértice; los que quedan se dibujan
+// de adelante hacia atrás y actualizan el Z jerárquico para que los siguientes puedan descartarse por oclusión.
+void renderMeshlets(Framebuffer& fb, const Mesh& mesh, const Uniform& uniform, const MeshletCulling& culling = MeshletCulling(),
+                    const PipelineState& state = PipelineState()) {
+    PROFILE_ZONE("render");
+
+    glm::mat4 modelView = uniform.view * uniform.model;
+    glm::mat4 screen = uniform.viewport * uniform.projection;
+    Frustum frustum(uniform.projection * modelView);
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView) * glm::vec4(0, 0, 0, 1));
+
+    // Escala de la matriz modelo-vista, para llevar los radios al espacio de vista
+    float viewScale = maxScale(modelView);
+    // Plano cercano en el espacio de vista (z negativa hacia adelante): P[3][2] / (P[2][2] - 1) es la distancia n,
+    // y el plano está en z = -n
+    float nearPlane = -uniform.projection[3][2] / (uniform.projection[2][2] - 1.0f);
+
+    struct VisibleMeshlet {
+        uint32_t index;
+        glm::vec3 viewCenter;
+        float viewRadius;
+    };
+    std::vector<VisibleMeshlet> visible;
+    {
+        PROFILE_ZONE("meshletCulling");
+        for (uint32_t i = 0; i < mesh.meshlets.size(); i++) {
+            const Meshlet& meshlet = mesh.meshlets[i];
+            STATS(pipelineStats.meshletsTested++);
+            if (culling.frustum && frustum.sphereOutside(meshlet.center, meshlet.radius)) {
+                STATS(pipelineStats.meshletsCulledFrustum++);
+                continue;
+            }
+            if (culling.cone && meshletBackFacing(meshlet, cameraPosition)) {
+                STATS(pipelineStats.meshletsCulledCone++);
+                continue;
+            }
+            visible.push_back({i, glm::vec3(modelView * glm::vec4(meshlet.center, 1.0f)), meshlet.radius * viewScale});
+        }
+
+        // De adelante hacia atrás: los primeros grupos tapan a los siguientes
+        std::sort(visible.begin(), visible.end(), [](const VisibleMeshlet& x, const VisibleMeshlet& y) {
+            return x.viewCenter.z > y.viewCenter.z;
+        });
+    }
+
+    HierarchicalZ hiz;
+    if (culling.occlusion) {
+        hiz.reset(fb.width, fb.height);
+    }
+
+    PROFILE_ZONE("rasterize");
+    RasterKernel raster = selectRasterKernel(state);
+    Color white(255, 255, 255);
+    Vertex transformed[MESHLET_MAX_VERTICES];
+    for (const VisibleMeshlet& candidate : visible) {
+        const Meshlet& meshlet = mesh.meshlets[candidate.index];
+
+        // Prueba de oclusión: rectángulo de pantalla y punto más cercano de la esfera
+        glm::vec3 c = candidate.viewCenter;
+        float r = candidate.viewRadius;
+        if (culling.occlusion && c.z + r < nearPlane) {
+            float minX = std::numeric_limits<float>::max();
+            float minY = std::numeric_limits<float>::max();
+            float maxX = std::numeric_limits<float>::lowest();
+            float maxY = std::numeric_limits<float>::lowest();
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec4 p = screen * glm::vec4(c.x + ((corner & 1) ? r : -r), c.y + ((corner & 2) ? r : -r), c.z + ((corner & 4) ? r : -r), 1.0f);
+                minX = std::min(minX, p.x / p.w);
+                maxX = std::max(maxX, p.x / p.w);
+                minY = std::min(minY, p.y / p.w);
+                maxY = std::max(maxY, p.y / p.w);
+            }
+            glm::vec4 nearest = screen * glm::vec4(c.x, c.y, c.z + r, 1.0f);
+            if (hiz.occluded(static_cast<int>(std::floor(minX)), static_cast<int>(std::floor(minY)),
+                             static_cast<int>(std::ceil(maxX)), static_cast<int>(std::ceil(maxY)), nearest.z / nearest.w)) {
+                STATS(pipelineStats.meshletsCulledOcclusion++);
+                continue;
+            }
+        }
+
+        // Transformar solo los vértices del grupo
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+            const glm::vec3& position = mesh.positions[mesh.meshletVertices[meshlet.vertexOffset + i]];
+            transformed[i] = vertexShader(Vertex{position, Color(255, 255, 255)}, uniform);
+        }
+        STATS(pipelineStats.verticesShaded += meshlet.vertexCount);
+        STATS(pipelineStats.trianglesAssembled += meshlet.triangleCount);
+
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+            const uint8_t* local = &mesh.meshletTriangles[(meshlet.triangleOffset + t) * 3];
+            const Vertex& a = transformed[local[0]];
+            const Vertex& b = transformed[local[1]];
+            const Vertex& c2 = transformed[local[2]];
+            if (!triangleOnScreen(a, b, c2, fb.width, fb.height)) {
+                STATS(pipelineStats.trianglesCulled++);
+                continue;
+            }
+            raster(fb, a, b, c2, white);
+        }
+
+        // Actualizar el Z jerárquico en el área que cubrió el grupo
+        if (culling.occlusion) {
+            float minX = std::numeric_limits<float>::max();
+            float minY = std::numeric_limits<float>::max();
+            float maxX = std::numeric_limits<float>::lowest();
+            float maxY = std::numeric_limits<float>::lowest();
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+                minX = std::min(minX, transformed[i].position.x);
+                maxX = std::max(maxX, transformed[i].position.x);
+                minY = std::min(minY, transformed[i].position.y);
+                maxY = std::max(maxY, transformed[i].position.y);
+            }
+            if (maxX >= 0 && maxY >= 0 && minX < fb.width && minY < fb.height) {
+                hiz.update(fb, static_cast<int>(std::floor(minX)), static_cast<int>(std::floor(minY)),
+                           static_cast<int>(std::ceil(maxX)), static_cast<int>(std::ceil(maxY)));
+            }
+        }
+    }
+}
+
+// Función para elegir el nivel de detalle de una malla vista con 'modelView': el más simple cuyo error,
+// medido en píxeles a la distancia del punto más cercano de la esfera envolvente, no supera 'pixelError'
+size_t selectLevel(const Mesh& mesh, const glm::mat4& modelView, const glm::mat4& projection, int height, float pixelError) {
+    if (mesh.lods.empty()) {
+        return 0;
+    }
+    float scale = maxScale(modelView);
+    glm::vec3 center = glm::vec3(modelView * glm::vec4(mesh.bounds.center(), 1.0f));
+    float radius = glm::length(mesh.bounds.max - mesh.bounds.min) * 0.5f * scale;
+    float distance = -center.z - radius;
+    if (distance <= 0.0f) {
+        return 0;
+    }
+
+    // Píxeles que ocupa una unidad de longitud a esa distancia
+    float pixelsPerUnit = projection[1][1] * static_cast<float>(height) * 0.5f / distance;
+    size_t level = 0;
+    while (level + 1 < mesh.levelCount() && mesh.levelError(level + 1) * scale * pixelsPerUnit <= pixelError) {
+        level++;
+    }
+    return level;
+}
+
+// Función para transformar 'vertexCount' vértices con cada matriz de un lote; 'fetch' lee la posición
+// del vértice v en el formato en que esté guardada, así que el bucle no decide el formato por vértice
+template <typename Fetch>
+void transformBatch(const std::vector<glm::mat4>& matrices, size_t vertexCount, std::vector<Vertex>& transformed, Fetch fetch) {
+    size_t count = matrices.size();
+    for (size_t v = 0; v < vertexCount; v++) {
+        glm::vec4 position = fetch(v);
+        for (size_t i = 0; i < count; i++) {
+            glm::vec4 r = matrices[i] * position;
+            transformed[i * vertexCount + v] = Vertex{glm::vec3(r.x / r.w, r.y / r.w, r.z / r.w), Color(255, 255, 255)};
+        }
+    }
+}
+
+// Función para dibujar todas las instancias de una escena.
+// uniform.model se aplica a toda la escena, antes de la matriz de cada instancia. Si la escena tiene jerarquía
+// (Scene::updateBVH(), que hay que volver a llamar tras mover instancias) solo se dibujan las que cruzan el frustum.
+// Las mallas con niveles de detalle se dibujan con el nivel que elige selectLevel() para cada instancia. Las instancias se agrupan
+// por malla y se transforman en lotes de INSTANCE_BATCH_SIZE: cada posición se lee una vez por lote y se
+// multiplica por la matriz combinada (viewport * proyección * vista * modelo) de cada instancia.
+// Con 'damage' (ver DirtyRegion.h) solo se dibujan las instancias y los triángulos que tocan sus mosaicos.
+void renderScene(Framebuffer& fb, const Scene& scene, const Uniform& uniform, const PipelineState& state = PipelineState(),
+                 const DamageRegion* damage = nullptr) {
+    PROFILE_ZONE("render");
+    glm::mat4 screen = uniform.viewport * uniform.projection * uniform.view;
+
+    // Instancias que pueden verse: todas, o las que deja la jerarquía si la escena tiene una
+    std::vector<uint32_t> order;
+    if (scene.bvh.empty()) {
+        order.resize(scene.instances.size());
+        std::iota(order.begin(), order.end(), 0);
+    } else {
+        PROFILE_ZONE("instanceCulling");
+        Frustum frustum(uniform.projection * uniform.view * uniform.model);
+        size_t visited = scene.bvh.cull(frustum, order, threadPool());
+        STATS(pipelineStats.bvhNodesVisited += visited);
+        STATS(pipelineStats.instancesCulled += scene.instances.size() - order.size());
+        (void)visited;
+    }
+    if (damage) {
+        order.erase(std::remove_if(order.begin(), order.end(), [&](uint32_t index) {
+            const Instance& instance = scene.instances[index];
+            glm::mat4 transform = screen * (uniform.model * instance.model);
+            return !damage->touches(screenRect(scene.meshes[instance.mesh].bounds, transform, fb.width, fb.height));
+        }), order.end());
+    }
+
+    // Nivel de detalle de cada instancia visible
+    std::vector<uint8_t> levels(scene.instances.size(), 0);
+    for (uint32_t index : order) {
+        const Instance& instance = scene.instances[index];
+        glm::mat4 modelView = uniform.view * uniform.model * instance.model;
+        levels[index] = static_cast<uint8_t>(selectLevel(scene.meshes[instance.mesh], modelView, uniform.projection, fb.height, scene.lodPixelError));
+        STATS(pipelineStats.instancesSimplified += levels[index] > 0);
+    }
+
+    // Orden de dibujo: instancias de la misma malla y nivel contiguas, en el orden en que se agregaron
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) {
+        const Instance& a = scene.instances[x];
+        const Instance& b = scene.instances[y];
+        return a.mesh != b.mesh ? a.mesh < b.mesh : levels[x] < levels[y];
+    });
+
+    std::vector<glm::mat4> matrices;
+    std::vector<Vertex> transformed;
+    size_t begin = 0;
+    while (begin < order.size()) {
+        uint32_t meshIndex = scene.instances[order[begin]].mesh;
+        uint8_t level = levels[order[begin]];
+        const Mesh& mesh = scene.meshes[meshIndex];
+        size_t end = begin;
+        while (end < order.size() && end - begin < INSTANCE_BATCH_SIZE &&
+               scene.instances[order[end]].mesh == meshIndex && levels[order[end]] == level) {
+            end++;
+        }
+        size_t count = end - begin;
+        size_t vertexCount = mesh.levelVertexCount(level);
+        const std::vector<uint32_t>& indices = mesh.levelIndices(level);
+
+        // Transformar los vértices de todo el lote
+        {
+            PROFILE_ZONE("vertexShader");
+            // Con vértices cuantizados la decodificación se suma a la matriz de cada instancia
+            bool quantized = !mesh.quantized.empty();
+            matrices.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                matrices[i] = screen * (uniform.model * scene.instances[order[begin + i]].model);
+                if (quantized) {
+                    matrices[i] = matrices[i] * mesh.dequantize;
+                }
+            }
+
+            transformed.resize(count * vertexCount);
+            if (quantized) {
+                transformBatch(matrices, vertexCount, transformed, [&](size_t v) {
+                    const uint16_t* p = mesh.quantized[v].position;
+                    return glm::vec4(p[0], p[1], p[2], 1.0f);
+                });
+            } else {
+                transformBatch(matrices, vertexCount, transformed, [&](size_t v) {
+                    return glm::vec4(mesh.positions[v], 1.0f);
+                });
+            }
+            STATS(pipelineStats.verticesShaded += count * vertexCount);
+            STATS(pipelineStats.trianglesAssembled += count * indices.size() / 3);
+        }
+
+        // Rasterizar cada instancia del lote con su color
+        {
+            PROFILE_ZONE("rasterize");
+            RasterKernel raster = selectRasterKernel(state);
+            for (size_t i = 0; i < count; i++) {
+                const Vertex* vertices = &transformed[i * vertexCount];
+                const Color& tint = scene.instances[order[begin + i]].color;
+                for (size_t t = 0; t < indices.size(); t += 3) {
+                    const Vertex& a = vertices[indices[t]];
+                    const Vertex& b = vertices[indices[t + 1]];
+                    const Vertex& c = vertices[indices[t + 2]];
+                    if (!triangleOnScreen(a, b, c, fb.width, fb.height)) {
+                        STATS(pipelineStats.trianglesCulled++);
+                        continue;
+                    }
+                    if (damage && !damage->touches(rasterBounds(fb, a.position, b.position, c.position))) {
+                        continue;
+                    }
+                    raster(fb, a, b, c, tint);
+                }
+            }
+        }
+        begin = end;
+    }
+}
+
+// Función para dibujar una malla fuera de memoria (ver StreamedMesh.h).
+// Solo dibuja los trozos visibles que ya están en memoria y nunca espera al disco: los que faltan, y los que
+// están a menos de 'prefetchMargin' (fracción del tamaño de la malla) del frustum, se piden al hilo de E/S
+// del más cercano al más lejano. El costo del cuadro queda acotado por el presupuesto de memoria. Quien dibuja
+// llama a mesh.beginFrame() una vez por cuadro, antes de la primera copia.
+void renderStreamed(Framebuffer& fb, StreamedMesh& mesh, const Uniform& uniform, float prefetchMargin = 0.1f,
+                    const PipelineState& state = PipelineState()) {
+    PROFILE_ZONE("render");
+    glm::mat4 modelView = uniform.view * uniform.model;
+    Frustum frustum(uniform.projection * modelView);
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView) * glm::vec4(0, 0, 0, 1));
+
+    // Trozos cerca del frustum, del más cercano al más lejano; los visibles van primero en la cola
+    std::vector<uint32_t> nearby;
+    std::vector<uint32_t> visible;
+    std::vector<uint32_t> wanted;
+    {
+        PROFILE_ZONE("chunkCulling");
+        float margin = glm::length(mesh.bounds.max - mesh.bounds.min) * prefetchMargin;
+        mesh.bvh.cull(frustum.expanded(margin), nearby, threadPool());
+        auto distance = [&](uint32_t c) {
+            glm::vec3 d = mesh.chunks[c].bounds.center() - cameraPosition;
+            return glm::dot(d, d);
+        };
+        std::sort(nearby.begin(), nearby.end(), [&](uint32_t a, uint32_t b) { return distance(a) < distance(b); });
+        for (uint32_t c : nearby) {
+            if (frustum.classify(mesh.chunks[c].bounds) != FrustumTest::Outside) {
+                visible.push_back(c);
+            }
+        }
+        wanted = visible;
+        for (uint32_t c : nearby) {
+            if (frustum.classify(mesh.chunks[c].bounds) == FrustumTest::Outside) {
+                wanted.push_back(c);
+            }
+        }
+    }
+
+    PROFILE_ZONE("rasterize");
+    RasterKernel raster = selectRasterKernel(state);
+    Color white(255, 255, 255);
+    std::vector<Vertex> transformed;
+    for (uint32_t c : visible) {
+        std::shared_ptr<const ChunkData> chunk = mesh.acquire(c);
+        if (!chunk) {
+            STATS(pipelineStats.chunksMissing++);
+            continue;
+        }
+        STATS(pipelineStats.chunksDrawn++);
+
+        transformed.resize(chunk->positions.size());
+        for (size_t i = 0; i < chunk->positions.size(); i++) {
+            transformed[i] = vertexShader(Vertex{chunk->positions[i], Color(255, 255, 255)}, uniform);
+        }
+        STATS(pipelineStats.verticesShaded += chunk->positions.size());
+        STATS(pipelineStats.trianglesAssembled += chunk->indices.size() / 3);
+
+        for (size_t t = 0; t < chunk->indices.size(); t += 3) {
+            const Vertex& a = transformed[chunk->indices[t]];
+            const Vertex& b = transformed[chunk->indices[t + 1]];
+            const Vertex& c2 = transformed[chunk->indices[t + 2]];
+            if (!triangleOnScreen(a, b, c2, fb.width, fb.height)) {
+                STATS(pipelineStats.trianglesCulled++);
+                continue;
+            }
+            raster(fb, a, b, c2, white);
+        }
+    }
+
+    // Pedir lo que falta después de dibujar, para no competir con el hilo de E/S por el candado
+    mesh.request(wanted);
+}
+
+// Función para crear la matriz de modelo a partir de los ángulos de rotación (en grados)
+glm::mat4 createModelMatrix(float angleY, float angleX) {
+    // Crear matrices de transformación para la matriz de modelo
+    glm::mat4 translation = glm::translate(glm::mat4(1), glm::vec3(-0.05f, -0.09f, 0));
+    glm::mat4 rotationY = glm::rotate(glm::mat4(1), glm::radians(angleY), glm::vec3(0, 4, 0));
+    glm::mat4 rotationX = glm::rotate(glm::mat4(1), glm::radians(angleX), glm::vec3(1, 0, 0));
+    glm::mat4 scale = glm::scale(glm::mat4(1), glm::vec3(0.15f, 0.15f, 0.15f));
+
+    // Combinar las matrices de transformación
+    return translation * scale * rotationX * rotationY;
+}
+
+// Función para crear la matriz de vista
+glm::mat4 createViewMatrix() {
+
+    // Configurar la matriz de vista utilizando glm::lookAt
+    // para definir la posición de la cámara, el punto hacia donde mira y la dirección arriba
+    return glm::lookAt(
+            // donde esta
+            glm::vec3(0, 0, -5),
+            // hacia adonde mira
+            glm::vec3(0, 0, 0),
+            // arriba
+            glm::vec3(0, 1, 0)
+    );
+}
+
+// Función para crear la matriz de proyección
+glm::mat4 createProjectionMatrix(int width, int height) {
+    float fovInDegrees = 20.0f;
+    float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+    float nearClip = 0.1f;
+    float farClip = 100.0f;
+
+    return glm::perspective(glm::radians(fovInDegrees), aspectRatio, nearClip, farClip);
+}
+
+// Función para crear la matriz de vista en miniatura (viewport)
+glm::mat4 createViewportMatrix(int width, int height) {
+    glm::mat4 viewport = glm::mat4(1.0f);
+
+    // Escalar
+    viewport = glm::scale(viewport, glm::vec3(width / 2.0f, height / 2.0f, 0.5f));
+
+    // Trasladar
+    viewport = glm::translate(viewport, glm::vec3(1.0f, 1.0f, 0.5f));
+
+    return viewport;
+}
+
+// Función para escribir un archivo BMP a partir del z-buffer
+void writeBMP(const Framebuffer& fb, const std::string& filename) {
+    PROFILE_ZONE("writeBMP");
+
+    // Obtener el tamaño del framebuffer (ancho y alto)
+    int width = fb.width;
+    int height = fb.height;
+
+    // Encontrar el valor mínimo (zMin) y máximo (zMax) en el z-buffer
+    float zMin = std::numeric_limits<float>::max();
+    float zMax = std::numeric_limits<float>::lowest();
+
+    for (const auto& val : fb.depth) {
+        if (val != DEPTH_CLEAR) { // Ignorar valores que no han sido actualizados
+            zMin = std::min(zMin, val);
+            zMax = std::max(zMax, val);
+        }
+    }
+
+    // Verificar si zMin y zMax son iguales (posiblemente debido a un error)
+    if (zMin == zMax) {
+        std::cerr << "zMin y zMax son iguales. Esto producirá una imagen en blanco o negro.\n";
+        return;
+    }
+
+    // Imprimir los valores de zMin y zMax para referencia
+    std::cout << "zMin: " << zMin << ", zMax: " << zMax << "\n";
+
+    // Convertir el z-buffer en una imagen en escala de grises
+    std::vector<Color> pixels(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            // Normalizar los valores de profundidad en el z-buffer
+            float normalized = (fb.depth[static_cast<size_t>(y) * width + x] - zMin) / (zMax - zMin);
+
+            // Convertir el valor normalizado en un color de píxel
+            auto color = static_cast<uint8_t>(normalized * 255);
+            pixels[static_cast<size_t>(y) * width + x] = Color(color, color, color);
+        }
+    }
+
+    writeBMP24(filename, width, height, pixels);
+}
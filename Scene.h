@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "Mesh.h"
+#include "InstanceBVH.h"
+
+// Escena con varias mallas: cada malla se carga y optimiza una sola vez y se dibuja tantas veces como
+// instancias la referencian, cada una con su propia matriz de modelo y color.
+
+// Instancias que se transforman juntas en un lote de renderScene()
+const size_t INSTANCE_BATCH_SIZE = 64;
+
+// Copia de una malla colocada en la escena
+struct Instance {
+    uint32_t mesh;                     // Índice en Scene::meshes
+    glm::mat4 model;                   // Matriz de modelo propia de la instancia
+    Color color = Color(255, 255, 255); // Color que multiplica al sombreado (blanco = sin cambio)
+};
+
+struct Scene {
+    std::vector<Mesh> meshes;
+    std::vector<Instance> instances;
+
+    // Jerarquía para descartar instancias fuera del frustum; vacía hasta llamar a updateBVH()
+    InstanceBVH bvh;
+    bool bvhDirty = true;
+
+    // Error máximo en píxeles al elegir el nivel de detalle de cada instancia
+    float lodPixelError = 1.0f;
+
+    // Agrega una malla a la escena y devuelve su índice para crear instancias
+    uint32_t addMesh(Mesh mesh) {
+        meshes.push_back(std::move(mesh));
+        return static_cast<uint32_t>(meshes.size() - 1);
+    }
+
+    void addInstance(uint32_t mesh, const glm::mat4& model, const Color& color = Color(255, 255, 255)) {
+        instances.push_back(Instance{mesh, model, color});
+        bvhDirty = true;
+    }
+
+    // Mueve una instancia; la jerarquía se ajusta en la próxima llamada a updateBVH()
+    void setTransform(size_t instance, const glm::mat4& model) {
+        instances[instance].model = model;
+        bvhDirty = true;
+    }
+
+    // Caja de una instancia en el espacio de la escena, a partir de la caja de su malla calculada al cargarla
+    AABB instanceBounds(size_t instance) const {
+        return meshes[instances[instance].mesh].bounds.transformed(instances[instance].model);
+    }
+
+    // Construye la jerarquía si cambió el número de instancias, o solo ajusta sus cajas si se movieron
+    void updateBVH() {
+        if (!bvhDirty) {
+            return;
+        }
+        std::vector<AABB> bounds(instances.size());
+        for (size_t i = 0; i < instances.size(); i++) {
+            bounds[i] = instanceBounds(i);
+        }
+        if (bvh.itemBounds.size() == instances.size()) {
+            bvh.refit(bounds);
+        } else {
+            bvh.build(bounds);
+        }
+        bvhDirty = false;
+    }
+
+    // Triángulos dibujados si todas las instancias son visibles
+    size_t triangleCount() const {
+        size_t count = 0;
+        for (const Instance& instance : instances) {
+            count += meshes[instance.mesh].triangleCount();
+        }
+        return count;
+    }
+};
@@ -0,0 +1,577 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "ShaderUtilities.h"
+#include "Framebuffer.h"
+#include "Profiler.h"
+#include "PipelineStats.h"
+#include "PipelineState.h"
+#include "Interpolation.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "ShadowMap.h"
+
+// Programas de sombreado. Un programa es un tipo con:
+//
+//   using Attributes = ...;                                        // Entrada de cada vértice
+//   struct Varyings { ... };                                       // Salidas que se interpolan; solo floats
+//   glm::vec4 vertex(const Attributes& in, Varyings& out) const;   // Posición homogénea ya con el viewport,
+//                                                                  // igual que vertexShader()
+//   Color fragment(const Varyings& in, const FragmentInput& fragment) const;
+//
+// Un programa que necesita derivadas de sus varyings en pantalla (por ejemplo para elegir el mipmap) declara
+// 'static constexpr bool quads = true;' y en lugar de fragment() sombrea cuadros de 2x2 píxeles de una vez,
+// con las diferencias entre píxeles vecinos del cuadro en x y en y:
+//
+//   void fragmentQuad(const Varyings in[4], const Varyings& ddx, const Varyings& ddy,
+//                     const FragmentInput& quad, Color out[4]) const;
+//
+// in[i] y out[i] son los del píxel (x + i % 2, y + i / 2); quad.position es el píxel (x, y). Solo se escriben
+// los colores de los píxeles cubiertos que pasan la prueba de profundidad.
+//
+// draw<Program>() instancia el pipeline completo para el programa, así que vertex() y fragment() se
+// expanden en línea dentro de los bucles: sombrear a medida no cuesta más que las operaciones del propio programa.
+
+// Datos del píxel que recibe fragment() además de las varyings
+struct FragmentInput {
+    glm::vec3 position;   // Píxel y profundidad interpolada
+    glm::vec3 faceNormal; // Normal del triángulo en pantalla (la que usa el sombreado plano original)
+    float planeOffset;    // dot(A, faceNormal): con la normal, fija el plano del triángulo en pantalla
+};
+
+// Si el programa sombrea por cuadros de 2x2 (ver arriba)
+template <typename Program, typename = void>
+struct shadesQuads : std::false_type {};
+
+template <typename Program>
+struct shadesQuads<Program, std::void_t<decltype(Program::quads)>> : std::bool_constant<Program::quads> {};
+
+// Número de floats de un tipo de varyings
+template <typename Varyings>
+constexpr size_t varyingCount() {
+    static_assert(std::is_trivially_copyable_v<Varyings>, "las varyings deben poder copiarse como bytes");
+    if constexpr (std::is_empty_v<Varyings>) {
+        return 0;
+    } else {
+        static_assert(sizeof(Varyings) % sizeof(float) == 0, "las varyings solo pueden contener floats");
+        return sizeof(Varyings) / sizeof(float);
+    }
+}
+
+// Vértice que sale del sombreador, en pantalla y con sus varyings como floats consecutivos
+template <size_t N>
+struct ShadedVertex {
+    glm::vec3 position;
+    float invW; // 1/w antes de la división, para interpolar en perspectiva
+    std::array<float, N> varyings;
+};
+
+// Función para pasar las varyings de un programa a su forma de floats consecutivos y de vuelta
+template <typename Varyings, size_t N>
+inline void packVaryings(const Varyings& in, std::array<float, N>& out) {
+    if constexpr (N > 0) {
+        std::memcpy(out.data(), &in, sizeof(Varyings));
+    }
+}
+
+template <typename Varyings, size_t N>
+inline void unpackVaryings(const std::array<float, N>& in, Varyings& out) {
+    if constexpr (N > 0) {
+        std::memcpy(&out, in.data(), sizeof(Varyings));
+    }
+}
+
+// Función para saber si el píxel (x, y) está dentro del triángulo y obtener su profundidad con las mismas
+// operaciones que rasterTriangle(), para que los programas cubran exactamente los mismos píxeles
+inline bool programCoverage(int x, int y, const glm::vec3& A, const glm::vec3& B, const glm::vec3& C, float& z) {
+    glm::vec3 bar = barycentricCoordinates(glm::vec3(x, y, 0), A, B, C);
+    z = A.z * bar.x + B.z * bar.y + C.z * bar.z;
+    return bar.x <= 1 && bar.x >= 0 && bar.y <= 1 && bar.y >= 0 && bar.z <= 1 && bar.z >= 0;
+}
+
+// Función para rasterizar un triángulo con el programa dado.
+// Cobertura y profundidad se calculan por píxel como en rasterTriangle() (ver programCoverage()); las varyings
+// salen de planos preparados una vez (ver Interpolation.h) que avanzan con una suma por píxel, interpoladas como
+// varying/w y divididas por 1/w, correctas en perspectiva.
+template <typename Program, CullMode Cull, DepthFunc Func, bool DepthWrite, OutputFormat Output, size_t N>
+inline void rasterProgramTriangle(Framebuffer& fb, const Program& program,
+                                  const ShadedVertex<N>& a, const ShadedVertex<N>& b, const ShadedVertex<N>& c) {
+    const glm::vec3& A = a.position;
+    const glm::vec3& B = b.position;
+    const glm::vec3& C = c.position;
+    if (faceCulled<Cull>(A, B, C)) {
+        STATS(pipelineStats.trianglesCulled++);
+        return;
+    }
+
+    // 1/w y cada varying dividida por w
+    TriangleSetup setup(A, B, C);
+    constexpr bool shade = Output == OutputFormat::Color;
+    PlaneSet<N + 1> perspective;
+    if constexpr (shade) {
+        perspective.set(N, setup.plane(a.invW, b.invW, c.invW));
+        for (size_t k = 0; k < N; k++) {
+            perspective.set(k, setup.plane(a.varyings[k] * a.invW, b.varyings[k] * b.invW, c.varyings[k] * c.invW));
+        }
+    }
+
+    FragmentInput input;
+    if constexpr (shade) {
+        input.faceNormal = glm::normalize(glm::cross(B - A, C - A));
+        input.planeOffset = glm::dot(A, input.faceNormal);
+    }
+    typename Program::Varyings varyings;
+    std::array<float, N + 1> over;
+    std::array<float, N> values;
+
+    PixelRect box = rasterBounds(fb, A, B, C);
+    for (int y = box.minY; y <= box.maxY; y++) {
+        float* depthRow = &fb.depth[static_cast<size_t>(y) * fb.width];
+        Color* colorRow = shade ? &fb.color[static_cast<size_t>(y) * fb.width] : nullptr; // Vacío en los mapas de sombras
+        if constexpr (shade) {
+            perspective.evaluate(static_cast<float>(box.minX), static_cast<float>(y), over);
+        }
+        for (int x = box.minX; x <= box.maxX; x++) {
+            STATS(pipelineStats.boxPixels++);
+            float z;
+            bool inside = programCoverage(x, y, A, B, C, z);
+            bool passed = inside && depthTest<Func>(z, depthRow[x]);
+            STATS(if (inside) { pipelineStats.coveredPixels++; pipelineStats.countDepthTest(x, y, passed); });
+            if (passed) {
+                if constexpr (DepthWrite) {
+                    depthRow[x] = z;
+                }
+                if constexpr (shade) {
+                    float w = 1.0f / over[N];
+                    for (size_t k = 0; k < N; k++) {
+                        values[k] = over[k] * w;
+                    }
+                    unpackVaryings(values, varyings);
+                    input.position = glm::vec3(x, y, z);
+                    colorRow[x] = program.fragment(varyings, input);
+                }
+            }
+
+            if constexpr (shade) {
+                perspective.stepX(over);
+            }
+        }
+    }
+}
+
+// Función para rasterizar un triángulo con un programa que sombrea por cuadros. Recorre la caja en cuadros de 2x2
+// píxeles alineados; en cada cuadro con algún píxel que pasa la prueba de profundidad interpola las varyings en
+// los cuatro (también en los que quedan fuera del triángulo, como hace una GPU) y las derivadas son las
+// diferencias dentro del cuadro.
+// Cobertura y profundidad son las de rasterProgramTriangle() (programCoverage()).
+template <typename Program, CullMode Cull, DepthFunc Func, bool DepthWrite, size_t N>
+inline void rasterProgramQuads(Framebuffer& fb, const Program& program,
+                               const ShadedVertex<N>& a, const ShadedVertex<N>& b, const ShadedVertex<N>& c) {
+    const glm::vec3& A = a.position;
+    const glm::vec3& B = b.position;
+    const glm::vec3& C = c.position;
+    if (faceCulled<Cull>(A, B, C)) {
+        STATS(pipelineStats.trianglesCulled++);
+        return;
+    }
+
+    TriangleSetup setup(A, B, C);
+    PlaneSet<N + 1> perspective;
+    perspective.set(N, setup.plane(a.invW, b.invW, c.invW));
+    for (size_t k = 0; k < N; k++) {
+        perspective.set(k, setup.plane(a.varyings[k] * a.invW, b.varyings[k] * b.invW, c.varyings[k] * c.invW));
+    }
+
+    FragmentInput input;
+    input.faceNormal = glm::normalize(glm::cross(B - A, C - A));
+    input.planeOffset = glm::dot(A, input.faceNormal);
+    typename Program::Varyings varyings[4];
+    typename Program::Varyings ddx, ddy;
+    std::array<float, N + 1> over;
+    std::array<float, N> values[4];
+    std::array<float, N> difference;
+    Color colors[4];
+
+    PixelRect box = rasterBounds(fb, A, B, C);
+    int startX = box.minX & ~1;
+    int startY = box.minY & ~1;
+    bool rowInBox[2];
+
+    // Cuadro con esquina superior izquierda en (x, y); 'over' tiene los planos evaluados en esa esquina
+    auto rasterQuad = [&](int x, int y) {
+        STATS(pipelineStats.boxPixels += ((x >= box.minX) + (x + 1 <= box.maxX)) * (rowInBox[0] + rowInBox[1]));
+
+        // Cobertura y prueba de profundidad de los cuatro píxeles, (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1),
+        // antes de sombrear: un cuadro tapado por completo no llega al programa
+        bool passed[4];
+        bool anyPassed = false;
+        float depth[4];
+        for (int i = 0; i < 4; i++) {
+            bool inBox = rowInBox[i >> 1] && ((i & 1) ? x + 1 <= box.maxX : x >= box.minX);
+            bool covered = programCoverage(x + (i & 1), y + (i >> 1), A, B, C, depth[i]) && inBox;
+            passed[i] = false;
+            if (covered) {
+                size_t pixel = static_cast<size_t>(y + (i >> 1)) * fb.width + x + (i & 1);
+                passed[i] = depthTest<Func>(depth[i], fb.depth[pixel]);
+                STATS(pipelineStats.coveredPixels++; pipelineStats.countDepthTest(x + (i & 1), y + (i >> 1), passed[i]));
+                if constexpr (DepthWrite) {
+                    fb.depth[pixel] = passed[i] ? depth[i] : fb.depth[pixel];
+                }
+                anyPassed = anyPassed || passed[i];
+            }
+        }
+        if (!anyPassed) {
+            return;
+        }
+
+        for (int i = 0; i < 4; i++) {
+            std::array<float, N + 1> corner = over;
+            perspective.step(corner, static_cast<float>(i & 1), static_cast<float>(i >> 1));
+            float w = 1.0f / corner[N];
+            for (size_t k = 0; k < N; k++) {
+                values[i][k] = corner[k] * w;
+            }
+            unpackVaryings(values[i], varyings[i]);
+        }
+        for (size_t k = 0; k < N; k++) {
+            difference[k] = values[1][k] - values[0][k];
+        }
+        unpackVaryings(difference, ddx);
+        for (size_t k = 0; k < N; k++) {
+            difference[k] = values[2][k] - values[0][k];
+        }
+        unpackVaryings(difference, ddy);
+
+        input.position = glm::vec3(x, y, depth[0]);
+        program.fragmentQuad(varyings, ddx, ddy, input, colors);
+        for (int i = 0; i < 4; i++) {
+            if (passed[i]) {
+                fb.color[static_cast<size_t>(y + (i >> 1)) * fb.width + x + (i & 1)] = colors[i];
+            }
+        }
+    };
+
+    for (int y = startY; y <= box.maxY; y += 2) {
+        perspective.evaluate(static_cast<float>(startX), static_cast<float>(y), over);
+        rowInBox[0] = y >= box.minY;
+        rowInBox[1] = y + 1 <= box.maxY;
+        for (int x = startX; x <= box.maxX; x += 2) {
+            rasterQuad(x, y);
+            perspective.step(over, 2.0f, 0.0f);
+        }
+    }
+}
+
+// Función para dibujar triángulos indexados con un programa de sombreado; fetch(i) devuelve los atributos
+// del vértice i. Cada vértice se sombrea una sola vez; el estado se resuelve una vez por llamada (withPipelineState).
+template <typename Program, typename Fetch>
+void drawVertices(Framebuffer& fb, const Program& program, size_t vertexCount, Fetch fetch,
+                  const std::vector<uint32_t>& indices, const PipelineState& state = PipelineState()) {
+    PROFILE_ZONE("render");
+    constexpr size_t N = varyingCount<typename Program::Varyings>();
+    std::vector<ShadedVertex<N>> shaded(vertexCount);
+    {
+        PROFILE_ZONE("vertexShader");
+        typename Program::Varyings varyings;
+        for (size_t i = 0; i < vertexCount; i++) {
+            glm::vec4 r = program.vertex(fetch(i), varyings);
+            shaded[i].position = glm::vec3(r.x / r.w, r.y / r.w, r.z / r.w);
+            shaded[i].invW = 1.0f / r.w;
+            packVaryings(varyings, shaded[i].varyings);
+        }
+        STATS(pipelineStats.verticesShaded += vertexCount);
+        STATS(pipelineStats.trianglesAssembled += indices.size() / 3);
+    }
+
+    PROFILE_ZONE("rasterize");
+    withPipelineState(state, [&](auto cull, auto depthFunc, auto depthWrite, auto output) {
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            const ShadedVertex<N>& a = shaded[indices[t]];
+            const ShadedVertex<N>& b = shaded[indices[t + 1]];
+            const ShadedVertex<N>& c = shaded[indices[t + 2]];
+            if (!triangleOnScreen(Vertex{a.position, Color()}, Vertex{b.position, Color()}, Vertex{c.position, Color()}, fb.width, fb.height)) {
+                STATS(pipelineStats.trianglesCulled++);
+                continue;
+            }
+            if constexpr (shadesQuads<Program>::value && decltype(output)::value == OutputFormat::Color) {
+                rasterProgramQuads<Program, decltype(cull)::value, decltype(depthFunc)::value, decltype(depthWrite)::value>(fb, program, a, b, c);
+            } else {
+                rasterProgramTriangle<Program, decltype(cull)::value, decltype(depthFunc)::value, decltype(depthWrite)::value,
+                                      decltype(output)::value>(fb, program, a, b, c);
+            }
+        }
+    });
+}
+
+// Función para dibujar una malla indexada con un programa de sombreado
+template <typename Program>
+void draw(Framebuffer& fb, const Program& program, const std::vector<typename Program::Attributes>& vertices,
+          const std::vector<uint32_t>& indices, const PipelineState& state = PipelineState()) {
+    drawVertices(fb, program, vertices.size(), [&](size_t i) -> const typename Program::Attributes& { return vertices[i]; },
+                 indices, state);
+}
+
+// Transformación de normales del espacio del modelo a pantalla, para que coincidan con la normal de cara que
+// calcula el sombreado plano a partir de las posiciones ya proyectadas. La normal se multiplica por los
+// cofactores del jacobiano de la proyección en el vértice; con F = viewport * proyección * vista * modelo,
+// filas F0..F2 y fila homogénea h (partes lineales), eso es P * n - s x (W * n), donde s es la posición en
+// pantalla, P tiene filas F1 x F2, F2 x F0, F0 x F1 y W filas h x F0, h x F1, h x F2. P y W se preparan una vez.
+struct ScreenNormalTransform {
+    glm::mat3 P;
+    glm::mat3 W;
+
+    explicit ScreenNormalTransform(const glm::mat4& transform) {
+        glm::vec3 rows[3];
+        for (int i = 0; i < 3; i++) {
+            rows[i] = glm::vec3(transform[0][i], transform[1][i], transform[2][i]);
+        }
+        glm::vec3 h(transform[0][3], transform[1][3], transform[2][3]);
+        // glm guarda por columnas: se arman las traspuestas y se trasponen
+        P = glm::transpose(glm::mat3(glm::cross(rows[1], rows[2]), glm::cross(rows[2], rows[0]), glm::cross(rows[0], rows[1])));
+        W = glm::transpose(glm::mat3(glm::cross(h, rows[0]), glm::cross(h, rows[1]), glm::cross(h, rows[2])));
+    }
+
+    // Normal en pantalla (sin normalizar) del vértice con normal 'normal' y posición proyectada 'screenPosition'
+    glm::vec3 operator()(const glm::vec3& screenPosition, const glm::vec3& normal) const {
+        return P * normal - glm::cross(screenPosition, W * normal);
+    }
+};
+
+// Función para sumar a la intensidad de las luces direccionales, atenuada por el mapa de sombras si lo hay,
+// la de las luces con alcance del mosaico del fragmento (ver LightGrid); sin rejilla de luces solo cuentan
+// las direccionales
+inline float sceneIntensity(const LightGrid* lights, const ShadowMap* shadows, const glm::vec3& position, const glm::vec3& N) {
+    float intensity = lightIntensity(N);
+    if (shadows) {
+        intensity *= shadows->visibility(position);
+    }
+    if (lights) {
+        intensity += lights->shade(position, N);
+    }
+    return intensity;
+}
+
+// Programa equivalente al pipeline fijo: transforma con las matrices del uniforme y sombrea cada cara
+// con las luces de la escena. Con una rejilla de luces, las puntuales y los focos se evalúan por píxel, igual
+// que la sombra con un mapa de sombras.
+struct FlatProgram {
+    using Attributes = glm::vec3;
+    struct Varyings {};
+
+    glm::mat4 transform; // viewport * proyección * vista * modelo, en el orden de vertexShader()
+    const LightGrid* lights;
+    const ShadowMap* shadows;
+
+    explicit FlatProgram(const Uniform& u, const LightGrid* grid = nullptr, const ShadowMap* shadowMap = nullptr)
+            : transform(u.viewport * u.projection * u.view * u.model), lights(grid), shadows(shadowMap) {}
+
+    glm::vec4 vertex(const glm::vec3& position, Varyings&) const {
+        return transform * glm::vec4(position, 1.0f);
+    }
+
+    Color fragment(const Varyings&, const FragmentInput& in) const {
+        return intensityColor(sceneIntensity(lights, shadows, in.position, in.faceNormal));
+    }
+};
+
+// Programa sin iluminación que interpola el color de los vértices
+struct VertexColorProgram {
+    using Attributes = Vertex;
+    struct Varyings {
+        glm::vec4 color;
+    };
+
+    glm::mat4 transform;
+
+    explicit VertexColorProgram(const Uniform& u) : transform(u.viewport * u.projection * u.view * u.model) {}
+
+    glm::vec4 vertex(const Vertex& in, Varyings& out) const {
+        out.color = glm::vec4(in.color.r, in.color.g, in.color.b, in.color.a);
+        return transform * glm::vec4(in.position, 1.0f);
+    }
+
+    Color fragment(const Varyings& in, const FragmentInput&) const {
+        return Color(static_cast<int>(in.color.r + 0.5f), static_cast<int>(in.color.g + 0.5f),
+                     static_cast<int>(in.color.b + 0.5f), static_cast<int>(in.color.a + 0.5f));
+    }
+};
+
+// Atributos de un vértice de Mesh para los programas con iluminación suave
+struct MeshVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+// Programa con iluminación por vértice (Gouraud): la luz se evalúa una vez por vértice único y se interpola.
+// Solo usa las luces direccionales: las luces con alcance se reparten por mosaicos de píxeles.
+struct GouraudProgram {
+    using Attributes = MeshVertex;
+    struct Varyings {
+        float intensity;
+    };
+
+    glm::mat4 transform;
+    ScreenNormalTransform normalTransform;
+
+    explicit GouraudProgram(const Uniform& u)
+            : transform(u.viewport * u.projection * u.view * u.model), normalTransform(transform) {}
+
+    glm::vec4 vertex(const MeshVertex& in, Varyings& out) const {
+        glm::vec4 r = transform * glm::vec4(in.position, 1.0f);
+        glm::vec3 screen(r.x / r.w, r.y / r.w, r.z / r.w);
+        out.intensity = lightIntensity(glm::normalize(normalTransform(screen, in.normal)));
+        return r;
+    }
+
+    Color fragment(const Varyings& in, const FragmentInput&) const {
+        return intensityColor(in.intensity);
+    }
+};
+
+// Programa con iluminación por píxel (Phong): se interpola la normal y la luz se evalúa en cada fragmento
+struct PhongProgram {
+    using Attributes = MeshVertex;
+    struct Varyings {
+        glm::vec3 normal;
+    };
+
+    glm::mat4 transform;
+    ScreenNormalTransform normalTransform;
+    const LightGrid* lights;
+    const ShadowMap* shadows;
+
+    explicit PhongProgram(const Uniform& u, const LightGrid* grid = nullptr, const ShadowMap* shadowMap = nullptr)
+            : transform(u.viewport * u.projection * u.view * u.model), normalTransform(transform), lights(grid), shadows(shadowMap) {}
+
+    glm::vec4 vertex(const MeshVertex& in, Varyings& out) const {
+        glm::vec4 r = transform * glm::vec4(in.position, 1.0f);
+        glm::vec3 screen(r.x / r.w, r.y / r.w, r.z / r.w);
+        out.normal = glm::normalize(normalTransform(screen, in.normal));
+        return r;
+    }
+
+    Color fragment(const Varyings& in, const FragmentInput& fragment) const {
+        return intensityColor(sceneIntensity(lights, shadows, fragment.position, glm::normalize(in.normal)));
+    }
+};
+
+// Atributos de un vértice de Mesh para los programas con textura
+struct TexturedVertex {
+    glm::vec3 position;
+    glm::vec2 texcoord;
+};
+
+// Programa con textura e iluminación por cara: el color de la textura se multiplica por el del sombreado plano.
+// Sombrea por cuadros: el nivel del mipmap y la luz se calculan una vez por cuadro y las cuatro muestras se
+// toman juntas (ver sampleTextureQuad()); las luces con alcance y la sombra también se evalúan una vez por cuadro.
+struct TexturedProgram {
+    using Attributes = TexturedVertex;
+    struct Varyings {
+        glm::vec2 texcoord;
+    };
+    static constexpr bool quads = true;
+
+    glm::mat4 transform;
+    const Texture* texture;
+    TextureFilter filter;
+    const LightGrid* lights;
+    const ShadowMap* shadows;
+
+    TexturedProgram(const Uniform& u, const Texture& t, TextureFilter f, const LightGrid* grid = nullptr, const ShadowMap* shadowMap = nullptr)
+            : transform(u.viewport * u.projection * u.view * u.model), texture(&t), filter(f), lights(grid), shadows(shadowMap) {}
+
+    glm::vec4 vertex(const TexturedVertex& in, Varyings& out) const {
+        out.texcoord = in.texcoord;
+        return transform * glm::vec4(in.position, 1.0f);
+    }
+
+    void fragmentQuad(const Varyings in[4], const Varyings& ddx, const Varyings& ddy, const FragmentInput& quad, Color out[4]) const {
+        float lod = textureLod(*texture, ddx.texcoord, ddy.texcoord);
+        glm::vec2 texcoords[4] = {in[0].texcoord, in[1].texcoord, in[2].texcoord, in[3].texcoord};
+        sampleTextureQuad(*texture, texcoords, lod, filter, out);
+        Color light = intensityColor(sceneIntensity(lights, shadows, quad.position, quad.faceNormal));
+        for (int i = 0; i < 4; i++) {
+            out[i] = modulate(out[i], light);
+        }
+    }
+};
+
+// Dónde se evalúa la iluminación en drawMesh()
+enum class LightingMode : uint8_t {
+    Flat,    // Por cara
+    Gouraud, // Por vértice, interpolada
+    Phong    // Por píxel, con la normal interpolada
+};
+
+// Función para dibujar una malla con el modo de iluminación dado. Los modos suaves usan Mesh::normals
+// (ver buildMesh() con normales); una malla sin normales se dibuja con iluminación por cara.
+// 'lights' son las luces con alcance del cuadro (ver cullLights()); sin ella solo cuentan las direccionales.
+// 'shadows' es el mapa de sombras del cuadro (ver prepareShadowMap()) o nullptr para dibujar sin sombras.
+void drawMesh(Framebuffer& fb, const Mesh& mesh, const Uniform& uniform, LightingMode mode,
+              const PipelineState& state = PipelineState(), const LightGrid* lights = nullptr, const ShadowMap* shadows = nullptr) {
+    if (mode == LightingMode::Flat || mesh.normals.size() != mesh.positions.size()) {
+        draw(fb, FlatProgram(uniform, lights, shadows), mesh.positions, mesh.indices, state);
+        return;
+    }
+    auto fetch = [&](size_t i) {
+        return MeshVertex{mesh.positions[i], mesh.normals[i]};
+    };
+    if (mode == LightingMode::Gouraud) {
+        drawVertices(fb, GouraudProgram(uniform), mesh.positions.size(), fetch, mesh.indices, state);
+    } else {
+        drawVertices(fb, PhongProgram(uniform, lights, shadows), mesh.positions.size(), fetch, mesh.indices, state);
+    }
+}
+
+// Función para dibujar una malla con textura (ver TexturedProgram). Usa Mesh::texcoords (ver buildMesh() con
+// coordenadas de textura); una malla sin ellas se dibuja sin textura.
+void drawTexturedMesh(Framebuffer& fb, const Mesh& mesh, const Uniform& uniform, const Texture& texture, TextureFilter filter,
+                      const PipelineState& state = PipelineState(), const LightGrid* lights = nullptr,
+                      const ShadowMap* shadows = nullptr) {
+    if (mesh.texcoords.size() != mesh.positions.size() || texture.levels.empty()) {
+        draw(fb, FlatProgram(uniform, lights, shadows), mesh.positions, mesh.indices, state);
+        return;
+    }
+    auto fetch = [&](size_t i) {
+        return TexturedVertex{mesh.positions[i], mesh.texcoords[i]};
+    };
+    drawVertices(fb, TexturedProgram(uniform, texture, filter, lights, shadows), mesh.positions.size(), fetch, mesh.indices, state);
+}
+
+// Programa de solo profundidad para las pasadas sin color (mapas de sombras, pasadas previas de Z): sin varyings,
+// así que con OutputFormat::DepthOnly el rasterizador solo recorre cobertura y profundidad
+struct DepthProgram {
+    using Attributes = glm::vec3;
+    struct Varyings {};
+
+    glm::mat4 transform;
+
+    explicit DepthProgram(const Uniform& u) : transform(u.viewport * u.projection * u.view * u.model) {}
+
+    glm::vec4 vertex(const glm::vec3& position, Varyings&) const {
+        return transform * glm::vec4(position, 1.0f);
+    }
+
+    Color fragment(const Varyings&, const FragmentInput&) const {
+        return Color();
+    }
+};
+
+// Función para dibujar una malla con la matriz de modelo dada en todas las cascadas del mapa de sombras.
+// Se dibujan las dos caras de los triángulos: las mallas no siempre son cerradas.
+void drawShadowCaster(ShadowMap& shadows, const Mesh& mesh, const glm::mat4& model) {
+    PROFILE_ZONE("shadowPass");
+    PipelineState state;
+    state.output = OutputFormat::DepthOnly;
+    for (ShadowCascade& cascade : shadows.cascades) {
+        Uniform light = cascade.light;
+        light.model = model;
+        draw(cascade.map, DepthProgram(light), mesh.positions, mesh.indices, state);
+    }
+}
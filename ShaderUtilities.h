@@ -1,6 +1,8 @@
 #pragma once
 #include "GraphicsStructures.h" // Incluye tus estructuras de datos personalizadas
 #include "glm/glm.hpp" // Incluye la biblioteca GLM para operaciones matemáticas
+#include "PipelineStats.h"
+#include "Lighting.h"
 #include <cmath>
 #include <random>
 
@@ -22,8 +24,16 @@ Fragment fragmentShader(Fragment fragment) {
     return fragment;
 };
 
-// Definición de un vector de luz
-glm::vec3 light = normalize(glm::vec3(0.5, 0.5, 1));
+// Función para calcular la intensidad de las luces direccionales de la escena (ver Lighting.h) sobre una
+// superficie con normal N (en pantalla)
+float lightIntensity(const glm::vec3& N) {
+    return directionalIntensity(sceneLights, N);
+}
+
+// Función para convertir una intensidad de luz en el color del fragmento
+Color intensityColor(float intensity) {
+    return Color(255 * intensity, 255 * intensity, 255 * intensity);
+}
 
 // Función para calcular las coordenadas baricéntricas de un punto en relación a un triángulo
 glm::vec3 barycentricCoordinates(const glm::vec3& P, const glm::vec3& A, const glm::vec3& B, const glm::vec3& C) {
@@ -66,6 +76,7 @@ std::vector<Fragment> triangle(Vertex a, Vertex b, Vertex c) {
     for (float y = minY; y <= maxY; y++) {
         for (float x = minX; x <= maxX; x++) {
             glm::vec3 P = glm::vec3(x, y, 0);
+            STATS(pipelineStats.boxPixels++);
 
             glm::vec3 bar = barycentricCoordinates(P, A, B, C);
 
@@ -75,12 +86,13 @@ std::vector<Fragment> triangle(Vertex a, Vertex b, Vertex c) {
                     bar.y <= 1 && bar.y >= 0 &&
                     bar.z <= 1 && bar.z >= 0
                     ) {
+                STATS(pipelineStats.coveredPixels++);
+
                 // Calcula la coordenada Z interpolada
                 P.z = a.position.z * bar.x + b.position.z * bar.y + c.position.z * bar.z;
 
                 // Calcula la intensidad de la luz y asigna un color al fragmento
-                float intensity = glm::dot(N, light) * 10;
-                Color color = Color(255 * intensity, 255 * intensity, 255 * intensity);
+                Color color = intensityColor(lightIntensity(N));
 
                 // Agrega el fragmento a la lista de fragmentos del triángulo
                 triangleFragments.push_back(Fragment{P, color});
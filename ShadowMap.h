@@ -0,0 +1,148 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "GraphicsStructures.h"
+#include "Framebuffer.h"
+#include "Renderer.h"
+
+// Sombras de la luz direccional con mapas de sombras en cascada. Cada cuadro, prepareShadowMap() divide el
+// frustum de la cámara en tramos de distancia y ajusta a cada uno una proyección ortográfica desde la luz;
+// las mallas se dibujan en cada cascada con una pasada de solo profundidad (drawShadowCaster() en
+// ShaderProgram.h) y al sombrear, ShadowMap::visibility() compara la profundidad del fragmento vista desde la
+// luz con la del mapa. Más resolución o más cascadas dan sombras más finas a cambio de más tiempo de pasada.
+
+// Filtrado de la comparación con el mapa (percentage-closer filtering)
+enum class ShadowFilter : uint8_t {
+    Hard,   // Una muestra
+    PCF3x3, // Promedio de 3x3 comparaciones
+    PCF5x5  // Promedio de 5x5 comparaciones
+};
+
+const int SHADOW_MAX_CASCADES = 4;
+
+// Profundidad del plano lejano de la luz en el mapa: createViewportMatrix() lleva la z normalizada [-1, 1] a
+// [-0.25, 0.75]. Un fragmento más lejano queda fuera del volumen de la cascada y se busca en la siguiente
+const float SHADOW_FAR_DEPTH = (createViewportMatrix(1, 1) * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)).z;
+
+struct ShadowSettings {
+    int resolution = 1024;                      // Lado de cada mapa en téxeles
+    int cascades = 1;                           // Tramos del frustum, de 1 a SHADOW_MAX_CASCADES
+    ShadowFilter filter = ShadowFilter::PCF3x3;
+    float distance = 10.0f;                     // Distancia desde la cámara que cubren las sombras
+    float splitBlend = 0.75f;                   // Reparto de los tramos: 0 uniforme, 1 logarítmico
+    float bias = 0.02f;                         // Margen de profundidad, en unidades del mundo
+};
+
+struct ShadowCascade {
+    Framebuffer map;          // Solo profundidad: el búfer de color queda vacío
+    Uniform light;            // Vista, proyección y viewport de la luz; el modelo lo pone cada malla
+    glm::mat4 screenToShadow; // De la pantalla de la cámara a la pantalla del mapa
+    float depthBias;          // 'bias' en unidades de profundidad del mapa
+};
+
+struct ShadowMap {
+    ShadowSettings settings;
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f); // Hacia la luz, en el mundo
+    std::vector<ShadowCascade> cascades;
+
+    // Función para obtener la fracción iluminada (0 a 1) del fragmento en 'screenPosition' (pantalla de la
+    // cámara). Usa la primera cascada que contiene el punto, la de más resolución; fuera de todas, está iluminado.
+    float visibility(const glm::vec3& screenPosition) const {
+        for (const ShadowCascade& cascade : cascades) {
+            glm::vec4 p = cascade.screenToShadow * glm::vec4(screenPosition, 1.0f);
+            float x = p.x / p.w;
+            float y = p.y / p.w;
+            float z = p.z / p.w - cascade.depthBias;
+            int size = cascade.map.width;
+            if (x < 0.0f || y < 0.0f || x >= static_cast<float>(size) || y >= static_cast<float>(size) ||
+                z > SHADOW_FAR_DEPTH) {
+                continue;
+            }
+
+            int radius = settings.filter == ShadowFilter::PCF5x5 ? 2 : settings.filter == ShadowFilter::PCF3x3 ? 1 : 0;
+            int cx = static_cast<int>(x);
+            int cy = static_cast<int>(y);
+            int lit = 0;
+            for (int dy = -radius; dy <= radius; dy++) {
+                // La fila y la columna 0 nunca se rasterizan (ver rasterBounds()): se leen las vecinas
+                const float* row = &cascade.map.depth[static_cast<size_t>(std::clamp(cy + dy, 1, size - 1)) * size];
+                for (int dx = -radius; dx <= radius; dx++) {
+                    lit += z <= row[std::clamp(cx + dx, 1, size - 1)];
+                }
+            }
+            return static_cast<float>(lit) / static_cast<float>((2 * radius + 1) * (2 * radius + 1));
+        }
+        return 1.0f;
+    }
+};
+
+// Función para preparar las cascadas de un cuadro: ajusta la proyección de la luz a cada tramo del frustum de
+// 'camera' (su vista, proyección y viewport) y limpia los mapas. 'direction' apunta hacia la luz, en el mundo.
+void prepareShadowMap(ShadowMap& shadows, const ShadowSettings& settings, const glm::vec3& direction, const Uniform& camera) {
+    shadows.settings = settings;
+    shadows.direction = glm::normalize(direction);
+    int count = std::clamp(settings.cascades, 1, SHADOW_MAX_CASCADES);
+    shadows.cascades.resize(static_cast<size_t>(count));
+
+    // Planos cercano y lejano de la proyección en perspectiva, y esquinas del plano lejano en la vista
+    const glm::mat4& P = camera.projection;
+    float nearPlane = P[3][2] / (P[2][2] - 1.0f);
+    float farPlane = std::min(P[3][2] / (P[2][2] + 1.0f), nearPlane + settings.distance);
+    glm::mat4 inverseProjection = glm::inverse(P);
+    glm::mat4 inverseView = glm::inverse(camera.view);
+    glm::vec3 farCorners[4];
+    for (int i = 0; i < 4; i++) {
+        glm::vec4 corner = inverseProjection * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, 1.0f, 1.0f);
+        farCorners[i] = glm::vec3(corner) / corner.w;
+    }
+    float farDepth = -farCorners[0].z;
+    glm::mat4 cameraToScreen = camera.viewport * camera.projection * camera.view;
+    glm::mat4 screenToWorld = glm::inverse(cameraToScreen);
+    glm::vec3 up = std::abs(shadows.direction.y) > 0.99f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+
+    float splitNear = nearPlane;
+    for (int c = 0; c < count; c++) {
+        // Fin del tramo: mezcla del reparto uniforme y el logarítmico
+        float t = static_cast<float>(c + 1) / static_cast<float>(count);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+        float splitFar = uniformSplit + (logSplit - uniformSplit) * settings.splitBlend;
+
+        // Esfera que contiene las 8 esquinas del tramo: su tamaño no cambia al girar la cámara
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < 8; i++) {
+            float depth = i < 4 ? splitNear : splitFar;
+            corners[i] = glm::vec3(inverseView * glm::vec4(farCorners[i & 3] * (depth / farDepth), 1.0f));
+            center += corners[i] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const glm::vec3& corner : corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+
+        // Proyección ortográfica que cubre la esfera; se extiende 'distance' hacia la luz para incluir las
+        // mallas que, fuera del tramo, le hacen sombra
+        ShadowCascade& cascade = shadows.cascades[c];
+        float depthRange = 2.0f * radius + settings.distance;
+        cascade.light.model = glm::mat4(1.0f);
+        cascade.light.view = glm::lookAt(center + shadows.direction * (radius + settings.distance), center, up);
+        cascade.light.projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, depthRange);
+        cascade.light.viewport = createViewportMatrix(settings.resolution, settings.resolution);
+        cascade.screenToShadow = cascade.light.viewport * cascade.light.projection * cascade.light.view * screenToWorld;
+        // El viewport lleva todo el rango a una unidad de profundidad, hasta SHADOW_FAR_DEPTH en el plano lejano
+        cascade.depthBias = settings.bias / depthRange;
+
+        if (cascade.map.width != settings.resolution) {
+            cascade.map.width = settings.resolution;
+            cascade.map.height = settings.resolution;
+            cascade.map.color.clear();
+        }
+        cascade.map.depth.assign(static_cast<size_t>(settings.resolution) * settings.resolution, DEPTH_CLEAR);
+        splitNear = splitFar;
+    }
+}
@@ -0,0 +1,334 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glm/glm.hpp"
+#include "ObjLoader.h"
+#include "Mesh.h"
+#include "InstanceBVH.h"
+
+// Mallas fuera de memoria: el archivo se divide en trozos espacialmente compactos que se cargan bajo demanda
+// en un caché con presupuesto fijo de memoria. Un hilo de E/S en segundo plano lee los trozos que el
+// renderizador pide (primero los visibles, luego los que están cerca del frustum) y descarta los menos usados.
+//
+// Formato del archivo (little-endian): ChunkedMeshHeader, tabla de ChunkInfo y los datos de cada trozo
+// (vertexCount posiciones glm::vec3 seguidas de triangleCount * 3 índices locales uint32_t).
+
+const char CHUNKED_MESH_MAGIC[4] = {'S', 'R', 'M', 'C'};
+const uint32_t CHUNKED_MESH_VERSION = 1;
+
+// Triángulos por trozo al convertir una malla
+const size_t CHUNK_TRIANGLES = 16384;
+
+struct ChunkedMeshHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t chunkCount;
+    uint32_t reserved;
+    AABB bounds;
+};
+
+struct ChunkInfo {
+    AABB bounds;
+    uint64_t offset;        // Posición de los datos del trozo en el archivo
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+
+    size_t bytes() const {
+        return vertexCount * sizeof(glm::vec3) + triangleCount * 3 * sizeof(uint32_t);
+    }
+};
+
+// Datos de un trozo cargado
+struct ChunkData {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices; // Índices locales al trozo
+};
+
+// Función para escribir una malla como archivo de trozos.
+// Los triángulos se reparten por la mediana de sus centros en el eje más largo hasta que cada grupo tiene
+// a lo sumo 'trianglesPerChunk'; dentro de cada trozo se conserva el orden original (el de optimizeMesh()).
+bool writeChunkedMesh(const std::string& path, const Mesh& mesh, size_t trianglesPerChunk = CHUNK_TRIANGLES) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: No se pudo crear el archivo " << path << std::endl;
+        return false;
+    }
+
+    size_t triangleCount = mesh.triangleCount();
+    std::vector<uint32_t> triangles(triangleCount);
+    std::vector<glm::vec3> centers(triangleCount);
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        triangles[t] = t;
+        centers[t] = (mesh.positions[mesh.indices[t * 3]] + mesh.positions[mesh.indices[t * 3 + 1]] + mesh.positions[mesh.indices[t * 3 + 2]]) / 3.0f;
+    }
+
+    // Rangos de 'triangles' que forman cada trozo
+    std::vector<std::pair<size_t, size_t>> ranges;
+    std::vector<std::pair<size_t, size_t>> pending = {{0, triangleCount}};
+    while (!pending.empty()) {
+        auto [begin, end] = pending.back();
+        pending.pop_back();
+        if (end - begin <= trianglesPerChunk) {
+            if (end > begin) {
+                ranges.emplace_back(begin, end);
+            }
+            continue;
+        }
+        AABB box;
+        for (size_t i = begin; i < end; i++) {
+            box.expand(centers[triangles[i]]);
+        }
+        glm::vec3 extent = box.max - box.min;
+        int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+        size_t middle = begin + (end - begin) / 2;
+        std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+                         [&](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+        pending.emplace_back(middle, end);
+        pending.emplace_back(begin, middle);
+    }
+
+    ChunkedMeshHeader header{};
+    std::memcpy(header.magic, CHUNKED_MESH_MAGIC, 4);
+    header.version = CHUNKED_MESH_VERSION;
+    header.chunkCount = static_cast<uint32_t>(ranges.size());
+    header.bounds = mesh.bounds;
+
+    std::vector<ChunkInfo> table(ranges.size());
+    uint64_t offset = sizeof(ChunkedMeshHeader) + table.size() * sizeof(ChunkInfo);
+    file.seekp(static_cast<std::streamoff>(offset));
+
+    const uint32_t unused = UINT32_MAX;
+    std::vector<uint32_t> remap(mesh.positions.size(), unused);
+    for (size_t c = 0; c < ranges.size(); c++) {
+        auto [begin, end] = ranges[c];
+        std::sort(triangles.begin() + begin, triangles.begin() + end);
+
+        ChunkData chunk;
+        for (size_t i = begin; i < end; i++) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t index = mesh.indices[triangles[i] * 3 + k];
+                if (remap[index] == unused) {
+                    remap[index] = static_cast<uint32_t>(chunk.positions.size());
+                    chunk.positions.push_back(mesh.positions[index]);
+                    table[c].bounds.expand(mesh.positions[index]);
+                }
+                chunk.indices.push_back(remap[index]);
+            }
+        }
+        for (size_t i = begin; i < end; i++) {
+            for (int k = 0; k < 3; k++) {
+                remap[mesh.indices[triangles[i] * 3 + k]] = unused;
+            }
+        }
+
+        table[c].offset = offset;
+        table[c].vertexCount = static_cast<uint32_t>(chunk.positions.size());
+        table[c].triangleCount = static_cast<uint32_t>(end - begin);
+        file.write(reinterpret_cast<const char*>(chunk.positions.data()), static_cast<std::streamsize>(chunk.positions.size() * sizeof(glm::vec3)));
+        file.write(reinterpret_cast<const char*>(chunk.indices.data()), static_cast<std::streamsize>(chunk.indices.size() * sizeof(uint32_t)));
+        offset += table[c].bytes();
+    }
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(ChunkInfo)));
+    return static_cast<bool>(file);
+}
+
+// Malla de trozos abierta para dibujar: la tabla y la jerarquía de trozos siempre están en memoria,
+// los datos de los trozos solo mientras caben en el presupuesto.
+struct StreamedMesh {
+    AABB bounds;
+    std::vector<ChunkInfo> chunks;
+    InstanceBVH bvh; // Jerarquía sobre las cajas de los trozos
+
+    StreamedMesh() = default;
+    StreamedMesh(const StreamedMesh&) = delete;
+    StreamedMesh& operator=(const StreamedMesh&) = delete;
+
+    ~StreamedMesh() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (io.joinable()) {
+            io.join();
+        }
+    }
+
+    // Abre el archivo, lee la tabla de trozos y arranca el hilo de E/S
+    bool open(const std::string& path, size_t memoryBudget) {
+        file.open(path, std::ios::binary);
+        ChunkedMeshHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, CHUNKED_MESH_MAGIC, 4) != 0 || header.version != CHUNKED_MESH_VERSION) {
+            std::cerr << "Error: " << path << " no es una malla de trozos valida" << std::endl;
+            return false;
+        }
+        bounds = header.bounds;
+        chunks.resize(header.chunkCount);
+        file.read(reinterpret_cast<char*>(chunks.data()), static_cast<std::streamsize>(chunks.size() * sizeof(ChunkInfo)));
+        if (!file) {
+            std::cerr << "Error: tabla de trozos incompleta en " << path << std::endl;
+            return false;
+        }
+
+        std::vector<AABB> chunkBounds(chunks.size());
+        for (size_t c = 0; c < chunks.size(); c++) {
+            chunkBounds[c] = chunks[c].bounds;
+        }
+        bvh.build(chunkBounds);
+
+        budget = memoryBudget;
+        resident.assign(chunks.size(), nullptr);
+        lastUsed.assign(chunks.size(), 0);
+        queued.assign(chunks.size(), 0);
+        io = std::thread([this]() { ioLoop(); });
+        return true;
+    }
+
+    // Marca el comienzo de un cuadro (una vez por cuadro, antes de todos sus renderStreamed()): los trozos usados
+    // desde aquí no se descartan hasta el siguiente, y los pedidos del cuadro anterior que siguen en la cola se
+    // descartan
+    void beginFrame() {
+        std::lock_guard<std::mutex> lock(mutex);
+        frame++;
+        for (uint32_t chunk : queue) {
+            queued[chunk] = 0;
+        }
+        queue.clear();
+    }
+
+    // Devuelve el trozo si está en memoria (y lo marca como usado en este cuadro), o nullptr
+    std::shared_ptr<const ChunkData> acquire(uint32_t chunk) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (resident[chunk]) {
+            lastUsed[chunk] = frame;
+        }
+        return resident[chunk];
+    }
+
+    // Agrega estos trozos, en orden de prioridad, a los pedidos del cuadro; los que ya se pidieron no se repiten
+    void request(const std::vector<uint32_t>& wanted) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (uint32_t chunk : wanted) {
+                if (!resident[chunk] && !queued[chunk] && chunk != loading) {
+                    queued[chunk] = 1;
+                    queue.push_back(chunk);
+                }
+            }
+        }
+        wake.notify_one();
+    }
+
+    // Espera a que el hilo de E/S termine la cola actual
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return queue.empty() && loading == UINT32_MAX; });
+    }
+
+    size_t residentBytes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used;
+    }
+
+private:
+    std::ifstream file;     // Solo lo usa el hilo de E/S después de open()
+    std::thread io;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+
+    size_t budget = 0;
+    size_t used = 0;
+    uint64_t frame = 0;
+    std::vector<std::shared_ptr<const ChunkData>> resident;
+    std::vector<uint64_t> lastUsed;
+    std::vector<uint32_t> queue;   // Pedidos del cuadro, en orden de prioridad
+    std::vector<uint8_t> queued;   // 1 si el trozo está en la cola
+    uint32_t loading = UINT32_MAX;
+    bool stopping = false;
+
+    // Libera trozos no usados en este cuadro, del menos reciente al más reciente, hasta que quepan 'bytes'.
+    // Devuelve false (sin liberar nada) si no es posible.
+    bool makeRoom(size_t bytes) {
+        if (bytes > budget) {
+            return false;
+        }
+        std::vector<uint32_t> candidates;
+        size_t freeable = 0;
+        for (uint32_t c = 0; c < resident.size(); c++) {
+            if (resident[c] && lastUsed[c] < frame) {
+                candidates.push_back(c);
+                freeable += chunks[c].bytes();
+            }
+        }
+        if (used + bytes > budget + freeable) {
+            return false;
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) { return lastUsed[a] < lastUsed[b]; });
+        for (size_t i = 0; i < candidates.size() && used + bytes > budget; i++) {
+            used -= chunks[candidates[i]].bytes();
+            resident[candidates[i]] = nullptr;
+        }
+        return true;
+    }
+
+    void ioLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            uint32_t chunk = queue.front();
+            queue.erase(queue.begin());
+            queued[chunk] = 0;
+            const ChunkInfo& info = chunks[chunk];
+
+            // Sin lugar para el trozo: se salta hasta que se libere memoria
+            if (resident[chunk] || !makeRoom(info.bytes())) {
+                if (queue.empty()) {
+                    idle.notify_all();
+                }
+                continue;
+            }
+            used += info.bytes();
+            loading = chunk;
+            lock.unlock();
+
+            auto data = std::make_shared<ChunkData>();
+            data->positions.resize(info.vertexCount);
+            data->indices.resize(static_cast<size_t>(info.triangleCount) * 3);
+            file.seekg(static_cast<std::streamoff>(info.offset));
+            file.read(reinterpret_cast<char*>(data->positions.data()), static_cast<std::streamsize>(data->positions.size() * sizeof(glm::vec3)));
+            file.read(reinterpret_cast<char*>(data->indices.data()), static_cast<std::streamsize>(data->indices.size() * sizeof(uint32_t)));
+            bool ok = static_cast<bool>(file);
+            file.clear();
+
+            lock.lock();
+            loading = UINT32_MAX;
+            if (ok) {
+                resident[chunk] = data;
+                lastUsed[chunk] = frame;
+            } else {
+                used -= info.bytes();
+                std::cerr << "Error: no se pudo leer el trozo " << chunk << std::endl;
+            }
+            if (queue.empty()) {
+                idle.notify_all();
+            }
+        }
+    }
+};
@@ -0,0 +1,348 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "Bitmap.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SR_TEXTURE_SSE2 1
+#else
+#define SR_TEXTURE_SSE2 0
+#endif
+
+// Texturas con mipmaps en memoria en mosaico. Cada nivel se guarda en bloques de 8x8 téxeles (256 bytes,
+// cuatro líneas de caché) y dentro de cada bloque en orden Morton (Z), así que los vecinos en x y en y de
+// un téxel suelen estar en la misma línea: una superficie girada recorre la textura en diagonal sin saltar
+// una fila entera por téxel como con el orden por filas.
+//
+// Los lados deben ser potencias de dos (el repetido es una máscara). Los mipmaps se generan al crear la
+// textura; el nivel de cada fragmento sale de las derivadas de las coordenadas por cuadro de 2x2 píxeles
+// (ver rasterProgramQuads() en ShaderProgram.h).
+
+const int TEXTURE_TILE_SIZE = 8;
+const int TEXTURE_TILE_TEXELS = TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE;
+
+// Filtro de muestreo
+enum class TextureFilter : uint8_t {
+    Nearest,  // Téxel más cercano del nivel más cercano
+    Bilinear, // Cuatro téxeles del nivel más cercano
+    Trilinear // Bilineal en los dos niveles vecinos, mezclados según el nivel fraccionario
+};
+
+// Función para intercalar con ceros los 3 bits bajos de v (abc -> 0a0b0c)
+inline uint32_t spreadBits3(uint32_t v) {
+    v = (v | (v << 2)) & 0x33u;
+    return (v | (v << 1)) & 0x55u;
+}
+
+// Un nivel de la cadena de mipmaps
+struct TextureLevel {
+    int width = 0;
+    int height = 0;
+    int tilesPerRow = 0;
+    std::vector<Color> texels; // Bloques de 8x8 fila por fila; dentro de cada bloque, orden Morton
+
+    // La posición de un téxel es la suma de una parte que depende solo de la columna y otra solo de la fila;
+    // se guardan en tablas para que cada téxel cueste dos lecturas y una suma
+    std::vector<uint32_t> columnOffsets;
+    std::vector<uint32_t> rowOffsets;
+
+    TextureLevel() = default;
+
+    TextureLevel(int w, int h) : width(w), height(h), tilesPerRow((w + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE) {
+        int tileRows = (h + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        texels.resize(static_cast<size_t>(tilesPerRow) * tileRows * TEXTURE_TILE_TEXELS);
+        columnOffsets.resize(w);
+        for (int x = 0; x < w; x++) {
+            columnOffsets[x] = static_cast<uint32_t>(x >> 3) * TEXTURE_TILE_TEXELS + spreadBits3(x & 7);
+        }
+        rowOffsets.resize(h);
+        for (int y = 0; y < h; y++) {
+            rowOffsets[y] = static_cast<uint32_t>(y >> 3) * tilesPerRow * TEXTURE_TILE_TEXELS + (spreadBits3(y & 7) << 1);
+        }
+    }
+
+    // Partes de la posición de la columna x y de la fila y, que se repiten fuera de la textura
+    size_t columnOffset(int x) const {
+        return columnOffsets[x & (width - 1)];
+    }
+
+    size_t rowOffset(int y) const {
+        return rowOffsets[y & (height - 1)];
+    }
+
+    // Téxel en coordenadas enteras que se repiten fuera de la textura
+    const Color& fetch(int x, int y) const {
+        return texels[rowOffset(y) + columnOffset(x)];
+    }
+
+    Color& at(int x, int y) {
+        return texels[rowOffset(y) + columnOffset(x)];
+    }
+};
+
+struct Texture {
+    std::vector<TextureLevel> levels; // Nivel 0 = imagen original; cada nivel es la mitad del anterior
+
+    int width() const {
+        return levels.empty() ? 0 : levels[0].width;
+    }
+
+    int height() const {
+        return levels.empty() ? 0 : levels[0].height;
+    }
+
+    // Memoria de todos los niveles, en bytes
+    size_t byteSize() const {
+        size_t bytes = 0;
+        for (const TextureLevel& level : levels) {
+            bytes += level.texels.size() * sizeof(Color);
+        }
+        return bytes;
+    }
+};
+
+bool isPowerOfTwo(int v) {
+    return v > 0 && (v & (v - 1)) == 0;
+}
+
+// Función para crear una textura a partir de width * height colores fila por fila (la fila 0 es v = 0,
+// como en los BMP, que se guardan de abajo hacia arriba). Genera todos los mipmaps promediando bloques de 2x2.
+Texture createTexture(int width, int height, const std::vector<Color>& pixels) {
+    Texture texture;
+    TextureLevel base(width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            base.at(x, y) = pixels[static_cast<size_t>(y) * width + x];
+        }
+    }
+    texture.levels.push_back(std::move(base));
+
+    while (texture.levels.back().width > 1 || texture.levels.back().height > 1) {
+        const TextureLevel& previous = texture.levels.back();
+        TextureLevel level(std::max(previous.width / 2, 1), std::max(previous.height / 2, 1));
+        // En un lado de 1 téxel los dos téxeles del bloque son el mismo
+        int stepX = previous.width > 1 ? 1 : 0;
+        int stepY = previous.height > 1 ? 1 : 0;
+        for (int y = 0; y < level.height; y++) {
+            for (int x = 0; x < level.width; x++) {
+                const Color& c00 = previous.fetch(2 * x, 2 * y);
+                const Color& c10 = previous.fetch(2 * x + stepX, 2 * y);
+                const Color& c01 = previous.fetch(2 * x, 2 * y + stepY);
+                const Color& c11 = previous.fetch(2 * x + stepX, 2 * y + stepY);
+                level.at(x, y) = Color((c00.r + c10.r + c01.r + c11.r + 2) / 4, (c00.g + c10.g + c01.g + c11.g + 2) / 4,
+                                       (c00.b + c10.b + c01.b + c11.b + 2) / 4, (c00.a + c10.a + c01.a + c11.a + 2) / 4);
+            }
+        }
+        texture.levels.push_back(std::move(level));
+    }
+    return texture;
+}
+
+// Función para cargar una textura desde un BMP de 24 bits con lados potencia de dos
+bool loadTexture(const std::string& filename, Texture& texture) {
+    int width = 0;
+    int height = 0;
+    std::vector<Color> pixels;
+    if (!readBMP24(filename, width, height, pixels)) {
+        return false;
+    }
+    if (!isPowerOfTwo(width) || !isPowerOfTwo(height)) {
+        std::cerr << "La textura debe tener lados potencia de dos: " << filename << " (" << width << "x" << height << ")\n";
+        return false;
+    }
+    texture = createTexture(width, height, pixels);
+    return true;
+}
+
+// Función para crear una textura de tablero de ajedrez de size x size téxeles con 'cells' casillas por lado,
+// para mallas que no traen imagen
+Texture checkerTexture(int size, int cells, const Color& even, const Color& odd) {
+    std::vector<Color> pixels(static_cast<size_t>(size) * size);
+    int cell = std::max(size / cells, 1);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            pixels[static_cast<size_t>(y) * size + x] = ((x / cell + y / cell) % 2 == 0) ? even : odd;
+        }
+    }
+    return createTexture(size, size, pixels);
+}
+
+// Función para aproximar log2(x), x > 0, leyendo el exponente del float y tomando la mantisa como fracción
+// lineal (error menor a 0.09); para elegir mipmaps alcanza y evita una llamada a log2 por fragmento
+inline float fastLog2(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return static_cast<float>(bits) * (1.0f / (1 << 23)) - 127.0f;
+}
+
+// Función para calcular el nivel de detalle a partir de las derivadas de las coordenadas de textura respecto
+// a x e y en pantalla: log2 del mayor paso en téxeles del nivel 0, recortado a los niveles existentes
+inline float textureLod(const Texture& texture, const glm::vec2& ddx, const glm::vec2& ddy) {
+    glm::vec2 size(static_cast<float>(texture.width()), static_cast<float>(texture.height()));
+    glm::vec2 dx = ddx * size;
+    glm::vec2 dy = ddy * size;
+    float rho2 = std::max(std::max(glm::dot(dx, dx), glm::dot(dy, dy)), 1e-12f);
+    float lod = 0.5f * fastLog2(rho2);
+    return std::clamp(lod, 0.0f, static_cast<float>(texture.levels.size() - 1));
+}
+
+// Función para interpolar dos colores con un peso de 8 bits: (a * (256 - w) + b * w) / 256 por canal
+inline Color lerpTexel(const Color& a, const Color& b, int w) {
+    Color c;
+    c.r = static_cast<uint8_t>((a.r * (256 - w) + b.r * w) >> 8);
+    c.g = static_cast<uint8_t>((a.g * (256 - w) + b.g * w) >> 8);
+    c.b = static_cast<uint8_t>((a.b * (256 - w) + b.b * w) >> 8);
+    c.a = static_cast<uint8_t>((a.a * (256 - w) + b.a * w) >> 8);
+    return c;
+}
+
+// Función para el filtro bilineal de cuatro téxeles con pesos de 8 bits: primero entre filas (fy, de c00 a c01)
+// y después entre columnas (fx, de c00 a c10)
+inline Color blendTexels(const Color& c00, const Color& c10, const Color& c01, const Color& c11, int fx, int fy) {
+    return lerpTexel(lerpTexel(c00, c01, fy), lerpTexel(c10, c11, fy), fx);
+}
+
+// Función para obtener el entero anterior o igual a x sin llamar a floor(), que sin SSE4.1 es una llamada a la biblioteca
+inline int floorToInt(float x) {
+    int i = static_cast<int>(x);
+    return i - (x < static_cast<float>(i) ? 1 : 0);
+}
+
+// Función para muestrear un nivel con el téxel más cercano; las coordenadas se repiten fuera de [0, 1)
+inline Color sampleNearest(const TextureLevel& level, const glm::vec2& uv) {
+    return level.fetch(floorToInt(uv.x * level.width), floorToInt(uv.y * level.height));
+}
+
+// Función para muestrear un nivel con filtro bilineal (centros de téxel en +0.5)
+inline Color sampleBilinear(const TextureLevel& level, const glm::vec2& uv) {
+    float x = uv.x * level.width - 0.5f;
+    float y = uv.y * level.height - 0.5f;
+    int x0 = floorToInt(x);
+    int y0 = floorToInt(y);
+    size_t column0 = level.columnOffset(x0);
+    size_t column1 = level.columnOffset(x0 + 1);
+    size_t row0 = level.rowOffset(y0);
+    size_t row1 = level.rowOffset(y0 + 1);
+    const Color* texels = level.texels.data();
+    return blendTexels(texels[row0 + column0], texels[row0 + column1], texels[row1 + column0], texels[row1 + column1],
+                       static_cast<int>((x - static_cast<float>(x0)) * 256.0f), static_cast<int>((y - static_cast<float>(y0)) * 256.0f));
+}
+
+// Función para muestrear la textura en el nivel de detalle 'lod' (ver textureLod()) con el filtro dado
+inline Color sampleTexture(const Texture& texture, const glm::vec2& uv, float lod, TextureFilter filter) {
+    if (filter == TextureFilter::Nearest) {
+        return sampleNearest(texture.levels[static_cast<size_t>(lod + 0.5f)], uv);
+    }
+    if (filter == TextureFilter::Bilinear) {
+        return sampleBilinear(texture.levels[static_cast<size_t>(lod + 0.5f)], uv);
+    }
+    size_t level = static_cast<size_t>(lod);
+    Color fine = sampleBilinear(texture.levels[level], uv);
+    if (level + 1 >= texture.levels.size()) {
+        return fine;
+    }
+    Color coarse = sampleBilinear(texture.levels[level + 1], uv);
+    return lerpTexel(fine, coarse, static_cast<int>((lod - static_cast<float>(level)) * 256.0f));
+}
+
+// Muestreo de los cuatro píxeles de un cuadro de 2x2 a la vez, con el nivel de detalle del cuadro. Con SSE2 las
+// coordenadas, los pesos y las interpolaciones de las cuatro muestras van en paralelo, un canal de 16 bits por
+// componente de color: a * (256 - w) + b * w <= 255 * 256 cabe sin signo. Da exactamente los mismos colores
+// que cuatro llamadas a sampleTexture().
+
+#if SR_TEXTURE_SSE2
+// Entero anterior o igual de cuatro floats
+inline __m128i floorToInt4(__m128 x) {
+    __m128i i = _mm_cvttps_epi32(x);
+    // La comparación da -1 en los carriles donde el truncado redondeó hacia arriba
+    return _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(i))));
+}
+
+// Pesos de 8 bits de cuatro muestras repetidos en los cuatro canales de cada una: muestras 0 y 1 en 'low',
+// 2 y 3 en 'high'
+inline void expandTexelWeights(__m128i weights, __m128i& low, __m128i& high) {
+    __m128i pairs = _mm_unpacklo_epi16(_mm_packs_epi32(weights, weights), _mm_packs_epi32(weights, weights));
+    low = _mm_unpacklo_epi32(pairs, pairs);
+    high = _mm_unpackhi_epi32(pairs, pairs);
+}
+
+// a * (256 - w) + b * w, dividido por 256, en canales de 16 bits
+inline __m128i lerpTexels16(__m128i a, __m128i b, __m128i w) {
+    __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(256), w);
+    return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(a, inverse), _mm_mullo_epi16(b, w)), 8);
+}
+
+// Filtro bilineal de cuatro muestras: t00..t11 tienen el téxel de cada esquina de las cuatro muestras
+inline __m128i blendTexels4(__m128i t00, __m128i t10, __m128i t01, __m128i t11, __m128i fx, __m128i fy) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i fxLow, fxHigh, fyLow, fyHigh;
+    expandTexelWeights(fx, fxLow, fxHigh);
+    expandTexelWeights(fy, fyLow, fyHigh);
+    __m128i low = lerpTexels16(lerpTexels16(_mm_unpacklo_epi8(t00, zero), _mm_unpacklo_epi8(t01, zero), fyLow),
+                               lerpTexels16(_mm_unpacklo_epi8(t10, zero), _mm_unpacklo_epi8(t11, zero), fyLow), fxLow);
+    __m128i high = lerpTexels16(lerpTexels16(_mm_unpackhi_epi8(t00, zero), _mm_unpackhi_epi8(t01, zero), fyHigh),
+                                lerpTexels16(_mm_unpackhi_epi8(t10, zero), _mm_unpackhi_epi8(t11, zero), fyHigh), fxHigh);
+    return _mm_packus_epi16(low, high);
+}
+
+inline void sampleBilinearQuad(const TextureLevel& level, const glm::vec2 uv[4], __m128i& out) {
+    __m128 x = _mm_sub_ps(_mm_mul_ps(_mm_set_ps(uv[3].x, uv[2].x, uv[1].x, uv[0].x), _mm_set1_ps(static_cast<float>(level.width))),
+                          _mm_set1_ps(0.5f));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_set_ps(uv[3].y, uv[2].y, uv[1].y, uv[0].y), _mm_set1_ps(static_cast<float>(level.height))),
+                          _mm_set1_ps(0.5f));
+    __m128i x0 = floorToInt4(x);
+    __m128i y0 = floorToInt4(y);
+    __m128i fx = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(x, _mm_cvtepi32_ps(x0)), _mm_set1_ps(256.0f)));
+    __m128i fy = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(y, _mm_cvtepi32_ps(y0)), _mm_set1_ps(256.0f)));
+
+    // Sin instrucciones de recolección en SSE2: las posiciones de los 16 téxeles salen de las tablas del nivel
+    alignas(16) int32_t columns[4], rows[4];
+    alignas(16) uint32_t t00[4], t10[4], t01[4], t11[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(columns), x0);
+    _mm_store_si128(reinterpret_cast<__m128i*>(rows), y0);
+    const Color* texels = level.texels.data();
+    for (int s = 0; s < 4; s++) {
+        size_t column0 = level.columnOffset(columns[s]);
+        size_t column1 = level.columnOffset(columns[s] + 1);
+        size_t row0 = level.rowOffset(rows[s]);
+        size_t row1 = level.rowOffset(rows[s] + 1);
+        std::memcpy(&t00[s], &texels[row0 + column0], sizeof(Color));
+        std::memcpy(&t10[s], &texels[row0 + column1], sizeof(Color));
+        std::memcpy(&t01[s], &texels[row1 + column0], sizeof(Color));
+        std::memcpy(&t11[s], &texels[row1 + column1], sizeof(Color));
+    }
+    out = blendTexels4(_mm_load_si128(reinterpret_cast<const __m128i*>(t00)), _mm_load_si128(reinterpret_cast<const __m128i*>(t10)),
+                       _mm_load_si128(reinterpret_cast<const __m128i*>(t01)), _mm_load_si128(reinterpret_cast<const __m128i*>(t11)), fx, fy);
+}
+#endif
+
+// Función para muestrear los cuatro píxeles de un cuadro (uv[i] del píxel i) con el nivel de detalle 'lod'
+inline void sampleTextureQuad(const Texture& texture, const glm::vec2 uv[4], float lod, TextureFilter filter, Color out[4]) {
+#if SR_TEXTURE_SSE2
+    if (filter != TextureFilter::Nearest) {
+        size_t level = static_cast<size_t>(filter == TextureFilter::Bilinear ? lod + 0.5f : lod);
+        __m128i fine;
+        sampleBilinearQuad(texture.levels[level], uv, fine);
+        if (filter == TextureFilter::Trilinear && level + 1 < texture.levels.size()) {
+            __m128i coarse;
+            sampleBilinearQuad(texture.levels[level + 1], uv, coarse);
+            __m128i weight = _mm_set1_epi16(static_cast<short>((lod - static_cast<float>(level)) * 256.0f));
+            __m128i zero = _mm_setzero_si128();
+            fine = _mm_packus_epi16(lerpTexels16(_mm_unpacklo_epi8(fine, zero), _mm_unpacklo_epi8(coarse, zero), weight),
+                                    lerpTexels16(_mm_unpackhi_epi8(fine, zero), _mm_unpackhi_epi8(coarse, zero), weight));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), fine);
+        return;
+    }
+#endif
+    for (int i = 0; i < 4; i++) {
+        out[i] = sampleTexture(texture, uv[i], lod, filter);
+    }
+}
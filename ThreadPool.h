@@ -0,0 +1,104 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Conjunto fijo de hilos de trabajo para repartir tareas independientes dentro de un cuadro.
+// run() reparte los índices [0, count) entre los hilos y el hilo que llama, y vuelve cuando todos terminaron.
+// Las tareas no deben llamar a run() a su vez.
+struct ThreadPool {
+    explicit ThreadPool(unsigned workerCount) {
+        for (unsigned i = 0; i < workerCount; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Hilos que ejecutan tareas, contando al que llama a run()
+    unsigned threadCount() const {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    void run(size_t count, const std::function<void(size_t)>& function) {
+        if (workers.empty() || count <= 1) {
+            for (size_t i = 0; i < count; i++) {
+                function(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &function;
+            taskCount = count;
+            next = 0;
+            busy = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        drain();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return busy == 0; });
+        task = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(size_t)>* task = nullptr;
+    size_t taskCount = 0;
+    std::atomic<size_t> next{0};
+    size_t busy = 0;          // Hilos de trabajo que aún no terminaron la tanda actual
+    uint64_t generation = 0;  // Aumenta con cada llamada a run()
+    bool stopping = false;
+
+    // Toma índices pendientes hasta agotarlos
+    void drain() {
+        for (size_t i = next.fetch_add(1); i < taskCount; i = next.fetch_add(1)) {
+            (*task)(i);
+        }
+    }
+
+    void workerLoop() {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            lock.unlock();
+            drain();
+            lock.lock();
+            if (--busy == 0) {
+                done.notify_one();
+            }
+        }
+    }
+};
+
+// Hilos compartidos por todo el programa: uno por núcleo, contando al hilo principal
+ThreadPool& threadPool() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
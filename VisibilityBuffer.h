@@ -0,0 +1,206 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "GraphicsStructures.h"
+#include "Framebuffer.h"
+#include "PipelineState.h"
+#include "Renderer.h"
+#include "ShaderProgram.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+// Búfer de visibilidad. La pasada de rasterización no sombrea: escribe en cada píxel solo la profundidad y un
+// identificador de 32 bits del triángulo visible, con el mismo núcleo del pipeline fijo (el triángulo llega
+// entero a rasterTriangle(), así que su identidad no cuesta nada). Después, shadeVisibility() reconstruye de
+// cada identificador la llamada y el triángulo, recupera sus vértices en pantalla y sombrea cada píxel una sola
+// vez. Los identificadores sirven además para seleccionar objetos y para depurar (ver visibilityDebugColor()).
+//
+// El identificador numera los triángulos de todas las llamadas del cuadro, empezando en 1 (0 es el fondo): la
+// llamada (instancia) y el triángulo dentro de ella salen de una búsqueda en los primeros números de cada
+// llamada. Así no hace falta repartir los 32 bits entre instancias y triángulos de antemano.
+
+const uint32_t VISIBILITY_EMPTY = 0;
+
+// Función para guardar un identificador en los cuatro bytes de un color (r es el byte bajo)
+inline Color visibilityColor(uint32_t id) {
+    Color c;
+    c.r = static_cast<uint8_t>(id & 0xFF);
+    c.g = static_cast<uint8_t>((id >> 8) & 0xFF);
+    c.b = static_cast<uint8_t>((id >> 16) & 0xFF);
+    c.a = static_cast<uint8_t>(id >> 24);
+    return c;
+}
+
+// Función para leer el identificador guardado en un color
+inline uint32_t visibilityId(const Color& c) {
+    return static_cast<uint32_t>(c.r) | (static_cast<uint32_t>(c.g) << 8) | (static_cast<uint32_t>(c.b) << 16) |
+           (static_cast<uint32_t>(c.a) << 24);
+}
+
+// Llamada de dibujo registrada en el búfer de visibilidad
+struct VisibilityDraw {
+    uint32_t firstId;                    // Identificador de su primer triángulo
+    uint32_t firstVertex;                // Primer vértice en VisibilityBuffer::positions
+    const std::vector<uint32_t>* indices; // Índices de la malla; la malla debe seguir viva hasta sombrear
+    Color tint;                          // Color que multiplica al sombreado
+    uint32_t instance;                   // Dato del que dibuja (por ejemplo, el índice de la instancia)
+};
+
+// Triángulo visible en un píxel
+struct VisibilityHit {
+    uint32_t draw = 0;     // Índice en VisibilityBuffer::draws
+    uint32_t triangle = 0; // Triángulo dentro de la malla de la llamada
+    float depth = DEPTH_CLEAR;
+};
+
+struct VisibilityBuffer {
+    Framebuffer ids;                  // Identificadores (como colores) y profundidad
+    std::vector<glm::vec3> positions; // Vértices en pantalla de todas las llamadas del cuadro
+    std::vector<VisibilityDraw> draws;
+    uint32_t nextId = 1;
+
+    // Prepara un cuadro de w x h: sin llamadas y con todos los píxeles en el fondo
+    void begin(int w, int h) {
+        if (ids.width != w || ids.height != h) {
+            ids.resize(w, h);
+        }
+        ids.clear(visibilityColor(VISIBILITY_EMPTY));
+        positions.clear();
+        draws.clear();
+        nextId = 1;
+    }
+
+    uint32_t idAt(int x, int y) const {
+        return visibilityId(ids.colorAt(x, y));
+    }
+
+    // Función para encontrar la llamada de un identificador (distinto de VISIBILITY_EMPTY)
+    uint32_t findDraw(uint32_t id) const {
+        auto it = std::upper_bound(draws.begin(), draws.end(), id,
+                                   [](uint32_t value, const VisibilityDraw& draw) { return value < draw.firstId; });
+        return static_cast<uint32_t>(it - draws.begin()) - 1;
+    }
+
+    // Función para obtener el triángulo visible en (x, y); devuelve false si el píxel es fondo
+    bool hitAt(int x, int y, VisibilityHit& hit) const {
+        uint32_t id = idAt(x, y);
+        if (id == VISIBILITY_EMPTY) {
+            return false;
+        }
+        hit.draw = findDraw(id);
+        hit.triangle = id - draws[hit.draw].firstId;
+        hit.depth = ids.depthAt(x, y);
+        return true;
+    }
+};
+
+// Función para dibujar una malla indexada en el búfer de visibilidad. Los píxeles son los mismos que con
+// renderIndexed() y el mismo estado; el modelo de sombreado del estado no cuenta (se sombrea después).
+void drawVisibility(VisibilityBuffer& vb, const Mesh& mesh, const Uniform& uniform, const Color& tint = Color(255, 255, 255),
+                    uint32_t instance = 0, const PipelineState& state = PipelineState()) {
+    PROFILE_ZONE("render");
+    uint32_t firstVertex = static_cast<uint32_t>(vb.positions.size());
+    {
+        PROFILE_ZONE("vertexShader");
+        vb.positions.resize(firstVertex + mesh.positions.size());
+        for (size_t i = 0; i < mesh.positions.size(); i++) {
+            vb.positions[firstVertex + i] = vertexShader(Vertex{mesh.positions[i], Color()}, uniform).position;
+        }
+        STATS(pipelineStats.verticesShaded += mesh.positions.size());
+        STATS(pipelineStats.trianglesAssembled += mesh.triangleCount());
+    }
+    uint32_t firstId = vb.nextId;
+    vb.draws.push_back(VisibilityDraw{firstId, firstVertex, &mesh.indices, tint, instance});
+    vb.nextId += static_cast<uint32_t>(mesh.triangleCount());
+
+    // Con ShadingModel::Unlit el núcleo escribe el color del primer vértice: el identificador del triángulo
+    PROFILE_ZONE("rasterize");
+    PipelineState idState = state;
+    idState.shading = ShadingModel::Unlit;
+    idState.output = OutputFormat::Color;
+    RasterKernel raster = selectRasterKernel(idState);
+    const glm::vec3* screen = &vb.positions[firstVertex];
+    Color white(255, 255, 255);
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        Color id = visibilityColor(firstId + static_cast<uint32_t>(i / 3));
+        Vertex a{screen[mesh.indices[i]], id};
+        Vertex b{screen[mesh.indices[i + 1]], id};
+        Vertex c{screen[mesh.indices[i + 2]], id};
+        if (!triangleOnScreen(a, b, c, vb.ids.width, vb.ids.height)) {
+            STATS(pipelineStats.trianglesCulled++);
+            continue;
+        }
+        raster(vb.ids, a, b, c, white);
+    }
+}
+
+// Función para sombrear el búfer de visibilidad sobre 'fb' (del mismo tamaño). De cada píxel visible se
+// reconstruye su triángulo y con él la normal de cara en pantalla, y se ilumina como FlatProgram (con 'lights' y
+// 'shadows' si los hay) multiplicado por el color de la llamada; sin luces ni sombras la imagen es la de
+// renderIndexed(). Los píxeles de fondo conservan el color de 'fb' y la profundidad se copia entera.
+// Las filas se reparten entre hilos; píxeles vecinos suelen caer en la misma llamada, que se busca solo al cambiar.
+void shadeVisibility(Framebuffer& fb, const VisibilityBuffer& vb, const LightGrid* lights = nullptr,
+                     const ShadowMap* shadows = nullptr, ThreadPool& pool = threadPool()) {
+    PROFILE_ZONE("visibilityShading");
+    int width = vb.ids.width;
+    int height = vb.ids.height;
+    if (vb.draws.empty()) {
+        std::copy(vb.ids.depth.begin(), vb.ids.depth.end(), fb.depth.begin());
+        return;
+    }
+    const int ROWS_PER_TASK = 16;
+    size_t tasks = static_cast<size_t>((height + ROWS_PER_TASK - 1) / ROWS_PER_TASK);
+    pool.run(tasks, [&](size_t task) {
+        int y0 = static_cast<int>(task) * ROWS_PER_TASK;
+        int y1 = std::min(y0 + ROWS_PER_TASK, height);
+        uint32_t draw = 0;
+        uint32_t drawBegin = vb.draws[0].firstId;
+        uint32_t drawEnd = vb.draws.size() > 1 ? vb.draws[1].firstId : vb.nextId;
+        for (int y = y0; y < y1; y++) {
+            size_t row = static_cast<size_t>(y) * width;
+            const float* depthRow = &vb.ids.depth[row];
+            const Color* idRow = &vb.ids.color[row];
+            Color* colorRow = &fb.color[row];
+            std::copy(depthRow, depthRow + width, &fb.depth[row]);
+            for (int x = 0; x < width; x++) {
+                uint32_t id = visibilityId(idRow[x]);
+                if (id == VISIBILITY_EMPTY) {
+                    continue;
+                }
+                if (id < drawBegin || id >= drawEnd) {
+                    draw = vb.findDraw(id);
+                    drawBegin = vb.draws[draw].firstId;
+                    drawEnd = draw + 1 < vb.draws.size() ? vb.draws[draw + 1].firstId : vb.nextId;
+                }
+                const VisibilityDraw& d = vb.draws[draw];
+                const uint32_t* triangle = &(*d.indices)[static_cast<size_t>(id - d.firstId) * 3];
+                const glm::vec3& A = vb.positions[d.firstVertex + triangle[0]];
+                const glm::vec3& B = vb.positions[d.firstVertex + triangle[1]];
+                const glm::vec3& C = vb.positions[d.firstVertex + triangle[2]];
+                glm::vec3 N = glm::normalize(glm::cross(B - A, C - A));
+                glm::vec3 position(static_cast<float>(x), static_cast<float>(y), depthRow[x]);
+                colorRow[x] = modulate(intensityColor(sceneIntensity(lights, shadows, position, N)), d.tint);
+            }
+        }
+    });
+}
+
+// Función para obtener un color de depuración distinto para cada identificador (negro para el fondo)
+inline Color visibilityDebugColor(uint32_t id) {
+    if (id == VISIBILITY_EMPTY) {
+        return Color(0, 0, 0);
+    }
+    uint32_t h = id * 2654435761u; // Dispersión multiplicativa de Knuth
+    h ^= h >> 15;
+    return Color(static_cast<int>(64 + (h & 0xBF)), static_cast<int>(64 + ((h >> 8) & 0xBF)), static_cast<int>(64 + ((h >> 16) & 0xBF)));
+}
+
+// Función para pintar en 'fb' cada triángulo visible con su color de depuración (el fondo queda negro)
+void drawVisibilityDebug(Framebuffer& fb, const VisibilityBuffer& vb) {
+    for (size_t i = 0; i < vb.ids.color.size(); i++) {
+        fb.color[i] = visibilityDebugColor(visibilityId(vb.ids.color[i]));
+        fb.depth[i] = vb.ids.depth[i];
+    }
+}
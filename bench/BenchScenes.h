@@ -0,0 +1,224 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/constants.hpp"
+#include "ObjLoader.h"
+#include "Renderer.h"
+
+// Corpus de escenas de los benchmarks. Cada escena tiene su malla y una lista fija de poses,
+// de modo que dos ejecuciones dibujan exactamente los mismos cuadros.
+
+#ifndef SR_SOURCE_DIR
+#define SR_SOURCE_DIR "."
+#endif
+
+struct BenchScene {
+    std::string name;
+    std::vector<glm::vec3> vertices;
+    std::vector<Face> faces;
+    std::vector<glm::vec2> texcoords; // Atributos del archivo OBJ; vacíos en las escenas sintéticas
+    std::vector<glm::vec3> normals;
+    std::vector<glm::mat4> poses; // Matrices de modelo, una por cuadro (se recorren en ciclo)
+    std::vector<glm::mat4> instances; // Copias de la malla relativas a la pose; vacío = una sola copia
+    bool instancedOnly = false;       // Demasiadas copias para dibujarlas una por una: solo --path instanced
+};
+
+// Función para agregar un triángulo a una lista de caras
+void addTriangle(std::vector<Face>& faces, int i0, int i1, int i2) {
+    Face face;
+    face.vertexIndices.push_back({i0, 0, 0});
+    face.vertexIndices.push_back({i1, 0, 0});
+    face.vertexIndices.push_back({i2, 0, 0});
+    faces.push_back(face);
+}
+
+// Función para cargar la nave del repositorio con la misma orientación que el visor
+void loadSpaceship(BenchScene& scene) {
+    AABB bounds;
+    loadOBJ(std::string(SR_SOURCE_DIR) + "/spaceship.obj", scene.vertices, scene.texcoords, scene.normals, scene.faces, bounds);
+
+    glm::vec3 rotationAngles = glm::vec3(125, 120, 50);
+    for (auto& vertex : scene.vertices) {
+        vertex = rotateVertex(vertex, rotationAngles);
+    }
+    for (auto& normal : scene.normals) {
+        normal = rotateVertex(normal, rotationAngles);
+    }
+}
+
+// Nave del repositorio con las mismas matrices que el visor
+BenchScene spaceshipScene() {
+    BenchScene scene;
+    scene.name = "spaceship";
+    loadSpaceship(scene);
+
+    for (int i = 0; i < 16; i++) {
+        scene.poses.push_back(createModelMatrix(3.14f / 3.0f + i * 22.5f, 0.5f / 3.0f + i * 4.5f));
+    }
+    return scene;
+}
+
+// Esfera UV sintética de alta densidad (2 * rings * segments triángulos); sus coordenadas de textura repiten
+// la textura 4 veces alrededor y 2 de polo a polo
+BenchScene sphereScene(int rings = 256, int segments = 512) {
+    BenchScene scene;
+    scene.name = "sphere";
+    const float radius = 0.6f;
+    for (int r = 0; r <= rings; r++) {
+        float phi = glm::pi<float>() * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float theta = 2.0f * glm::pi<float>() * s / segments;
+            scene.vertices.emplace_back(radius * std::sin(phi) * std::cos(theta),
+                                        radius * std::cos(phi),
+                                        radius * std::sin(phi) * std::sin(theta));
+            scene.texcoords.emplace_back(4.0f * s / segments, 2.0f * r / rings);
+        }
+    }
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            int i0 = r * (segments + 1) + s;
+            int i1 = i0 + segments + 1;
+            addTriangle(scene.faces, i0, i1, i0 + 1);
+            addTriangle(scene.faces, i0 + 1, i1, i1 + 1);
+        }
+    }
+    // Cada vértice usa su propia coordenada de textura
+    for (Face& face : scene.faces) {
+        for (auto& corner : face.vertexIndices) {
+            corner[1] = corner[0];
+        }
+    }
+    for (int i = 0; i < 16; i++) {
+        scene.poses.push_back(glm::rotate(glm::mat4(1), glm::radians(i * 22.5f), glm::vec3(0.3f, 1, 0.1f)));
+    }
+    return scene;
+}
+
+// Capas de cuadriláteros que cubren toda la pantalla, de atrás hacia adelante: cada capa pasa la prueba de profundidad
+BenchScene overdrawScene(int layers = 32) {
+    BenchScene scene;
+    scene.name = "overdraw";
+    for (int l = 0; l < layers; l++) {
+        // La cámara está en z = -5 mirando hacia +z: las capas con z mayor están más lejos
+        float z = 1.0f - 2.0f * l / layers;
+        float tilt = 0.05f * (l % 3);
+        int base = static_cast<int>(scene.vertices.size());
+        scene.vertices.emplace_back(-1.2f, -1.2f, z);
+        scene.vertices.emplace_back(1.2f, -1.2f, z + tilt);
+        scene.vertices.emplace_back(1.2f, 1.2f, z);
+        scene.vertices.emplace_back(-1.2f, 1.2f, z - tilt);
+        addTriangle(scene.faces, base, base + 1, base + 2);
+        addTriangle(scene.faces, base, base + 2, base + 3);
+    }
+    for (int i = 0; i < 4; i++) {
+        scene.poses.push_back(glm::rotate(glm::mat4(1), glm::radians(i * 5.0f), glm::vec3(0, 0, 1)));
+    }
+    return scene;
+}
+
+// Rejilla de triángulos de aproximadamente un píxel: domina el costo por triángulo
+BenchScene tinyTrianglesScene(int cells = 300) {
+    BenchScene scene;
+    scene.name = "tiny";
+    const float extent = 1.6f;
+    for (int y = 0; y <= cells; y++) {
+        for (int x = 0; x <= cells; x++) {
+            float fx = extent * (static_cast<float>(x) / cells - 0.5f);
+            float fy = extent * (static_cast<float>(y) / cells - 0.5f);
+            // Pequeño relieve para que la profundidad y la iluminación varíen
+            scene.vertices.emplace_back(fx, fy, 0.05f * std::sin(fx * 9.0f) * std::cos(fy * 7.0f));
+        }
+    }
+    for (int y = 0; y < cells; y++) {
+        for (int x = 0; x < cells; x++) {
+            int i0 = y * (cells + 1) + x;
+            int i1 = i0 + cells + 1;
+            addTriangle(scene.faces, i0, i0 + 1, i1);
+            addTriangle(scene.faces, i0 + 1, i1 + 1, i1);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        scene.poses.push_back(glm::rotate(glm::mat4(1), glm::radians(15.0f + i * 10.0f), glm::vec3(1, 0.2f, 0)));
+    }
+    return scene;
+}
+
+// Pocos triángulos mucho más grandes que la pantalla: domina el costo por píxel y el recorte
+BenchScene hugeTrianglesScene(int count = 8) {
+    BenchScene scene;
+    scene.name = "huge";
+    for (int i = 0; i < count; i++) {
+        float angle = glm::radians(360.0f * i / count);
+        float z = 0.8f - 1.6f * i / count;
+        int base = static_cast<int>(scene.vertices.size());
+        scene.vertices.emplace_back(3.0f * std::cos(angle), 3.0f * std::sin(angle), z);
+        scene.vertices.emplace_back(3.0f * std::cos(angle + 2.1f), 3.0f * std::sin(angle + 2.1f), z + 0.3f);
+        scene.vertices.emplace_back(3.0f * std::cos(angle + 4.2f), 3.0f * std::sin(angle + 4.2f), z - 0.3f);
+        addTriangle(scene.faces, base, base + 1, base + 2);
+    }
+    for (int i = 0; i < 4; i++) {
+        scene.poses.push_back(glm::rotate(glm::mat4(1), glm::radians(i * 7.0f), glm::vec3(0, 0, 1)));
+    }
+    return scene;
+}
+
+// Flota de naves: una sola malla repetida en una rejilla de side x side instancias, vista desde arriba
+BenchScene fleetScene(int side = 32) {
+    BenchScene scene;
+    scene.name = "fleet";
+    loadSpaceship(scene);
+
+    const float spacing = 9.0f;
+    for (int z = 0; z < side; z++) {
+        for (int x = 0; x < side; x++) {
+            glm::vec3 offset((x - (side - 1) * 0.5f) * spacing, 0.0f, (z - (side - 1) * 0.5f) * spacing);
+            float heading = static_cast<float>((x * 37 + z * 11) % 360);
+            scene.instances.push_back(glm::rotate(glm::translate(glm::mat4(1), offset), glm::radians(heading), glm::vec3(0, 1, 0)));
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        glm::mat4 tilt = glm::rotate(glm::mat4(1), glm::radians(30.0f), glm::vec3(1, 0, 0));
+        glm::mat4 spin = glm::rotate(glm::mat4(1), glm::radians(i * 5.0f), glm::vec3(0, 1, 0));
+        scene.poses.push_back(tilt * spin * glm::scale(glm::mat4(1), glm::vec3(0.02f)));
+    }
+    return scene;
+}
+
+// Armada de 128 x 128 naves vista de cerca: casi todas quedan fuera del frustum
+BenchScene armadaScene(int side = 128) {
+    BenchScene scene = fleetScene(side);
+    scene.name = "armada";
+    scene.instancedOnly = true;
+    scene.poses.clear();
+    for (int i = 0; i < 8; i++) {
+        glm::mat4 tilt = glm::rotate(glm::mat4(1), glm::radians(30.0f), glm::vec3(1, 0, 0));
+        glm::mat4 spin = glm::rotate(glm::mat4(1), glm::radians(i * 5.0f), glm::vec3(0, 1, 0));
+        scene.poses.push_back(tilt * spin * glm::scale(glm::mat4(1), glm::vec3(0.05f)));
+    }
+    return scene;
+}
+
+// Todas las escenas del corpus
+std::vector<BenchScene> benchScenes() {
+    std::vector<BenchScene> scenes;
+    scenes.push_back(spaceshipScene());
+    scenes.push_back(sphereScene());
+    scenes.push_back(overdrawScene());
+    scenes.push_back(tinyTrianglesScene());
+    scenes.push_back(hugeTrianglesScene());
+    scenes.push_back(fleetScene());
+    scenes.push_back(armadaScene());
+    return scenes;
+}
+
+// Función para llenar el uniforme de una escena con la cámara del visor
+Uniform benchUniform(const glm::mat4& model, int width, int height) {
+    Uniform uniform;
+    uniform.model = model;
+    uniform.view = createViewMatrix();
+    uniform.projection = createProjectionMatrix(width, height);
+    uniform.viewport = createViewportMatrix(width, height);
+    return uniform;
+}
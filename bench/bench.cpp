@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BenchScenes.h"
+#include "Deferred.h"
+#include "Lighting.h"
+#include "Bitmap.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Multisample.h"
+#include "Quantization.h"
+#include "ShaderProgram.h"
+#include "Texture.h"
+#include "VisibilityBuffer.h"
+#include "RayCaster.h"
+#include "DirtyRegion.h"
+
+// Benchmark de cuadro completo sin ventana: dibuja el corpus de escenas con resoluciones y poses fijas,
+// reporta ms/cuadro, Mtri/s y Mpix/s, y compara la imagen de cada escena con su imagen de referencia (golden).
+//
+// Uso: bench [--frames N] [--warmup N] [--scene nombre] [--path array|indexed|optimized|meshlets|program|visibility|raycast|instanced|lod|quantized|streamed]
+//             [--lighting flat|gouraud|phong] [--texture nearest|bilinear|trilinear] [--lights N] [--shadows hard|pcf3|pcf5] [--shadow-res N] [--cascades N] [--msaa 2|4|8] [--deferred] [--packet 4|8] [--incremental] [--budget MB] [--tolerance N] [--update-golden] [--no-check] [--golden-dir ruta] [--output-dir ruta]
+//
+// --path elige cómo se envía la geometría: "array" usa render() con el arreglo de vértices de setupVertexArray,
+// "indexed" usa renderIndexed() con la malla tal como viene del archivo, "optimized" la pasa antes por optimizeMesh()
+// y "meshlets" además la divide en grupos y usa renderMeshlets() con todas las pruebas de descarte;
+// "program" dibuja la malla del archivo con draw<FlatProgram>() (ver ShaderProgram.h), con la misma cobertura
+// que rasterTriangle(), así que coincide con las referencias;
+// con --lighting gouraud o phong usa drawMesh() con normales (las del archivo, o suavizadas si no las trae),
+// que no coincide con las referencias; con --texture dibuja con drawTexturedMesh() una textura de tablero
+// sobre las coordenadas de la malla (la nave y la esfera las traen), con el filtro pedido. --lights N agrega a
+// estos dibujos N luces puntuales repartidas delante de la escena, que se asignan a mosaicos cada cuadro con
+// cullLights() (ver Lighting.h). --shadows dibuja antes en cada cuadro un mapa de sombras de --shadow-res
+// téxeles por lado y --cascades cascadas (ver ShadowMap.h) y sombrea con el filtro pedido. --deferred dibuja
+// "program" sin textura en un G-buffer y lo ilumina después con una pasada por píxel (ver Deferred.h); la normal
+// comprimida cambia en 1 el color de muchos píxeles, así que no coincide con las referencias.
+// "visibility" dibuja la malla del archivo en un búfer de visibilidad (identificador de triángulo y profundidad,
+// ver VisibilityBuffer.h) y sombrea después cada píxel una vez; da la misma imagen que "indexed" y también
+// acepta --lights y --shadows.
+// "raycast" traza un rayo por píxel contra la jerarquía de triángulos de la malla del archivo (ver RayCaster.h),
+// en paquetes de --packet rayos (4 u 8); difiere de las referencias en algunos píxeles de borde.
+// En las escenas con instancias estos caminos hacen una llamada por instancia; "instanced" en cambio
+// optimiza la malla una vez y dibuja con renderScene() las instancias que la jerarquía deja dentro del frustum;
+// "lod" además genera los niveles de detalle, lo que cambia la imagen de las instancias lejanas, y
+// "quantized" dibuja como "instanced" pero con los vértices comprimidos a 16 bits (ver Quantization.h).
+// --msaa N dibuja "indexed" y "optimized" con N muestras por píxel (ver Multisample.h) y mide también la
+// resolución; suaviza los bordes, así que no coincide con las referencias.
+// "streamed" escribe la malla como archivo de trozos en el directorio temporal y la dibuja con renderStreamed()
+// dentro del presupuesto de --budget MB.
+// --incremental deja la cámara en la primera pose de "instanced", "lod" y "quantized" y mueve una sola instancia
+// por cuadro; solo se limpian y se vuelven a dibujar los mosaicos dañados (ver DirtyRegion.h).
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+// Resoluciones medidas; la primera es la que se compara contra las imágenes de referencia
+const std::vector<Resolution> benchResolutions = {{160, 120}, {500, 500}, {1280, 720}};
+
+struct BenchOptions {
+    int frames = 10;
+    int warmup = 3;
+    std::string scene;
+    std::string path = "array";
+    bool updateGolden = false;
+    bool check = true;
+    size_t tolerance = 0; // Píxeles distintos permitidos (reordenar triángulos puede cambiar empates de profundidad)
+    std::string goldenDir = std::string(SR_SOURCE_DIR) + "/bench/golden";
+    std::string outputDir;                      // Carpeta de las imágenes que no coinciden (vacía: la de goldenDir)
+    size_t budgetMB = 256; // Presupuesto de memoria de --path streamed
+    LightingMode lighting = LightingMode::Flat; // Iluminación de --path program
+    bool textured = false;                      // Textura de --path program
+    TextureFilter filter = TextureFilter::Bilinear;
+    int lights = 0;                             // Luces puntuales de --path program
+    bool shadowed = false;                      // Sombras de --path program
+    ShadowSettings shadowSettings;
+    int msaa = 0;                               // Muestras por píxel de --path indexed y optimized (0: sin MSAA)
+    bool deferred = false;                      // Sombreado diferido de --path program
+    int packetSize = 4;                         // Rayos por paquete de --path raycast
+    bool incremental = false;                   // Dibujo incremental de los caminos con renderScene()
+};
+
+// Función para agregar a las luces de la escena 'count' luces puntuales en una rejilla delante del origen.
+// El alcance se achica con la rejilla para que cada píxel reciba unas pocas luces sin importar el total.
+void addBenchLights(int count) {
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    float range = 1.6f / static_cast<float>(side);
+    for (int i = 0; i < count; i++) {
+        float x = side > 1 ? -0.8f + 1.6f * static_cast<float>(i % side) / static_cast<float>(side - 1) : 0.0f;
+        float y = side > 1 ? -0.8f + 1.6f * static_cast<float>(i / side) / static_cast<float>(side - 1) : 0.0f;
+        sceneLights.add(pointLight(glm::vec3(x, y, -0.2f), 1.0f, range));
+    }
+}
+
+// Dirección hacia la luz de las sombras, en el mundo: la de la luz direccional de la escena vista desde la cámara
+const glm::vec3 BENCH_SHADOW_DIRECTION = glm::vec3(-0.5f, 0.5f, -1.0f);
+
+// Percentil por rango más cercano sobre un arreglo ya ordenado
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Caminos que dibujan con renderScene(), los únicos que aceptan escenas solo de instancias
+bool scenePath(const std::string& path) {
+    return path == "instanced" || path == "lod" || path == "quantized";
+}
+
+// Geometría de una escena preparada según --path
+struct BenchGeometry {
+    bool indexed = false;
+    bool program = false;
+    LightingMode lighting = LightingMode::Flat;
+    bool textured = false;
+    TextureFilter filter = TextureFilter::Bilinear;
+    Texture texture;
+    bool lit = false;           // Con luces puntuales (--lights)
+    LightGrid lightGrid; // Se reparte de nuevo en cada cuadro
+    bool shadowed = false;
+    ShadowSettings shadowSettings;
+    ShadowMap shadowMap; // Se dibuja de nuevo en cada cuadro
+    bool deferred = false;
+    Framebuffer gbuffer;
+    bool visibility = false;
+    VisibilityBuffer visibilityBuffer;
+    bool raycast = false;
+    int packetSize = 4;
+    int msaa = 0;
+    MultisampleFramebuffer multisampled;
+    bool instanced = false;
+    std::vector<glm::vec3> vertexArray;
+    Mesh mesh;
+    Scene scene; // --incremental mueve una instancia en cada cuadro
+    bool incremental = false;
+    std::vector<glm::mat4> restModels; // Matrices de las instancias sin mover
+    DamageTracker damage;
+    std::unique_ptr<StreamedMesh> streamed;
+    std::vector<glm::mat4> instances;
+};
+
+BenchGeometry prepareGeometry(const BenchScene& scene, const BenchOptions& options) {
+    BenchGeometry geometry;
+    geometry.instances = scene.instances;
+    if (scenePath(options.path)) {
+        Mesh mesh = buildMesh(scene.vertices, scene.faces);
+        optimizeMesh(mesh);
+        if (options.path == "lod") {
+            generateLODs(mesh);
+        }
+        if (options.path == "quantized") {
+            quantizeMesh(mesh);
+        }
+        uint32_t meshIndex = geometry.scene.addMesh(std::move(mesh));
+        if (scene.instances.empty()) {
+            geometry.scene.addInstance(meshIndex, glm::mat4(1));
+        }
+        for (const glm::mat4& instance : scene.instances) {
+            geometry.scene.addInstance(meshIndex, instance);
+        }
+        geometry.scene.updateBVH();
+        geometry.instanced = true;
+        geometry.incremental = options.incremental;
+        for (const Instance& instance : geometry.scene.instances) {
+            geometry.restModels.push_back(instance.model);
+        }
+        return geometry;
+    }
+    if (options.path == "streamed") {
+        Mesh mesh = buildMesh(scene.vertices, scene.faces);
+        optimizeMesh(mesh);
+        std::string path = (std::filesystem::temp_directory_path() / (scene.name + ".srm")).string();
+        geometry.streamed = std::make_unique<StreamedMesh>();
+        if (!writeChunkedMesh(path, mesh) || !geometry.streamed->open(path, options.budgetMB << 20)) {
+            std::exit(1);
+        }
+        return geometry;
+    }
+    if (options.path == "array") {
+        geometry.vertexArray = setupVertexArray(scene.vertices, scene.faces);
+        return geometry;
+    }
+    geometry.indexed = true;
+    geometry.program = options.path == "program";
+    geometry.visibility = options.path == "visibility";
+    geometry.lighting = options.lighting;
+    geometry.lit = (geometry.program || geometry.visibility) && options.lights > 0;
+    geometry.shadowed = (geometry.program || geometry.visibility) && options.shadowed;
+    geometry.shadowSettings = options.shadowSettings;
+    if (geometry.program && options.textured) {
+        geometry.textured = true;
+        geometry.filter = options.filter;
+        geometry.texture = checkerTexture(256, 16, Color(230, 230, 230), Color(60, 90, 160));
+        geometry.mesh = buildMesh(scene.vertices, scene.texcoords, {}, scene.faces);
+        return geometry;
+    }
+    geometry.deferred = geometry.program && options.deferred;
+    if (geometry.program && options.lighting != LightingMode::Flat) {
+        geometry.mesh = buildMesh(scene.vertices, scene.texcoords, scene.normals, scene.faces);
+        return geometry;
+    }
+    geometry.mesh = buildMesh(scene.vertices, scene.faces);
+    if (options.path == "optimized" || options.path == "meshlets") {
+        optimizeMesh(geometry.mesh);
+    }
+    if (options.path == "indexed" || options.path == "optimized") {
+        geometry.msaa = options.msaa;
+    }
+    if (options.path == "meshlets") {
+        buildMeshlets(geometry.mesh);
+    }
+    if (options.path == "raycast") {
+        buildTriangleBVH(geometry.mesh);
+        geometry.raycast = true;
+        geometry.packetSize = options.packetSize;
+    }
+    return geometry;
+}
+
+// Función para dibujar una copia de la geometría con la matriz de modelo dada
+void renderCopy(Framebuffer& fb, BenchGeometry& geometry, const glm::mat4& model) {
+    Uniform uniform = benchUniform(model, fb.width, fb.height);
+    const LightGrid* lights = geometry.lit ? &geometry.lightGrid : nullptr;
+    const ShadowMap* shadows = geometry.shadowed ? &geometry.shadowMap : nullptr;
+    if (geometry.streamed) {
+        renderStreamed(fb, *geometry.streamed, uniform);
+    } else if (geometry.textured) {
+        drawTexturedMesh(fb, geometry.mesh, uniform, geometry.texture, geometry.filter, PipelineState(), lights, shadows);
+    } else if (geometry.visibility) {
+        drawVisibility(geometry.visibilityBuffer, geometry.mesh, uniform);
+    } else if (geometry.raycast) {
+        rayCastMesh(fb, geometry.mesh, uniform, Color(255, 255, 255), geometry.packetSize);
+    } else if (geometry.deferred) {
+        drawGBuffer(geometry.gbuffer, geometry.mesh, uniform, geometry.lighting);
+    } else if (geometry.program) {
+        drawMesh(fb, geometry.mesh, uniform, geometry.lighting, PipelineState(), lights, shadows);
+    } else if (!geometry.mesh.meshlets.empty()) {
+        renderMeshlets(fb, geometry.mesh, uniform);
+    } else if (geometry.indexed) {
+        renderIndexed(fb, geometry.mesh, uniform);
+    } else {
+        render(fb, geometry.vertexArray, uniform);
+    }
+}
+
+// Función para dibujar una pose de la escena en el framebuffer
+void renderPose(Framebuffer& fb, BenchGeometry& geometry, const glm::mat4& pose) {
+    if (geometry.msaa > 0) {
+        MultisampleFramebuffer& ms = geometry.multisampled;
+        if (ms.width != fb.width || ms.height != fb.height) {
+            ms.resize(fb.width, fb.height, geometry.msaa);
+        }
+        ms.clear(Color(0, 0, 0));
+        if (geometry.instances.empty()) {
+            renderMultisample(ms, geometry.mesh, benchUniform(pose, fb.width, fb.height));
+        }
+        for (const glm::mat4& instance : geometry.instances) {
+            renderMultisample(ms, geometry.mesh, benchUniform(pose * instance, fb.width, fb.height));
+        }
+        resolveMultisample(ms, fb);
+        return;
+    }
+    if (geometry.incremental) {
+        Uniform uniform = benchUniform(pose, fb.width, fb.height);
+        geometry.damage.update(geometry.scene, uniform, fb.width, fb.height);
+        clearDamage(fb, geometry.damage.damage, Color(0, 0, 0));
+        renderScene(fb, geometry.scene, uniform, PipelineState(), &geometry.damage.damage);
+        return;
+    }
+    clear(fb, Color(0, 0, 0));
+    if (geometry.lit) {
+        cullLights(geometry.lightGrid, sceneLights, benchUniform(pose, fb.width, fb.height), fb.width, fb.height);
+    }
+    if (geometry.shadowed) {
+        prepareShadowMap(geometry.shadowMap, geometry.shadowSettings, BENCH_SHADOW_DIRECTION, benchUniform(pose, fb.width, fb.height));
+        if (geometry.instances.empty()) {
+            drawShadowCaster(geometry.shadowMap, geometry.mesh, pose);
+        }
+        for (const glm::mat4& instance : geometry.instances) {
+            drawShadowCaster(geometry.shadowMap, geometry.mesh, pose * instance);
+        }
+    }
+    if (geometry.deferred) {
+        if (geometry.gbuffer.width != fb.width || geometry.gbuffer.height != fb.height) {
+            geometry.gbuffer.resize(fb.width, fb.height);
+        }
+        geometry.gbuffer.clear(Color(0, 0, 0));
+    }
+    if (geometry.visibility) {
+        geometry.visibilityBuffer.begin(fb.width, fb.height);
+    }
+    if (geometry.streamed) {
+        geometry.streamed->beginFrame();
+    }
+    if (geometry.instanced) {
+        renderScene(fb, geometry.scene, benchUniform(pose, fb.width, fb.height));
+    } else if (geometry.instances.empty()) {
+        renderCopy(fb, geometry, pose);
+    } else {
+        for (const glm::mat4& instance : geometry.instances) {
+            renderCopy(fb, geometry, pose * instance);
+        }
+    }
+    if (geometry.deferred) {
+        shadeGBuffer(fb, geometry.gbuffer, benchUniform(pose, fb.width, fb.height), {Color(255, 255, 255)},
+                     geometry.lit ? &geometry.lightGrid : nullptr, geometry.shadowed ? &geometry.shadowMap : nullptr);
+    }
+    if (geometry.visibility) {
+        shadeVisibility(fb, geometry.visibilityBuffer, geometry.lit ? &geometry.lightGrid : nullptr,
+                        geometry.shadowed ? &geometry.shadowMap : nullptr);
+    }
+}
+
+// Función para mover con --incremental la instancia del cuadro 'frame' (la del cuadro anterior vuelve a su
+// lugar); con frame < 0 todas vuelven a su lugar
+void moveInstance(BenchGeometry& geometry, int frame) {
+    Scene& scene = geometry.scene;
+    size_t count = geometry.restModels.size();
+    if (frame < 0) {
+        for (size_t i = 0; i < count; i++) {
+            scene.setTransform(i, geometry.restModels[i]);
+        }
+    } else {
+        if (frame > 0) {
+            size_t previous = static_cast<size_t>(frame - 1) % count;
+            scene.setTransform(previous, geometry.restModels[previous]);
+        }
+        // El sentido alterna para que una escena de una sola instancia también cambie en cada cuadro
+        size_t moved = static_cast<size_t>(frame) % count;
+        float offset = frame % 2 == 0 ? 0.5f : -0.5f;
+        scene.setTransform(moved, glm::translate(geometry.restModels[moved], glm::vec3(offset, 0.0f, 0.0f)));
+    }
+    scene.updateBVH();
+}
+
+// Función para dibujar el cuadro 'frame' de la medición: con --incremental, la primera pose con una instancia movida
+void renderFrame(Framebuffer& fb, const BenchScene& scene, BenchGeometry& geometry, int frame) {
+    if (geometry.incremental) {
+        moveInstance(geometry, frame);
+        renderPose(fb, geometry, scene.poses.front());
+        return;
+    }
+    renderPose(fb, geometry, scene.poses[frame % scene.poses.size()]);
+}
+
+// Mide una escena en una resolución e imprime una fila de resultados
+void measure(const BenchScene& scene, BenchGeometry& geometry, const Resolution& res, const BenchOptions& options) {
+    Framebuffer fb(res.width, res.height);
+    geometry.damage.invalidate(); // El framebuffer es nuevo
+
+    for (int i = 0; i < options.warmup; i++) {
+        renderFrame(fb, scene, geometry, i);
+        // Medir con los trozos ya leídos (los cuadros medidos no esperan al disco)
+        if (geometry.streamed) {
+            geometry.streamed->waitIdle();
+        }
+    }
+
+    std::vector<double> times;
+    for (int i = 0; i < options.frames; i++) {
+        auto start = std::chrono::steady_clock::now();
+        renderFrame(fb, scene, geometry, options.warmup + i);
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    if (geometry.incremental) {
+        moveInstance(geometry, -1);
+    }
+
+    double total = 0.0;
+    for (double t : times) {
+        total += t;
+    }
+    double mean = total / static_cast<double>(times.size());
+    std::sort(times.begin(), times.end());
+
+    // Mtri/s cuenta los triángulos enviados; Mpix/s cuenta los píxeles del framebuffer producidos
+    size_t submitted = scene.faces.size() * std::max<size_t>(1, scene.instances.size());
+    double triangles = static_cast<double>(submitted);
+    double pixels = static_cast<double>(res.width) * res.height;
+
+    std::printf("%-10s %5dx%-5d %9zu %9.3f %9.3f %9.3f %9.3f %9.2f %9.2f\n",
+                scene.name.c_str(), res.width, res.height, submitted,
+                mean, percentile(times, 0.50), percentile(times, 0.95), percentile(times, 0.99),
+                triangles / (mean * 1000.0), pixels / (mean * 1000.0));
+}
+
+// Compara (o actualiza) la imagen de referencia de la escena. Devuelve false si hay diferencias.
+bool checkGolden(const BenchScene& scene, BenchGeometry& geometry, const BenchOptions& options) {
+    const Resolution& res = benchResolutions.front();
+    Framebuffer fb(res.width, res.height);
+    geometry.damage.invalidate();
+    if (geometry.streamed) {
+        renderPose(fb, geometry, scene.poses.front());
+        geometry.streamed->waitIdle();
+    }
+    renderPose(fb, geometry, scene.poses.front());
+
+    std::string goldenPath = options.goldenDir + "/" + scene.name + ".bmp";
+    if (options.updateGolden) {
+        std::filesystem::create_directories(options.goldenDir);
+        return writeBMP24(goldenPath, fb.width, fb.height, fb.color);
+    }
+
+    int width = 0;
+    int height = 0;
+    std::vector<Color> golden;
+    if (!readBMP24(goldenPath, width, height, golden)) {
+        std::cout << "  " << scene.name << ": sin imagen de referencia (" << goldenPath << ")\n";
+        return false;
+    }
+    if (width != fb.width || height != fb.height) {
+        std::cout << "  " << scene.name << ": la referencia mide " << width << "x" << height << "\n";
+        return false;
+    }
+
+    size_t differing = 0;
+    int maxDifference = 0;
+    for (size_t i = 0; i < golden.size(); i++) {
+        const Color& g = golden[i];
+        const Color& c = fb.color[i];
+        int difference = std::max({std::abs(g.r - c.r), std::abs(g.g - c.g), std::abs(g.b - c.b)});
+        if (difference > 0) {
+            differing++;
+            maxDifference = std::max(maxDifference, difference);
+        }
+    }
+
+    if (differing > options.tolerance) {
+        std::string outputDir = options.outputDir.empty() ? options.goldenDir : options.outputDir;
+        std::filesystem::create_directories(outputDir);
+        std::string actualPath = outputDir + "/" + scene.name + "_actual.bmp";
+        writeBMP24(actualPath, fb.width, fb.height, fb.color);
+        std::cout << "  " << scene.name << ": " << differing << " pixeles distintos (diferencia maxima "
+                  << maxDifference << "), imagen actual en " << actualPath << "\n";
+        return false;
+    }
+    if (differing > 0) {
+        std::cout << "  " << scene.name << ": " << differing << " pixeles distintos, dentro de la tolerancia\n";
+        return true;
+    }
+    std::cout << "  " << scene.name << ": identica a la referencia\n";
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--scene" && i + 1 < argc) {
+            options.scene = argv[++i];
+        } else if (arg == "--path" && i + 1 < argc) {
+            options.path = argv[++i];
+        } else if (arg == "--golden-dir" && i + 1 < argc) {
+            options.goldenDir = argv[++i];
+        } else if (arg == "--output-dir" && i + 1 < argc) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            options.tolerance = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--budget" && i + 1 < argc) {
+            options.budgetMB = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--lighting" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            options.lighting = mode == "gouraud" ? LightingMode::Gouraud : mode == "phong" ? LightingMode::Phong : LightingMode::Flat;
+        } else if (arg == "--texture" && i + 1 < argc) {
+            std::string filter = argv[++i];
+            options.textured = true;
+            options.filter = filter == "nearest" ? TextureFilter::Nearest : filter == "trilinear" ? TextureFilter::Trilinear : TextureFilter::Bilinear;
+        } else if (arg == "--lights" && i + 1 < argc) {
+            options.lights = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--shadows" && i + 1 < argc) {
+            std::string filter = argv[++i];
+            options.shadowed = true;
+            options.shadowSettings.filter = filter == "hard" ? ShadowFilter::Hard : filter == "pcf5" ? ShadowFilter::PCF5x5 : ShadowFilter::PCF3x3;
+        } else if (arg == "--shadow-res" && i + 1 < argc) {
+            options.shadowSettings.resolution = std::max(16, std::atoi(argv[++i]));
+        } else if (arg == "--cascades" && i + 1 < argc) {
+            options.shadowSettings.cascades = std::clamp(std::atoi(argv[++i]), 1, SHADOW_MAX_CASCADES);
+        } else if (arg == "--msaa" && i + 1 < argc) {
+            options.msaa = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--deferred") {
+            options.deferred = true;
+        } else if (arg == "--incremental") {
+            options.incremental = true;
+        } else if (arg == "--packet" && i + 1 < argc) {
+            options.packetSize = std::atoi(argv[++i]) >= 8 ? 8 : 4;
+        } else if (arg == "--update-golden") {
+            options.updateGolden = true;
+        } else if (arg == "--no-check") {
+            options.check = false;
+        } else {
+            std::cerr << "Uso: bench [--frames N] [--warmup N] [--scene nombre] [--path array|indexed|optimized|meshlets|program|visibility|raycast|instanced|lod|quantized|streamed] [--lighting flat|gouraud|phong] [--texture nearest|bilinear|trilinear] [--lights N] [--shadows hard|pcf3|pcf5] [--shadow-res N] [--cascades N] [--msaa 2|4|8] [--deferred] [--packet 4|8] [--incremental] [--budget MB] [--tolerance N] [--update-golden] [--no-check] [--golden-dir ruta] [--output-dir ruta]\n";
+            return 2;
+        }
+    }
+
+    addBenchLights(options.lights);
+    std::vector<BenchScene> scenes = benchScenes();
+
+    std::printf("%-10s %11s %9s %9s %9s %9s %9s %9s %9s\n",
+                "escena", "resolucion", "tris", "ms/media", "ms/p50", "ms/p95", "ms/p99", "Mtri/s", "Mpix/s");
+    for (const BenchScene& scene : scenes) {
+        if (!options.scene.empty() && options.scene != scene.name) {
+            continue;
+        }
+        if (scene.instancedOnly && !scenePath(options.path)) {
+            std::printf("%-10s (solo con --path instanced, lod o quantized)\n", scene.name.c_str());
+            continue;
+        }
+        BenchGeometry geometry = prepareGeometry(scene, options);
+        for (const Resolution& res : benchResolutions) {
+            measure(scene, geometry, res, options);
+        }
+    }
+
+    if (!options.check && !options.updateGolden) {
+        return 0;
+    }
+
+    std::cout << (options.updateGolden ? "Actualizando imagenes de referencia:\n" : "Comparando con imagenes de referencia:\n");
+    bool allMatch = true;
+    for (const BenchScene& scene : scenes) {
+        if ((!options.scene.empty() && options.scene != scene.name) || (scene.instancedOnly && !scenePath(options.path))) {
+            continue;
+        }
+        BenchGeometry geometry = prepareGeometry(scene, options);
+        allMatch = checkGolden(scene, geometry, options) && allMatch;
+    }
+    return allMatch ? 0 : 1;
+}
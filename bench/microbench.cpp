@@ -0,0 +1,511 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define SR_HAS_RDTSC 1
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#include "BenchScenes.h"
+#include "Bitmap.h"
+#include "Multisample.h"
+#include "Picking.h"
+#include "ShaderProgram.h"
+#include "Texture.h"
+
+// Microbenchmarks de cada núcleo del pipeline con entradas controladas (semilla fija),
+// hilo fijado a un núcleo y contador de ciclos. Cada núcleo puede registrar varias variantes
+// (por ejemplo "escalar" y "simd") para compararlas entre sí y entre commits.
+//
+// Uso: microbench [--filter texto] [--reps N] [--cpu N]
+
+// Evita que el compilador elimine un resultado que no se usa
+template <typename T>
+void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+// Contador de ciclos del procesador (o nanosegundos si la arquitectura no lo ofrece)
+uint64_t readCycles() {
+#if SR_HAS_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Fija el hilo actual a un núcleo para reducir el ruido de las migraciones
+bool pinToCpu(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Un núcleo medido: 'run' ejecuta un lote y devuelve cuántos elementos procesó;
+// 'bytes' (opcional) indica cuántos bytes procesa cada lote para reportar MB/s.
+struct Kernel {
+    std::string name;
+    std::string variant;
+    std::string unit;
+    std::function<uint64_t()> run;
+    uint64_t bytes = 0;
+};
+
+struct MicroOptions {
+    std::string filter;
+    int reps = 15;
+    int cpu = 0;
+};
+
+void runKernel(const Kernel& kernel, const MicroOptions& options) {
+    // Calentamiento: llena cachés y estabiliza la frecuencia
+    uint64_t items = kernel.run();
+
+    std::vector<double> nanos;
+    std::vector<double> cycles;
+    for (int r = 0; r < options.reps; r++) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t c0 = readCycles();
+        items = kernel.run();
+        uint64_t c1 = readCycles();
+        auto end = std::chrono::steady_clock::now();
+        nanos.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        cycles.push_back(static_cast<double>(c1 - c0));
+    }
+    std::sort(nanos.begin(), nanos.end());
+    std::sort(cycles.begin(), cycles.end());
+
+    // Se reporta la mediana; el mínimo indica el mejor caso alcanzable
+    double medianNs = nanos[nanos.size() / 2];
+    double minNs = nanos.front();
+    double perItem = static_cast<double>(std::max<uint64_t>(items, 1));
+
+    std::printf("%-24s %-8s %12.2f %12.2f %12.2f %12.2f",
+                kernel.name.c_str(), kernel.variant.c_str(),
+                medianNs / perItem, minNs / perItem,
+                cycles[cycles.size() / 2] / perItem,
+                perItem / medianNs * 1000.0);
+    if (kernel.bytes > 0) {
+        std::printf(" M%s/s  %8.1f MB/s\n", kernel.unit.c_str(), static_cast<double>(kernel.bytes) / medianNs * 1000.0);
+    } else {
+        std::printf(" M%s/s\n", kernel.unit.c_str());
+    }
+}
+
+// Escribe una malla como OBJ para medir el parser con un archivo grande
+void writeOBJ(const std::string& path, const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces) {
+    std::ofstream file(path);
+    for (const glm::vec3& v : vertices) {
+        file << "v " << v.x << " " << v.y << " " << v.z << "\n";
+    }
+    for (const Face& face : faces) {
+        file << "f";
+        for (const auto& index : face.vertexIndices) {
+            file << " " << index[0] + 1 << "/1/1";
+        }
+        file << "\n";
+    }
+}
+
+// Programa que interpola la posición del modelo y guarda en cada píxel cubierto la distancia, en píxeles, entre
+// el píxel y esa posición reproyectada: el error de la interpolación correcta en perspectiva
+struct ReprojectionProgram {
+    using Attributes = glm::vec3;
+    struct Varyings {
+        glm::vec3 position;
+    };
+
+    glm::mat4 transform;
+    std::vector<float>* errors; // Un valor por píxel, -1 en los no cubiertos
+    int width;
+
+    glm::vec4 vertex(const glm::vec3& position, Varyings& out) const {
+        out.position = position;
+        return transform * glm::vec4(position, 1.0f);
+    }
+
+    Color fragment(const Varyings& in, const FragmentInput& fragment) const {
+        glm::vec4 r = transform * glm::vec4(in.position, 1.0f);
+        float error = glm::length(glm::vec2(r) / r.w - glm::vec2(fragment.position));
+        (*errors)[static_cast<size_t>(fragment.position.y) * width + static_cast<size_t>(fragment.position.x)] = error;
+        return Color(255, 255, 255);
+    }
+};
+
+int main(int argc, char** argv) {
+    MicroOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--reps" && i + 1 < argc) {
+            options.reps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--cpu" && i + 1 < argc) {
+            options.cpu = std::atoi(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Uso: microbench [--filter texto] [--reps N] [--cpu N]\n");
+            return 2;
+        }
+    }
+
+    if (!pinToCpu(options.cpu)) {
+        std::printf("Aviso: no se pudo fijar el hilo al nucleo %d\n", options.cpu);
+    }
+#if !SR_HAS_RDTSC
+    std::printf("Aviso: sin contador de ciclos; la columna ciclos/op muestra ticks del reloj\n");
+#endif
+
+    // Entradas controladas
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    const int width = 500;
+    const int height = 500;
+    Uniform uniform = benchUniform(createModelMatrix(3.14f / 3.0f, 0.5f / 3.0f), width, height);
+
+    std::vector<Vertex> inputVertices(1 << 16);
+    for (Vertex& v : inputVertices) {
+        v = Vertex{glm::vec3(unit(rng), unit(rng), unit(rng)), Color(255, 255, 255)};
+    }
+    std::vector<Vertex> transformed(inputVertices.size());
+
+    // Triángulo de unos 60x60 píxeles y puntos de prueba dentro de su caja
+    Vertex ta = {glm::vec3(200.5f, 200.5f, 0.4f), Color(255, 255, 255)};
+    Vertex tb = {glm::vec3(262.5f, 214.5f, 0.5f), Color(255, 255, 255)};
+    Vertex tc = {glm::vec3(221.5f, 259.5f, 0.6f), Color(255, 255, 255)};
+    const uint64_t triangleFragments = triangle(ta, tb, tc).size();
+    std::vector<glm::vec3> samplePoints(1 << 16);
+    for (glm::vec3& p : samplePoints) {
+        p = glm::vec3(200.0f + 62.0f * (unit(rng) * 0.5f + 0.5f), 200.0f + 60.0f * (unit(rng) * 0.5f + 0.5f), 0.0f);
+    }
+
+    // Fragmentos con posiciones y profundidades aleatorias dentro de la pantalla
+    std::vector<Fragment> fragments(1 << 18);
+    for (Fragment& f : fragments) {
+        f.position = glm::vec3(std::floor(1.0f + (width - 2) * (unit(rng) * 0.5f + 0.5f)),
+                               std::floor(1.0f + (height - 2) * (unit(rng) * 0.5f + 0.5f)),
+                               unit(rng) * 0.5f + 0.5f);
+        f.color = Color(200, 200, 200);
+    }
+    Framebuffer fb(width, height);
+
+    BenchScene sphere = sphereScene(128, 256);
+    std::vector<glm::vec3> sphereArray = setupVertexArray(sphere.vertices, sphere.faces);
+    std::vector<Vertex> sphereTransformed;
+    for (const glm::vec3& v : sphereArray) {
+        sphereTransformed.push_back(vertexShader(Vertex{v, Color(255, 255, 255)}, uniform));
+    }
+
+    std::string objPath = (std::filesystem::temp_directory_path() / "sr_microbench_sphere.obj").string();
+    writeOBJ(objPath, sphere.vertices, sphere.faces);
+    uint64_t objBytes = std::filesystem::file_size(objPath);
+
+    std::vector<Color> image(static_cast<size_t>(width) * height);
+    for (Color& c : image) {
+        c = Color(static_cast<int>(rng() & 0xFF), static_cast<int>(rng() & 0xFF), static_cast<int>(rng() & 0xFF));
+    }
+
+    // Coordenadas de textura de cuadros de 2x2 píxeles sobre una superficie girada 30 grados, a un téxel por píxel
+    Texture texture = checkerTexture(256, 16, Color(230, 230, 230), Color(60, 90, 160));
+    std::vector<glm::vec2> quadTexcoords(1 << 16);
+    {
+        glm::vec2 stepX = glm::vec2(std::cos(0.52f), std::sin(0.52f)) / 256.0f;
+        glm::vec2 stepY = glm::vec2(-stepX.y, stepX.x);
+        for (size_t q = 0; q < quadTexcoords.size() / 4; q++) {
+            glm::vec2 origin = stepX * static_cast<float>(2 * (q % 128)) + stepY * static_cast<float>(2 * (q / 128));
+            for (int i = 0; i < 4; i++) {
+                quadTexcoords[4 * q + i] = origin + stepX * static_cast<float>(i & 1) + stepY * static_cast<float>(i >> 1);
+            }
+        }
+    }
+
+    // Textura grande (16 MB) recorrida en diagonal, guardada por filas y en mosaico
+    const int largeSize = 2048;
+    std::vector<Color> largePixels(static_cast<size_t>(largeSize) * largeSize);
+    for (Color& c : largePixels) {
+        c = Color(static_cast<int>(rng() & 0xFF), static_cast<int>(rng() & 0xFF), static_cast<int>(rng() & 0xFF));
+    }
+    TextureLevel largeLevel = createTexture(largeSize, largeSize, largePixels).levels[0];
+    std::vector<glm::ivec2> diagonalTexels(1 << 18);
+    for (size_t i = 0; i < diagonalTexels.size(); i++) {
+        // Filas de 512 píxeles giradas 60 grados: cada paso avanza medio téxel en x y casi uno en y
+        float t = static_cast<float>(i % 512);
+        float row = static_cast<float>(i / 512);
+        diagonalTexels[i] = glm::ivec2(static_cast<int>(100.0f + 0.5f * t - 0.866f * row) & (largeSize - 1),
+                                       static_cast<int>(100.0f + 0.866f * t + 0.5f * row) & (largeSize - 1));
+    }
+
+    // Esfera dibujada con 4 muestras por píxel: mosaicos con y sin bordes como en un cuadro real
+    Mesh sphereMesh = buildMesh(sphere.vertices, sphere.faces);
+    MultisampleFramebuffer multisampled(width, height, 4);
+    renderMultisample(multisampled, sphereMesh, uniform);
+    MultisampleFramebuffer allEdges = multisampled;
+    for (int ty = 0; ty * MULTISAMPLE_TILE_SIZE < height; ty++) {
+        for (int tx = 0; tx < allEdges.tilesX; tx++) {
+            if (allEdges.tiles[static_cast<size_t>(ty) * allEdges.tilesX + tx] == SampleTile::Cleared) {
+                allEdges.fillTile(tx, ty);
+            }
+        }
+    }
+    std::fill(allEdges.tiles.begin(), allEdges.tiles.end(), SampleTile::Edges);
+
+    // Consultas en píxeles al azar sobre la esfera, con el búfer de visibilidad y con rayos
+    Scene pickedScene;
+    {
+        Mesh pickMesh = sphereMesh;
+        buildTriangleBVH(pickMesh);
+        pickedScene.addInstance(pickedScene.addMesh(std::move(pickMesh)), glm::mat4(1));
+        pickedScene.updateBVH();
+    }
+    VisibilityBuffer visibility;
+    visibility.begin(width, height);
+    drawVisibility(visibility, pickedScene.meshes[0], uniform);
+    // Los puntos caen en la caja de la esfera en pantalla, así que casi todos la tocan
+    glm::ivec2 pickMin(width, height);
+    glm::ivec2 pickMax(0, 0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (visibility.idAt(x, y) != VISIBILITY_EMPTY) {
+                pickMin = glm::min(pickMin, glm::ivec2(x, y));
+                pickMax = glm::max(pickMax, glm::ivec2(x, y));
+            }
+        }
+    }
+    std::vector<glm::ivec2> pickPoints(1 << 12);
+    for (glm::ivec2& p : pickPoints) {
+        p = glm::ivec2(pickMin.x + static_cast<int>(rng() % (pickMax.x - pickMin.x + 1)),
+                       pickMin.y + static_cast<int>(rng() % (pickMax.y - pickMin.y + 1)));
+    }
+    std::vector<PickResult> pickResults;
+
+    // Plano muy inclinado (un piso que va de cerca de la cámara hasta lejos) para comprobar la interpolación
+    // en perspectiva de draw<Program>(): la posición interpolada, reproyectada, cae en su píxel
+    const float reprojectionTolerance = 1e-3f; // Píxeles
+    std::vector<glm::vec3> floorVertices = {{-0.6f, -0.3f, -3.5f}, {0.6f, -0.3f, -3.5f}, {0.6f, -0.3f, 15.0f}, {-0.6f, -0.3f, 15.0f}};
+    std::vector<uint32_t> floorIndices = {0, 1, 2, 0, 2, 3};
+    std::vector<float> reprojectionErrors(static_cast<size_t>(width) * height, -1.0f);
+    ReprojectionProgram reprojection{uniform.viewport * uniform.projection * uniform.view, &reprojectionErrors, width};
+    {
+        fb.clear(Color(0, 0, 0));
+        draw(fb, reprojection, floorVertices, floorIndices);
+        float maxError = 0.0f;
+        size_t covered = 0;
+        for (float error : reprojectionErrors) {
+            maxError = std::max(maxError, error);
+            covered += error >= 0.0f;
+        }
+        std::printf("Interpolacion en perspectiva: %zu pixeles, error maximo de reproyeccion %.6f px\n", covered, maxError);
+        if (covered == 0 || maxError > reprojectionTolerance) {
+            std::fprintf(stderr, "Error: el error de reproyeccion supera %g px\n", reprojectionTolerance);
+            return 1;
+        }
+    }
+
+    std::vector<Kernel> kernels;
+
+    kernels.push_back({"vertexShader", "escalar", "vert", [&]() {
+        for (size_t i = 0; i < inputVertices.size(); i++) {
+            transformed[i] = vertexShader(inputVertices[i], uniform);
+        }
+        doNotOptimize(transformed.data());
+        return static_cast<uint64_t>(inputVertices.size());
+    }});
+
+    kernels.push_back({"barycentricCoordinates", "escalar", "pt", [&]() {
+        float sum = 0.0f;
+        for (const glm::vec3& p : samplePoints) {
+            glm::vec3 bar = barycentricCoordinates(p, ta.position, tb.position, tc.position);
+            sum += bar.x;
+        }
+        doNotOptimize(sum);
+        return static_cast<uint64_t>(samplePoints.size());
+    }});
+
+    kernels.push_back({"triangle (raster)", "escalar", "px", [&]() {
+        uint64_t pixels = 0;
+        for (int i = 0; i < 16; i++) {
+            std::vector<Fragment> out = triangle(ta, tb, tc);
+            pixels += out.size();
+            doNotOptimize(out.data());
+        }
+        return pixels;
+    }});
+
+    kernels.push_back({"triangle (raster)", "especializado", "px", [&]() {
+        // Escribe directo en el framebuffer; tras la primera vez la prueba de profundidad falla pero el costo es el mismo
+        RasterKernel raster = selectRasterKernel(PipelineState());
+        for (int i = 0; i < 16; i++) {
+            raster(fb, ta, tb, tc, Color(255, 255, 255));
+            doNotOptimize(fb.color.data());
+        }
+        return 16 * triangleFragments;
+    }});
+
+    kernels.push_back({"triangle (raster)", "msaa 4x", "px", [&]() {
+        for (int i = 0; i < 16; i++) {
+            rasterMultisample<4>(multisampled, ta, tb, tc, Color(255, 255, 255));
+            doNotOptimize(multisampled.color.data());
+        }
+        return 16 * triangleFragments;
+    }});
+
+    kernels.push_back({"point (depth test)", "escalar", "frag", [&]() {
+        fb.clear(Color(0, 0, 0));
+        for (const Fragment& f : fragments) {
+            point(fb, f);
+        }
+        doNotOptimize(fb.depth.data());
+        return static_cast<uint64_t>(fragments.size());
+    }});
+
+    kernels.push_back({"primitiveAssembly", "escalar", "tri", [&]() {
+        std::vector<std::vector<Vertex>> triangles = primitiveAssembly(sphereTransformed);
+        doNotOptimize(triangles.data());
+        return static_cast<uint64_t>(triangles.size());
+    }});
+
+    kernels.push_back({"loadOBJ", "escalar", "vert", [&]() {
+        std::vector<glm::vec3> vertices;
+        std::vector<Face> faces;
+        loadOBJ(objPath, vertices, faces);
+        doNotOptimize(vertices.data());
+        return static_cast<uint64_t>(vertices.size());
+    }, objBytes});
+
+    kernels.push_back({"setupVertexArray", "escalar", "vert", [&]() {
+        std::vector<glm::vec3> vertexArray = setupVertexArray(sphere.vertices, sphere.faces);
+        doNotOptimize(vertexArray.data());
+        return static_cast<uint64_t>(vertexArray.size());
+    }});
+
+    kernels.push_back({"encodeBMP24 (writeBMP)", "escalar", "px", [&]() {
+        std::vector<uint8_t> data = encodeBMP24(width, height, image);
+        doNotOptimize(data.data());
+        return static_cast<uint64_t>(image.size());
+    }, static_cast<uint64_t>(image.size()) * 3});
+
+    for (TextureFilter filter : {TextureFilter::Bilinear, TextureFilter::Trilinear}) {
+        std::string name = filter == TextureFilter::Bilinear ? "texture (bilinear)" : "texture (trilinear)";
+        kernels.push_back({name, "escalar", "muestra", [&, filter]() {
+            uint32_t sum = 0;
+            for (const glm::vec2& uv : quadTexcoords) {
+                sum += sampleTexture(texture, uv, 0.6f, filter).r;
+            }
+            doNotOptimize(sum);
+            return static_cast<uint64_t>(quadTexcoords.size());
+        }});
+        kernels.push_back({name, "simd", "muestra", [&, filter]() {
+            uint32_t sum = 0;
+            Color out[4];
+            for (size_t q = 0; q < quadTexcoords.size(); q += 4) {
+                sampleTextureQuad(texture, &quadTexcoords[q], 0.6f, filter, out);
+                sum += out[0].r + out[1].r + out[2].r + out[3].r;
+            }
+            doNotOptimize(sum);
+            return static_cast<uint64_t>(quadTexcoords.size());
+        }});
+    }
+
+    kernels.push_back({"texel fetch (diagonal)", "filas", "texel", [&]() {
+        uint32_t sum = 0;
+        for (const glm::ivec2& t : diagonalTexels) {
+            sum += largePixels[static_cast<size_t>(t.y) * largeSize + t.x].r;
+        }
+        doNotOptimize(sum);
+        return static_cast<uint64_t>(diagonalTexels.size());
+    }});
+
+    kernels.push_back({"texel fetch (diagonal)", "mosaico", "texel", [&]() {
+        uint32_t sum = 0;
+        for (const glm::ivec2& t : diagonalTexels) {
+            sum += largeLevel.fetch(t.x, t.y).r;
+        }
+        doNotOptimize(sum);
+        return static_cast<uint64_t>(diagonalTexels.size());
+    }});
+
+    // La suma usa los cuatro canales: con uno solo, el compilador descarta el resto del promedio escalar
+    kernels.push_back({"msaa average (4x)", "escalar", "px", [&]() {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < fb.color.size(); i++) {
+            Color c = averageSamplesScalar<4>(&allEdges.color[i * 4]);
+            sum += c.r + c.g + c.b + c.a;
+        }
+        doNotOptimize(sum);
+        return static_cast<uint64_t>(fb.color.size());
+    }});
+
+    kernels.push_back({"msaa average (4x)", "simd", "px", [&]() {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < fb.color.size(); i++) {
+            Color c = averageSamples<4>(&allEdges.color[i * 4]);
+            sum += c.r + c.g + c.b + c.a;
+        }
+        doNotOptimize(sum);
+        return static_cast<uint64_t>(fb.color.size());
+    }});
+
+    kernels.push_back({"msaa resolve (4x)", "bordes", "px", [&]() {
+        resolveMultisample(allEdges, fb);
+        doNotOptimize(fb.color.data());
+        return static_cast<uint64_t>(fb.color.size());
+    }});
+
+    kernels.push_back({"msaa resolve (4x)", "mosaico", "px", [&]() {
+        resolveMultisample(multisampled, fb);
+        doNotOptimize(fb.color.data());
+        return static_cast<uint64_t>(fb.color.size());
+    }});
+
+    kernels.push_back({"program (perspectiva)", "escalar", "px", [&]() {
+        fb.clear(Color(0, 0, 0));
+        draw(fb, reprojection, floorVertices, floorIndices);
+        doNotOptimize(reprojectionErrors.data());
+        return static_cast<uint64_t>(std::count_if(reprojectionErrors.begin(), reprojectionErrors.end(),
+                                                   [](float error) { return error >= 0.0f; }));
+    }});
+
+    kernels.push_back({"pick", "id", "consulta", [&]() {
+        pickVisibility(visibility, pickPoints, pickResults);
+        doNotOptimize(pickResults.data());
+        return static_cast<uint64_t>(pickPoints.size());
+    }});
+
+    kernels.push_back({"pick", "bvh", "consulta", [&]() {
+        pickScene(pickedScene, uniform, width, height, pickPoints, pickResults);
+        doNotOptimize(pickResults.data());
+        return static_cast<uint64_t>(pickPoints.size());
+    }});
+
+    std::printf("%-24s %-8s %12s %12s %12s %12s\n", "nucleo", "variante", "ns/op", "ns/op min", "ciclos/op", "throughput");
+    for (const Kernel& kernel : kernels) {
+        if (!options.filter.empty() && kernel.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        runKernel(kernel, options);
+    }
+
+    std::filesystem::remove(objPath);
+    return 0;
+}
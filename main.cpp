@@ -6,16 +6,91 @@
 #include "ShaderUtilities.h"
 #include "GraphicsStructures.h"
 #include "ObjLoader.h"
-#include <array>
-#include <fstream>
+#include "FrameScheduler.h"
+#include "Framebuffer.h"
+#include "Profiler.h"
+#include "PipelineStats.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Scene.h"
+#include "ShaderProgram.h"
+#include "Texture.h"
+#include "Lighting.h"
+#include "ShadowMap.h"
+#include "Multisample.h"
+#include "Deferred.h"
+#include "VisibilityBuffer.h"
+#include "RayCaster.h"
+#include "Picking.h"
+#include "DirtyRegion.h"
 
 const int WINDOW_WIDTH = 500;
 const int WINDOW_HEIGHT = 500;
 
-// Z-buffer para almacenar información de profundidad de los píxeles
-std::array<std::array<float, WINDOW_WIDTH>, WINDOW_HEIGHT> zbuffer;
+// Framebuffer en memoria (color y z-buffer); se sube a la textura de SDL una vez por cuadro
+Framebuffer framebuffer(WINDOW_WIDTH, WINDOW_HEIGHT);
 
 SDL_Renderer* renderer;
+SDL_Texture* framebufferTexture;
+
+// Reordenar la malla al cargarla para aprovechar la caché de vértices transformados
+const bool OPTIMIZE_MESH = true;
+
+// Naves por lado de la flota; todas comparten la malla cargada (1 = solo la nave original)
+const int FLEET_SIZE = 1;
+
+// Mostrar los tiempos por etapa sobre la imagen
+bool showProfilerOverlay = false;
+
+// Iluminación por cara, por vértice o por píxel (tecla 'l')
+LightingMode lightingMode = LightingMode::Flat;
+
+// Textura sobre las coordenadas del modelo (tecla 'x': sin textura, más cercano, bilineal, trilineal).
+// spaceship.obj no trae imagen, así que se usa un tablero generado al cargar.
+bool texturing = false;
+TextureFilter textureFilter = TextureFilter::Nearest;
+Texture texture;
+
+// Luces puntuales y focos alrededor de la flota (tecla 'g'), repartidos en mosaicos en cada cuadro
+bool localLights = false;
+LightGrid lightGrid;
+
+// Sombras de la luz direccional (tecla 'h': sin sombras, una muestra, PCF 3x3, PCF 5x5) con dos cascadas
+bool shadowsEnabled = false;
+ShadowSettings shadowSettings;
+ShadowMap shadowMap;
+const glm::vec3 SHADOW_DIRECTION = glm::vec3(-0.5f, 0.5f, -1.0f); // La luz direccional vista desde la cámara, en el mundo
+
+// Antialiasing por multimuestreo (tecla 'm': sin MSAA, 2, 4 y 8 muestras); solo con la iluminación por cara
+int msaaSamples = 0;
+MultisampleFramebuffer multisampled;
+
+// Sombreado diferido (tecla 'd'): las instancias se dibujan en el G-buffer con su color como material y se
+// iluminan después una vez por píxel. No se combina con la textura ni con MSAA.
+bool deferredShading = false;
+Framebuffer gbuffer(WINDOW_WIDTH, WINDOW_HEIGHT);
+std::vector<Color> materials;
+
+// Búfer de visibilidad (tecla 'v': sombreado directo, sombreado desde el búfer y colores por triángulo para
+// depurar). No se combina con la textura.
+int visibilityMode = 0;
+VisibilityBuffer visibilityBuffer;
+
+// Trazado de rayos en lugar de rasterización (tecla 'r'); solo con la iluminación por cara
+bool rayCasting = false;
+
+// Dibujo incremental (tecla 'i'): la rotación se detiene y solo la primera nave va y viene; cada cuadro limpia,
+// dibuja y sube a la textura solo los mosaicos dañados. Solo con la iluminación por cara y sin MSAA.
+bool incrementalRendering = false;
+DamageTracker damageTracker;
+int lastOverlayHeight = 0; // Franja de la superposición de tiempos del cuadro anterior (0 si no se mostró)
+glm::mat4 shuttleModel = glm::mat4(1.0f); // Posición de reposo de la nave que se mueve
+float shuttlePhase = 0.0f;
+
+// Calcular normales suavizadas en lugar de usar las del archivo (spaceship.obj trae una normal por cara)
+const bool SMOOTH_NORMALS = true;
 
 // Estructura uniforme para pasar datos a los shaders
 Uniform uniform;
@@ -31,226 +106,38 @@ std::string getParentDirectory(const std::string& path) {
     return filePath.parent_path().string();
 }
 
-// Vectores para almacenar vértices y caras del modelo 3D
+// Vectores para almacenar vértices, normales y caras del modelo 3D
 std::vector<glm::vec3> vertices;
+std::vector<glm::vec2> texcoords;
+std::vector<glm::vec3> normals;
 std::vector<Face> faces;
 
+// Mallas cargadas e instancias que las dibujan
+Scene scene;
+
 // Colores para borrar y colorear el framebuffer
 Color clearColor = {0, 0, 0};
 Color currentColor = {255, 255, 255};
 
-// Función para limpiar el framebuffer y el z-buffer
-void clear() {
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
-    SDL_RenderClear(renderer);
-
-    // Inicializar el z-buffer con valores máximos
-    for (auto &row : zbuffer) {
-        std::fill(row.begin(), row.end(), 99999.0f);
-    }
-}
-
-// Función para dibujar un píxel en el framebuffer y actualizar el z-buffer
-void point(Fragment f) {
-    if (f.position.y < WINDOW_HEIGHT && f.position.x < WINDOW_WIDTH && f.position.y > 0 && f.position.x > 0 && f.position.z < zbuffer[f.position.y][f.position.x]) {
-        SDL_SetRenderDrawColor(renderer, f.color.r, f.color.g, f.color.b, f.color.a);
-        SDL_RenderDrawPoint(renderer, f.position.x, f.position.y);
-        zbuffer[f.position.y][f.position.x] = f.position.z;
-    }
-}
-
-// Función para ensamblar los vértices transformados en triángulos
-std::vector<std::vector<Vertex>> primitiveAssembly(
-        const std::vector<Vertex>& transformedVertices
-) {
-    std::vector<std::vector<Vertex>> groupedVertices;
-
-    // Agrupar vértices en conjuntos de tres para formar triángulos
-    for (int i = 0; i < transformedVertices.size(); i += 3) {
-        std::vector<Vertex> vertexGroup;
-        vertexGroup.push_back(transformedVertices[i]);
-        vertexGroup.push_back(transformedVertices[i+1]);
-        vertexGroup.push_back(transformedVertices[i+2]);
-
-        groupedVertices.push_back(vertexGroup);
-    }
-
-    return groupedVertices;
-}
-
-// Función principal para realizar la renderización
-void render(std::vector<glm::vec3> VBO) {
-    std::vector<Vertex> transformedVertices;
-
-    // Transformar los vértices del modelo 3D
-    for (int i = 0; i < VBO.size(); i++) {
-        glm::vec3 v = VBO[i];
-
-        Vertex vertex = {v, Color(255, 255, 255)};
-        Vertex transformedVertex = vertexShader(vertex, uniform);
-        transformedVertices.push_back(transformedVertex);
-    }
-
-    // Ensamblar los triángulos a partir de los vértices transformados
-    std::vector<std::vector<Vertex>> triangles = primitiveAssembly(transformedVertices);
-
-    std::vector<Fragment> fragments;
-    for (const std::vector<Vertex>& triangleVertices : triangles) {
-        // Rasterizar el triángulo y obtener fragmentos
-        std::vector<Fragment> rasterizedTriangle = triangle(
-                triangleVertices[0],
-                triangleVertices[1],
-                triangleVertices[2]
-        );
-
-        // Agregar los fragmentos al vector de fragmentos
-        fragments.insert(
-                fragments.end(),
-                rasterizedTriangle.begin(),
-                rasterizedTriangle.end()
-        );
-    }
-
-    // Dibujar los fragmentos en el framebuffer
-    for (Fragment fragment : fragments) {
-        point(fragmentShader(fragment));
-    }
-}
-
-
 // Definición de las variables 'a' y 'b' para controlar las transformaciones del modelo
 float a = 3.14f / 3.0f;
 float b = 0.5f / 3.0f;
 
-// Función para crear la matriz de modelo
-glm::mat4 createModelMatrix() {
-    // Aumentar el valor de 'b' para rotación
-    b += 0.2f;
-
-    // Crear matrices de transformación para la matriz de modelo
-    glm::mat4 translation = glm::translate(glm::mat4(1), glm::vec3(-0.05f, -0.09f, 0));
-    glm::mat4 rotationY = glm::rotate(glm::mat4(1), glm::radians(a++), glm::vec3(0, 4, 0));
-    glm::mat4 rotationX = glm::rotate(glm::mat4(1), glm::radians(b), glm::vec3(1, 0, 0));
-    glm::mat4 scale = glm::scale(glm::mat4(1), glm::vec3(0.15f, 0.15f, 0.15f));
+// Velocidades de rotación en grados por segundo (equivalentes a 1 y 0.2 grados por cuadro a 144 FPS)
+const float rotationSpeedA = 144.0f;
+const float rotationSpeedB = 28.8f;
 
-    // Combinar las matrices de transformación
-    return translation * scale * rotationX * rotationY;
-}
-
-// Función para crear la matriz de vista
-glm::mat4 createViewMatrix() {
-
-    // Configurar la matriz de vista utilizando glm::lookAt
-    // para definir la posición de la cámara, el punto hacia donde mira y la dirección arriba
-    return glm::lookAt(
-            // donde esta
-            glm::vec3(0, 0, -5),
-            // hacia adonde mira
-            glm::vec3(0, 0, 0),
-            // arriba
-            glm::vec3(0, 1, 0)
-    );
-}
-
-// Función para crear la matriz de proyección
-glm::mat4 createProjectionMatrix() {
-    float fovInDegrees = 20.0f;
-    float aspectRatio = WINDOW_WIDTH / WINDOW_HEIGHT;
-    float nearClip = 0.1f;
-    float farClip = 100.0f;
-
-    return glm::perspective(glm::radians(fovInDegrees), aspectRatio, nearClip, farClip);
-}
-
-// Función para crear la matriz de vista en miniatura (viewport)
-glm::mat4 createViewportMatrix() {
-    glm::mat4 viewport = glm::mat4(1.0f);
-
-    // Escalar
-    viewport = glm::scale(viewport, glm::vec3(WINDOW_WIDTH / 2.0f, WINDOW_HEIGHT / 2.0f, 0.5f));
-
-    // Trasladar
-    viewport = glm::translate(viewport, glm::vec3(1.0f, 1.0f, 0.5f));
-
-    return viewport;
-}
-
-// Función para escribir un archivo BMP a partir del z-buffer
-void writeBMP(const std::string& filename) {
-    // Obtener el tamaño de la ventana (ancho y alto)
-    int width = WINDOW_WIDTH;
-    int height = WINDOW_HEIGHT;
-
-    // Encontrar el valor mínimo (zMin) y máximo (zMax) en el z-buffer
-    float zMin = std::numeric_limits<float>::max();
-    float zMax = std::numeric_limits<float>::lowest();
-
-    for (const auto& row : zbuffer) {
-        for (const auto& val : row) {
-            if (val != 99999.0f) { // Ignorar valores que no han sido actualizados
-                zMin = std::min(zMin, val);
-                zMax = std::max(zMax, val);
-            }
-        }
-    }
-
-    // Verificar si zMin y zMax son iguales (posiblemente debido a un error)
-    if (zMin == zMax) {
-        std::cerr << "zMin y zMax son iguales. Esto producirá una imagen en blanco o negro.\n";
+// Función para avanzar la animación un paso fijo de simulación
+void updateAnimation(float dt) {
+    if (incrementalRendering) {
+        shuttlePhase += dt;
         return;
     }
-
-    // Imprimir los valores de zMin y zMax para referencia
-    std::cout << "zMin: " << zMin << ", zMax: " << zMax << "\n";
-
-    // Abrir el archivo BMP en modo binario para escritura
-    std::ofstream file(filename, std::ios::binary);
-    if (!file) {
-        std::cerr << "No se pudo abrir el archivo para escribir: " << filename << "\n";
-        return;
-    }
-
-    // Escribir la cabecera del archivo BMP
-    uint32_t fileSize = 54 + 3 * width * height;
-    uint32_t dataOffset = 54;
-    uint32_t imageSize = 3 * width * height;
-    uint32_t biPlanes = 1;
-    uint32_t biBitCount = 24;
-
-    uint8_t header[54] = {'B', 'M',
-                          static_cast<uint8_t>(fileSize & 0xFF), static_cast<uint8_t>((fileSize >> 8) & 0xFF), static_cast<uint8_t>((fileSize >> 16) & 0xFF), static_cast<uint8_t>((fileSize >> 24) & 0xFF),
-                          0, 0, 0, 0,
-                          static_cast<uint8_t>(dataOffset & 0xFF), static_cast<uint8_t>((dataOffset >> 8) & 0xFF), static_cast<uint8_t>((dataOffset >> 16) & 0xFF), static_cast<uint8_t>((dataOffset >> 24) & 0xFF),
-                          40, 0, 0, 0,
-                          static_cast<uint8_t>(width & 0xFF), static_cast<uint8_t>((width >> 8) & 0xFF), static_cast<uint8_t>((width >> 16) & 0xFF), static_cast<uint8_t>((width >> 24) & 0xFF),
-                          static_cast<uint8_t>(height & 0xFF), static_cast<uint8_t>((height >> 8) & 0xFF), static_cast<uint8_t>((height >> 16) & 0xFF), static_cast<uint8_t>((height >> 24) & 0xFF),
-                          static_cast<uint8_t>(biPlanes & 0xFF), static_cast<uint8_t>((biPlanes >> 8) & 0xFF),
-                          static_cast<uint8_t>(biBitCount & 0xFF), static_cast<uint8_t>((biBitCount >> 8) & 0xFF)};
-
-    file.write(reinterpret_cast<char*>(header), sizeof(header));
-
-    // Escribir los datos de los píxeles en el archivo BMP
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            // Normalizar los valores de profundidad en el z-buffer
-            float normalized = (zbuffer[y][x] - zMin) / (zMax - zMin);
-
-            // Convertir el valor normalizado en un color de píxel y escribirlo en el archivo
-            auto color = static_cast<uint8_t>(normalized * 255);
-            file.write(reinterpret_cast<char*>(&color), 1);
-            file.write(reinterpret_cast<char*>(&color), 1);
-            file.write(reinterpret_cast<char*>(&color), 1);
-        }
-    }
-
-    // Cerrar el archivo BMP
-    file.close();
-    std::cout << "Archivo BMP guardado: " << filename << "\n";
+    a += rotationSpeedA * dt;
+    b += rotationSpeedB * dt;
 }
 
 
-
-
 int main(int argc, char** argv) {
     SDL_Init(SDL_INIT_EVERYTHING);
 
@@ -261,16 +148,53 @@ int main(int argc, char** argv) {
     std::string currentPath = getCurrentPath();
     std::string fileName = "spaceship.obj";
     std::string filePath = getParentDirectory(currentPath) + "\\" + fileName;
-    loadOBJ(filePath, vertices, faces);
+    AABB bounds;
+    loadOBJ(filePath, vertices, texcoords, normals, faces, bounds);
 
     // Ajustar la orientación del modelo 3D
     glm::vec3 rotationAngles = glm::vec3(125, 120, 50); // Ajusta estos ángulos para la orientación deseada
     for (auto& vertex : vertices) {
         vertex = rotateVertex(vertex, rotationAngles);
     }
+    for (auto& normal : normals) {
+        normal = rotateVertex(normal, rotationAngles);
+    }
 
-    // Crear un arreglo de vértices del modelo 3D
-    std::vector<glm::vec3> vertexArray = setupVertexArray(vertices, faces);
+    // Crear la malla indexada del modelo 3D, optimizar el orden de triángulos y vértices y generar sus niveles de detalle
+    Mesh mesh = buildMesh(vertices, texcoords, SMOOTH_NORMALS ? std::vector<glm::vec3>() : normals, faces);
+    if (OPTIMIZE_MESH) {
+        MeshOptimizationStats optimization = optimizeMesh(mesh);
+        std::cout << "Optimización de malla: ACMR " << optimization.before.acmr << " -> " << optimization.after.acmr
+                  << ", ATVR " << optimization.before.atvr << " -> " << optimization.after.atvr << "\n";
+    }
+    std::vector<LODLevelStats> levels = generateLODs(mesh);
+    std::cout << "Niveles de detalle: " << levels.front().triangles;
+    for (size_t level = 1; level < levels.size(); level++) {
+        std::cout << " -> " << levels[level].triangles << " (error " << levels[level].error << ")";
+    }
+    std::cout << " triangulos\n";
+    texture = checkerTexture(256, 16, Color(230, 230, 230), Color(60, 90, 160));
+    shadowSettings.cascades = 2;
+    for (int i = 0; i < 8; i++) {
+        float angle = glm::radians(45.0f * static_cast<float>(i));
+        sceneLights.add(pointLight(glm::vec3(std::cos(angle), std::sin(angle), -0.3f), 1.0f, 0.6f));
+    }
+    sceneLights.add(spotLight(glm::vec3(0.0f, 0.0f, -1.5f), glm::vec3(0.0f, 0.0f, 1.0f), 2.0f, 3.0f, 10.0f, 20.0f));
+
+    // Colocar la flota en la escena: una instancia por nave, separadas más que el largo de la nave
+    uint32_t spaceship = scene.addMesh(std::move(mesh));
+    const float fleetSpacing = 9.0f;
+    for (int z = 0; z < FLEET_SIZE; z++) {
+        for (int x = 0; x < FLEET_SIZE; x++) {
+            glm::vec3 offset((x - (FLEET_SIZE - 1) * 0.5f) * fleetSpacing, 0.0f, (z - (FLEET_SIZE - 1) * 0.5f) * fleetSpacing);
+            scene.addInstance(spaceship, glm::translate(glm::mat4(1), offset));
+        }
+    }
+    shuttleModel = scene.instances[0].model;
+    scene.updateBVH();
+    for (Mesh& sceneMesh : scene.meshes) {
+        buildTriangleBVH(sceneMesh);
+    }
 
     // Crear el renderizador SDL
     renderer = SDL_CreateRenderer(
@@ -279,9 +203,22 @@ int main(int argc, char** argv) {
             SDL_RENDERER_ACCELERATED
     );
 
+    // Textura a la que se sube el framebuffer en memoria en cada cuadro
+    framebufferTexture = SDL_CreateTexture(
+            renderer,
+            SDL_PIXELFORMAT_RGBA32,
+            SDL_TEXTUREACCESS_STREAMING,
+            WINDOW_WIDTH,
+            WINDOW_HEIGHT
+    );
+
     bool running = true;
     SDL_Event event;
 
+    // Planificador de cuadros: 144 FPS objetivo y simulación a paso fijo de 1/144 s
+    FrameScheduler scheduler(144.0, 144.0);
+    std::string frameReport;
+
     // Arreglo de vértices para un objeto 3D simple
     std::vector<glm::vec3> vertexBufferObject = {
             {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f},
@@ -298,37 +235,250 @@ int main(int argc, char** argv) {
             if (event.type == SDL_QUIT) {
                 running = false;
             }
+            if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
+                // Consultar qué se ve bajo el cursor en el último cuadro, sin volver a dibujarlo
+                std::vector<glm::ivec2> points = {glm::ivec2(event.button.x, event.button.y)};
+                std::vector<PickResult> picked;
+                pickFrame(visibilityMode > 0 && !texturing ? &visibilityBuffer : nullptr, scene, uniform,
+                          WINDOW_WIDTH, WINDOW_HEIGHT, points, picked);
+                if (picked[0].hit) {
+                    std::cout << "Seleccion: instancia " << picked[0].instance << ", triangulo " << picked[0].triangle
+                              << " (nivel " << picked[0].level << "), profundidad " << picked[0].depth << "\n";
+                } else {
+                    std::cout << "Seleccion: fondo\n";
+                }
+            }
             if (event.type == SDL_KEYDOWN) {
                 switch (event.key.keysym.sym) {
                     // Manejar eventos de teclado aquí
+                    case SDLK_p:
+                        // Mostrar u ocultar los tiempos por etapa
+                        showProfilerOverlay = !showProfilerOverlay;
+                        break;
+                    case SDLK_o:
+                        // Guardar el mapa de calor de sobredibujo del último cuadro
+                        writeOverdrawBMP("../Overdraw.bmp", pipelineStats);
+                        break;
+                    case SDLK_t:
+                        // Exportar la traza de las zonas perfiladas
+                        writeChromeTrace("../trace.json");
+                        break;
+                    case SDLK_l:
+                        // Cambiar entre iluminación por cara, por vértice y por píxel
+                        lightingMode = static_cast<LightingMode>((static_cast<int>(lightingMode) + 1) % 3);
+                        break;
+                    case SDLK_x:
+                        // Recorrer sin textura y los filtros de muestreo
+                        if (!texturing) {
+                            texturing = true;
+                            textureFilter = TextureFilter::Nearest;
+                        } else if (textureFilter == TextureFilter::Trilinear) {
+                            texturing = false;
+                        } else {
+                            textureFilter = static_cast<TextureFilter>(static_cast<int>(textureFilter) + 1);
+                        }
+                        break;
+                    case SDLK_g:
+                        // Encender o apagar las luces puntuales y el foco
+                        localLights = !localLights;
+                        break;
+                    case SDLK_h:
+                        // Recorrer sin sombras y los filtros de sombra
+                        if (!shadowsEnabled) {
+                            shadowsEnabled = true;
+                            shadowSettings.filter = ShadowFilter::Hard;
+                        } else if (shadowSettings.filter == ShadowFilter::PCF5x5) {
+                            shadowsEnabled = false;
+                        } else {
+                            shadowSettings.filter = static_cast<ShadowFilter>(static_cast<int>(shadowSettings.filter) + 1);
+                        }
+                        break;
+                    case SDLK_d:
+                        // Cambiar entre sombreado directo y diferido
+                        deferredShading = !deferredShading;
+                        break;
+                    case SDLK_v:
+                        // Recorrer el sombreado directo, el del búfer de visibilidad y la vista de triángulos
+                        visibilityMode = (visibilityMode + 1) % 3;
+                        break;
+                    case SDLK_r:
+                        // Cambiar entre rasterización y trazado de rayos
+                        rayCasting = !rayCasting;
+                        break;
+                    case SDLK_i:
+                        // Cambiar entre el dibujo completo y el incremental (la nave vuelve a su lugar al salir)
+                        incrementalRendering = !incrementalRendering;
+                        scene.setTransform(0, shuttleModel);
+                        scene.updateBVH();
+                        break;
+                    case SDLK_m:
+                        // Recorrer sin MSAA, 2, 4 y 8 muestras por píxel
+                        msaaSamples = msaaSamples == 8 ? 0 : msaaSamples == 0 ? 2 : msaaSamples * 2;
+                        break;
                 }
             }
         }
 
+        PROFILE_BEGIN_FRAME();
+
+        // Avanzar la animación según el tiempo real transcurrido, no según el número de cuadros
+        int steps = scheduler.beginFrame();
+        for (int i = 0; i < steps; i++) {
+            updateAnimation(static_cast<float>(scheduler.fixedStep));
+        }
+
+        if (incrementalRendering) {
+            scene.setTransform(0, glm::translate(shuttleModel, glm::vec3(0.5f * std::sin(2.0f * shuttlePhase), 0.0f, 0.0f)));
+            scene.updateBVH();
+        }
+
         // Configurar las matrices de transformación
-        uniform.model = createModelMatrix();
+        uniform.model = createModelMatrix(a, b);
         uniform.view = createViewMatrix();
-        uniform.projection = createProjectionMatrix();
-        uniform.viewport = createViewportMatrix();
+        uniform.projection = createProjectionMatrix(WINDOW_WIDTH, WINDOW_HEIGHT);
+        uniform.viewport = createViewportMatrix(WINDOW_WIDTH, WINDOW_HEIGHT);
+
+        // Limpiar el framebuffer (o solo los mosaicos dañados) y los contadores del cuadro
+        STATS(pipelineStats.reset(WINDOW_WIDTH, WINDOW_HEIGHT));
+        bool flatScene = !texturing && lightingMode == LightingMode::Flat && !localLights && !shadowsEnabled;
+        bool incrementalFrame = incrementalRendering && flatScene && visibilityMode == 0 && !deferredShading &&
+                                !rayCasting && msaaSamples == 0;
+        if (incrementalFrame) {
+            damageTracker.update(scene, uniform, WINDOW_WIDTH, WINDOW_HEIGHT);
+            // La superposición de tiempos cambia en cada cuadro: su franja y la del cuadro anterior se dibujan de nuevo
+            int overlayHeight = showProfilerOverlay ? profilerOverlayHeight() : 0;
+            int band = std::max(overlayHeight, lastOverlayHeight);
+            if (band > 0) {
+                damageTracker.add(PixelRect{0, 0, WINDOW_WIDTH - 1, band - 1});
+            }
+            lastOverlayHeight = overlayHeight;
+            clearDamage(framebuffer, damageTracker.damage, clearColor);
+        } else {
+            damageTracker.invalidate();
+            clear(framebuffer, clearColor);
+        }
 
-        // Limpiar el framebuffer
-        clear();
+        // Repartir las luces con alcance en mosaicos de pantalla
+        const LightGrid* lights = nullptr;
+        if (localLights) {
+            cullLights(lightGrid, sceneLights, uniform, WINDOW_WIDTH, WINDOW_HEIGHT);
+            lights = &lightGrid;
+        }
 
-        // Realizar la renderización
-        render(vertexArray);
+        // Pasada de solo profundidad desde la luz con todas las instancias
+        const ShadowMap* shadows = nullptr;
+        if (shadowsEnabled) {
+            prepareShadowMap(shadowMap, shadowSettings, SHADOW_DIRECTION, uniform);
+            for (const Instance& instance : scene.instances) {
+                drawShadowCaster(shadowMap, scene.meshes[instance.mesh], uniform.model * instance.model);
+            }
+            shadows = &shadowMap;
+        }
 
-        // Presentar el framebuffer en la ventana
-        SDL_RenderPresent(renderer);
+        // Realizar la renderización; la textura, la iluminación suave, las luces con alcance y las sombras dibujan
+        // cada instancia con su programa de sombreado
+        if (visibilityMode > 0 && !texturing) {
+            // Pasada de identificadores y luego el sombreado (o los colores de depuración) por píxel
+            visibilityBuffer.begin(WINDOW_WIDTH, WINDOW_HEIGHT);
+            for (uint32_t i = 0; i < scene.instances.size(); i++) {
+                const Instance& instance = scene.instances[i];
+                Uniform instanceUniform = uniform;
+                instanceUniform.model = uniform.model * instance.model;
+                drawVisibility(visibilityBuffer, scene.meshes[instance.mesh], instanceUniform, instance.color, i);
+            }
+            if (visibilityMode == 1) {
+                shadeVisibility(framebuffer, visibilityBuffer, lights, shadows);
+            } else {
+                drawVisibilityDebug(framebuffer, visibilityBuffer);
+            }
+        } else if (deferredShading && !texturing) {
+            // Pasada de geometría al G-buffer y luego la de iluminación sobre el framebuffer
+            gbuffer.clear(clearColor);
+            materials.clear();
+            for (const Instance& instance : scene.instances) {
+                Uniform instanceUniform = uniform;
+                instanceUniform.model = uniform.model * instance.model;
+                // Las instancias del mismo color comparten material; pasados los 256 se reutiliza el último
+                size_t material = 0;
+                while (material < materials.size() && (materials[material].r != instance.color.r ||
+                       materials[material].g != instance.color.g || materials[material].b != instance.color.b)) {
+                    material++;
+                }
+                if (material == materials.size() && materials.size() < 256) {
+                    materials.push_back(instance.color);
+                }
+                material = std::min<size_t>(material, 255);
+                drawGBuffer(gbuffer, scene.meshes[instance.mesh], instanceUniform, lightingMode, static_cast<uint8_t>(material));
+            }
+            shadeGBuffer(framebuffer, gbuffer, uniform, materials, lights, shadows);
+        } else if (flatScene && rayCasting) {
+            rayCastScene(framebuffer, scene, uniform);
+        } else if (flatScene && msaaSamples > 0) {
+            // Con MSAA se dibuja en el framebuffer multimuestra y se resuelve sobre el normal
+            if (multisampled.width != WINDOW_WIDTH || multisampled.samples != msaaSamples) {
+                multisampled.resize(WINDOW_WIDTH, WINDOW_HEIGHT, msaaSamples);
+            }
+            multisampled.clear(clearColor);
+            for (const Instance& instance : scene.instances) {
+                Uniform instanceUniform = uniform;
+                instanceUniform.model = uniform.model * instance.model;
+                renderMultisample(multisampled, scene.meshes[instance.mesh], instanceUniform, instance.color);
+            }
+            resolveMultisample(multisampled, framebuffer);
+        } else if (flatScene) {
+            renderScene(framebuffer, scene, uniform, PipelineState(), incrementalFrame ? &damageTracker.damage : nullptr);
+        } else {
+            for (const Instance& instance : scene.instances) {
+                Uniform instanceUniform = uniform;
+                instanceUniform.model = uniform.model * instance.model;
+                if (texturing) {
+                    drawTexturedMesh(framebuffer, scene.meshes[instance.mesh], instanceUniform, texture, textureFilter, PipelineState(), lights, shadows);
+                } else {
+                    drawMesh(framebuffer, scene.meshes[instance.mesh], instanceUniform, lightingMode, PipelineState(), lights, shadows);
+                }
+            }
+        }
 
-        // Retardo para limitar la velocidad de cuadros
-        SDL_Delay(1000 / 144);
+        // Dibujar los tiempos por etapa del cuadro anterior
+        if (showProfilerOverlay) {
+            drawProfilerOverlay(framebuffer, 1000.0 / 144.0);
+        }
+
+        // Presentar el framebuffer en la ventana
+        {
+            PROFILE_ZONE("present");
+            if (incrementalFrame && !damageTracker.damage.full()) {
+                // Solo los rectángulos dañados; la textura conserva el resto del cuadro anterior
+                for (const PixelRect& r : damageTracker.damage.rects()) {
+                    SDL_Rect rect = {r.minX, r.minY, r.maxX - r.minX + 1, r.maxY - r.minY + 1};
+                    const Color* pixels = &framebuffer.color[static_cast<size_t>(r.minY) * framebuffer.width + r.minX];
+                    SDL_UpdateTexture(framebufferTexture, &rect, pixels, framebuffer.width * sizeof(Color));
+                }
+            } else {
+                SDL_UpdateTexture(framebufferTexture, nullptr, framebuffer.color.data(), framebuffer.width * sizeof(Color));
+            }
+            SDL_RenderCopy(renderer, framebufferTexture, nullptr, nullptr);
+            SDL_RenderPresent(renderer);
+        }
 
         // Guardar el z-buffer en un archivo BMP
-        writeBMP("../Spaceship.bmp");
+        writeBMP(framebuffer, "../Spaceship.bmp");
 
+        PROFILE_END_FRAME();
+
+        // Esperar solo lo que falta del intervalo objetivo del cuadro
+        scheduler.endFrame();
+
+        // Reportar FPS alcanzados y percentiles de jitter una vez por segundo
+        if (scheduler.report(frameReport)) {
+            std::cout << frameReport << "\n";
+            STATS(std::cout << pipelineStats.summary() << "\n");
+            SDL_SetWindowTitle(window, frameReport.c_str());
+        }
     }
 
     // Limpiar y cerrar SDL
+    SDL_DestroyTexture(framebufferTexture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();